@@ -0,0 +1,599 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "csv_common.h"
+#include "reader.h"
+#include "serializer.h"
+#include "flat_hash_map.h"
+#include "thread_pool.h"
+
+namespace csv
+{
+  enum class Aggregate
+  {
+    COUNT,
+    SUM,
+    MIN,
+    MAX,
+    MEAN
+  };
+
+  /**
+   * Streaming group by over the rows of a reader. Groups are keyed by 
+   * the raw content of the key columns, values are parsed as double.
+   * No rows are retained; empty cells and cells which are not numbers
+   * are not counted by the aggregates of their column.
+   *
+   *   csv::Aggregator agg;
+   *   agg.withKey("currency").with(csv::Aggregate::SUM, "amount");
+   *   agg.aggregate(reader);
+   *   for(std::size_t i = 0; i < agg.size(); i++)
+   *     std::cout << agg.key(i, 0) << " " << agg.value(i, 0) << std::endl;
+   *
+   * Groups are kept in order of first occurrence. Columns can be given 
+   * by name if the specification has a header.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicAggregator
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef ::std::basic_string<char_type, char_traits>  string_type;
+    typedef BasicReader<char_type, char_traits>          reader_type;
+    typedef typename reader_type::spec_type              spec_type;
+
+    static const ::std::size_t default_batch_size = 4096;
+
+    BasicAggregator();
+
+    BasicAggregator & withKey(const string_type & name);
+    BasicAggregator & withKey(::std::size_t index);
+    /** number of rows per group */
+    BasicAggregator & withCount();
+    /**
+     * COUNT of a column counts its non-empty cells, the other aggregates
+     * only use cells which are numbers.
+     */
+    BasicAggregator & with(Aggregate function, const string_type & name);
+    BasicAggregator & with(Aggregate function, ::std::size_t index);
+
+    /**
+     * Aggregates the remaining rows of reader.
+     */
+    void aggregate(reader_type & reader);
+
+    /**
+     * Tokenizes the remaining rows of reader on the calling thread.
+     * Batches of the cells of the key and value columns are aggregated 
+     * on the pool into one partial table per worker, the partial 
+     * tables are merged at the end. The order of the groups is 
+     * unspecified.
+     */
+    void aggregate(reader_type & reader, 
+                   ThreadPool & pool,
+                   ::std::size_t batch_size = default_batch_size);
+
+    void aggregate(reader_type & reader, 
+                   ::std::size_t threads,
+                   ::std::size_t batch_size = default_batch_size);
+
+    /**
+     * Adds the groups of other, which has to have the same keys and 
+     * aggregates.
+     */
+    void merge(const BasicAggregator & other);
+    void clear();
+
+    /** number of groups */
+    inline ::std::size_t size() const;
+    inline ::std::size_t keySize() const;
+    inline ::std::size_t aggregateSize() const;
+
+    /** value of the k-th key column of group i */
+    string_type key(::std::size_t i, ::std::size_t k) const;
+    /** number of rows of group i */
+    inline ::std::size_t count(::std::size_t i) const;
+    /**
+     * Result of the j-th aggregate of group i. MIN, MAX and MEAN are
+     * NaN if no cell of the group could be parsed.
+     */
+    double value(::std::size_t i, ::std::size_t j) const;
+
+  private:
+    struct Column
+    {
+      string_type   name;
+      ::std::size_t index;
+    };
+
+    struct Accumulator
+    {
+      double        sum;
+      double        min;
+      double        max;
+      ::std::size_t n;
+    };
+
+    struct Batch
+    {
+      ::std::vector<char_type>     data;
+      // cell k of the batch is [offsets[k], offsets[k + 1])
+      ::std::vector< ::std::size_t> offsets;
+    };
+
+    typedef FlatHashMap<string_type, ::std::size_t, 
+                        StringHash<string_type> >          group_map_type;
+
+    ::std::vector<Column>                           _keys;
+    ::std::vector< ::std::pair<Aggregate, Column> > _aggregates;
+
+    // resolved against the specification of the reader:
+    // input columns needed per row, and the slots of keys and values in it
+    ::std::vector< ::std::size_t>                   _needed;
+    ::std::vector< ::std::size_t>                   _key_slots;
+    ::std::vector< ::std::size_t>                   _value_slots;
+    ::std::locale                                   _locale;
+
+    group_map_type                                  _groups;
+    ::std::vector< ::std::size_t>                   _rows;
+    ::std::vector<Accumulator>                      _accumulators;
+    string_type                                     _key;
+
+    void resolve(const spec_type & spec);
+    ::std::size_t slot(const Column & column, const spec_type & spec);
+    inline ::std::size_t group(const string_type & key);
+    inline void accumulate(const char_type * const * begins, 
+                           const char_type * const * ends);
+    inline static void appendKey(string_type & key, 
+                                 const char_type * begin, 
+                                 const char_type * end);
+
+    /** withCount(), COUNT without a column */
+    inline static bool isRowCount(const ::std::pair<Aggregate, Column> & aggregate)
+    {
+      return aggregate.first == Aggregate::COUNT && 
+        aggregate.second.name.empty() && aggregate.second.index == spec_type::npos;
+    }
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicAggregator<CHAR, TRAITS>::default_batch_size;
+
+  template<typename CHAR, typename TRAITS>
+  BasicAggregator<CHAR, TRAITS>::BasicAggregator()
+  {
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicAggregator<CHAR, TRAITS> & 
+  BasicAggregator<CHAR, TRAITS>::withKey(const string_type & name)
+  {
+    _keys.push_back(Column{name, spec_type::npos});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicAggregator<CHAR, TRAITS> & 
+  BasicAggregator<CHAR, TRAITS>::withKey(::std::size_t index)
+  {
+    _keys.push_back(Column{string_type(), index});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicAggregator<CHAR, TRAITS> & BasicAggregator<CHAR, TRAITS>::withCount()
+  {
+    _aggregates.push_back(::std::make_pair(Aggregate::COUNT, 
+                                           Column{string_type(), spec_type::npos}));
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicAggregator<CHAR, TRAITS> & 
+  BasicAggregator<CHAR, TRAITS>::with(Aggregate function, const string_type & name)
+  {
+    _aggregates.push_back(::std::make_pair(function, Column{name, spec_type::npos}));
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicAggregator<CHAR, TRAITS> & 
+  BasicAggregator<CHAR, TRAITS>::with(Aggregate function, ::std::size_t index)
+  {
+    _aggregates.push_back(::std::make_pair(function, Column{string_type(), index}));
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicAggregator<CHAR, TRAITS>::slot(const Column & column,
+                                                    const spec_type & spec)
+  {
+    ::std::size_t index = column.index;
+    if(!column.name.empty())
+    {
+      index = spec.columnIndex(column.name);
+      if(index == spec_type::npos)
+      {
+        throw UndefinedColumnError("Undefined column in aggregator.", 
+                                   0, 0, 0, 0, 0);
+      }
+    }
+    for(::std::size_t i = 0; i < _needed.size(); i++)
+    {
+      if(_needed[i] == index)
+      {
+        return i;
+      }
+    }
+    _needed.push_back(index);
+    return _needed.size() - 1;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicAggregator<CHAR, TRAITS>::resolve(const spec_type & spec)
+  {
+    _needed.clear();
+    _key_slots.clear();
+    _value_slots.clear();
+    for(auto & column : _keys)
+    {
+      _key_slots.push_back(slot(column, spec));
+    }
+    for(auto & aggregate : _aggregates)
+    {
+      _value_slots.push_back(isRowCount(aggregate) ? 
+                             spec_type::npos : slot(aggregate.second, spec));
+    }
+    _locale = spec.locale();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicAggregator<CHAR, TRAITS>::appendKey(string_type & key,
+                                                       const char_type * begin,
+                                                       const char_type * end)
+  {
+    // length prefix, one character per byte of the length
+    ::std::size_t n = end - begin;
+    for(::std::size_t i = 0; i < sizeof(::std::size_t); i++)
+    {
+      key.push_back(char_type((n >> (8 * i)) & 0xff));
+    }
+    key.append(begin, end);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicAggregator<CHAR, TRAITS>::group(const string_type & key)
+  {
+    auto itr = _groups.find(key);
+    if(itr != _groups.end())
+    {
+      return itr->second;
+    }
+    ::std::size_t ret = _rows.size();
+    _groups.insert(::std::make_pair(key, ret));
+    _rows.push_back(0);
+    const double nan = ::std::numeric_limits<double>::quiet_NaN();
+    _accumulators.resize(_accumulators.size() + _aggregates.size(),
+                         Accumulator{0.0, nan, nan, 0});
+    return ret;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void 
+  BasicAggregator<CHAR, TRAITS>::accumulate(const char_type * const * begins,
+                                            const char_type * const * ends)
+  {
+    typedef BasicSerializer<char_type, char_traits, double> serializer_type;
+    _key.clear();
+    for(auto s : _key_slots)
+    {
+      appendKey(_key, begins[s], ends[s]);
+    }
+    ::std::size_t g = group(_key);
+    _rows[g]++;
+    Accumulator * acc = &_accumulators[g * _aggregates.size()];
+    for(::std::size_t j = 0; j < _value_slots.size(); j++)
+    {
+      ::std::size_t s = _value_slots[j];
+      double value;
+      if(s == spec_type::npos || begins[s] == ends[s])
+      {
+        continue;
+      }
+      if(_aggregates[j].first == Aggregate::COUNT)
+      {
+        acc[j].n++;
+        continue;
+      }
+      if(!serializer_type::parse(begins[s], ends[s], _locale, value))
+      {
+        continue;
+      }
+      if(acc[j].n == 0)
+      {
+        acc[j].min = value;
+        acc[j].max = value;
+      }
+      else
+      {
+        acc[j].min = value < acc[j].min ? value : acc[j].min;
+        acc[j].max = value > acc[j].max ? value : acc[j].max;
+      }
+      acc[j].sum+= value;
+      acc[j].n++;
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicAggregator<CHAR, TRAITS>::aggregate(reader_type & reader)
+  {
+    resolve(reader.specification());
+    ::std::vector<const char_type *> begins(_needed.size());
+    ::std::vector<const char_type *> ends(_needed.size());
+    while(reader.nextRawRow())
+    {
+      const ::std::size_t n = reader.rawRowSize();
+      for(::std::size_t s = 0; s < _needed.size(); s++)
+      {
+        if(_needed[s] < n)
+        {
+          reader.rawCell(_needed[s], begins[s], ends[s]);
+        }
+        else
+        {
+          begins[s] = ends[s] = nullptr;
+        }
+      }
+      accumulate(begins.data(), ends.data());
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicAggregator<CHAR, TRAITS>::aggregate(reader_type & reader,
+                                                ::std::size_t threads,
+                                                ::std::size_t batch_size)
+  {
+    ThreadPool pool(threads);
+    aggregate(reader, pool, batch_size);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicAggregator<CHAR, TRAITS>::aggregate(reader_type & reader,
+                                                ThreadPool & pool,
+                                                ::std::size_t batch_size)
+  {
+    struct Partial
+    {
+      BasicAggregator table;
+      ::std::mutex    mutex;
+    };
+    resolve(reader.specification());
+    if(batch_size == 0)
+    {
+      batch_size = 1;
+    }
+    const ::std::size_t width = _needed.size();
+    ::std::vector< ::std::unique_ptr<Partial> > partials;
+    for(::std::size_t i = 0; i < (pool.size() ? pool.size() : 1); i++)
+    {
+      partials.emplace_back(new Partial());
+      partials.back()->table._keys         = _keys;
+      partials.back()->table._aggregates   = _aggregates;
+      partials.back()->table._needed       = _needed;
+      partials.back()->table._key_slots    = _key_slots;
+      partials.back()->table._value_slots  = _value_slots;
+      partials.back()->table._locale       = _locale;
+    }
+    ::std::atomic< ::std::size_t> submitted(0);
+    auto fill = [&](Batch & batch)
+    {
+      batch.offsets.push_back(0);
+      ::std::size_t rows = 0;
+      while(rows < batch_size && reader.nextRawRow())
+      {
+        const ::std::size_t n = reader.rawRowSize();
+        for(::std::size_t s = 0; s < width; s++)
+        {
+          if(_needed[s] < n)
+          {
+            const char_type * begin;
+            const char_type * end;
+            reader.rawCell(_needed[s], begin, end);
+            batch.data.insert(batch.data.end(), begin, end);
+          }
+          batch.offsets.push_back(batch.data.size());
+        }
+        rows++;
+      }
+      return rows > 0;
+    };
+    auto tabulate = [&](Batch & batch)
+    {
+      // take the first partial table not used by another batch
+      const ::std::size_t first = submitted++ % partials.size();
+      ::std::unique_lock< ::std::mutex> lock;
+      Partial * partial = nullptr;
+      for(::std::size_t i = 0; i < partials.size() && !partial; i++)
+      {
+        Partial * p = partials[(first + i) % partials.size()].get();
+        lock = ::std::unique_lock< ::std::mutex>(p->mutex, ::std::try_to_lock);
+        if(lock.owns_lock())
+        {
+          partial = p;
+        }
+      }
+      if(!partial)
+      {
+        partial = partials[first].get();
+        lock    = ::std::unique_lock< ::std::mutex>(partial->mutex);
+      }
+      ::std::vector<const char_type *> begins(width);
+      ::std::vector<const char_type *> ends(width);
+      const char_type * data = batch.data.data();
+      for(::std::size_t k = 0; k + width < batch.offsets.size(); k+= width)
+      {
+        for(::std::size_t s = 0; s < width; s++)
+        {
+          begins[s] = data + batch.offsets[k + s];
+          ends[s]   = data + batch.offsets[k + s + 1];
+        }
+        partial->table.accumulate(begins.data(), ends.data());
+      }
+    };
+    processOrdered<Batch>(pool, fill, tabulate, [](Batch &) {});
+    for(auto & partial : partials)
+    {
+      merge(partial->table);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicAggregator<CHAR, TRAITS>::merge(const BasicAggregator & other)
+  {
+    const ::std::size_t m = _aggregates.size();
+    for(auto & entry : other._groups)
+    {
+      ::std::size_t g = group(entry.first);
+      _rows[g]+= other._rows[entry.second];
+      Accumulator * acc = &_accumulators[g * m];
+      const Accumulator * src = &other._accumulators[entry.second * m];
+      for(::std::size_t j = 0; j < m; j++)
+      {
+        if(src[j].n == 0)
+        {
+          continue;
+        }
+        if(acc[j].n == 0)
+        {
+          acc[j] = src[j];
+        }
+        else
+        {
+          acc[j].sum+= src[j].sum;
+          acc[j].n+= src[j].n;
+          acc[j].min = src[j].min < acc[j].min ? src[j].min : acc[j].min;
+          acc[j].max = src[j].max > acc[j].max ? src[j].max : acc[j].max;
+        }
+      }
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicAggregator<CHAR, TRAITS>::clear()
+  {
+    _groups.clear();
+    _rows.clear();
+    _accumulators.clear();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicAggregator<CHAR, TRAITS>::size() const
+  {
+    return _rows.size();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicAggregator<CHAR, TRAITS>::keySize() const
+  {
+    return _keys.size();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicAggregator<CHAR, TRAITS>::aggregateSize() const
+  {
+    return _aggregates.size();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  typename BasicAggregator<CHAR, TRAITS>::string_type 
+  BasicAggregator<CHAR, TRAITS>::key(::std::size_t i, ::std::size_t k) const
+  {
+    // the groups are stored densely in order of their index
+    const string_type & key = (_groups.begin() + i)->first;
+    ::std::size_t pos = 0;
+    while(true)
+    {
+      ::std::size_t n = 0;
+      for(::std::size_t b = 0; b < sizeof(::std::size_t); b++)
+      {
+        n|= ::std::size_t(key[pos + b] & 0xff) << (8 * b);
+      }
+      pos+= sizeof(::std::size_t);
+      if(k-- == 0)
+      {
+        return key.substr(pos, n);
+      }
+      pos+= n;
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicAggregator<CHAR, TRAITS>::count(::std::size_t i) const
+  {
+    return _rows[i];
+  }
+
+  template<typename CHAR, typename TRAITS>
+  double BasicAggregator<CHAR, TRAITS>::value(::std::size_t i, ::std::size_t j) const
+  {
+    const Accumulator & acc = _accumulators[i * _aggregates.size() + j];
+    switch(_aggregates[j].first)
+    {
+    case Aggregate::COUNT:
+      return double(isRowCount(_aggregates[j]) ? _rows[i] : acc.n);
+    case Aggregate::SUM:
+      return acc.sum;
+    case Aggregate::MIN:
+      return acc.min;
+    case Aggregate::MAX:
+      return acc.max;
+    case Aggregate::MEAN:
+      return acc.n ? acc.sum / acc.n : ::std::numeric_limits<double>::quiet_NaN();
+    }
+    return 0.0;
+  }
+}
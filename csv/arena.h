@@ -0,0 +1,197 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+namespace csv
+{
+  /**
+   * Bump pointer memory arena. Memory is taken from blocks of 
+   * block_size bytes and only released when the arena is destroyed.
+   */
+  class Arena
+  {
+  public:
+    static const ::std::size_t default_block_size = 1 << 16;
+
+    Arena(::std::size_t block_size = default_block_size);
+    Arena(const Arena &) = delete;
+    Arena & operator=(const Arena &) = delete;
+
+    void * allocate(::std::size_t bytes, ::std::size_t alignment);
+
+    /**
+     * Continues in the unused rest of the current block of previous,
+     * which stops allocating from that block. The block is released
+     * with the last of both arenas.
+     */
+    void continueFrom(Arena & previous);
+
+    /** Bytes handed out by allocate() */
+    inline ::std::size_t used() const     { return _used;     }
+
+    /** Bytes reserved in blocks */
+    inline ::std::size_t capacity() const { return _capacity; }
+
+  private:
+    ::std::mutex                            _mutex;
+    ::std::vector< ::std::shared_ptr<char> > _blocks;
+    ::std::size_t                           _block_size;
+    char                                  * _pos;
+    char                                  * _end;
+    ::std::size_t                           _used;
+    ::std::size_t                           _capacity;
+  };
+
+  /**
+   * Allocator taking memory from a shared Arena. Deallocation is a no-op, 
+   * the arena is released together with the last allocator referring to it.
+   * A default constructed allocator uses the heap.
+   */
+  template<typename T>
+  class ArenaAllocator
+  {
+  public:
+    typedef T                                value_type;
+    typedef ::std::true_type                 propagate_on_container_copy_assignment;
+    typedef ::std::true_type                 propagate_on_container_move_assignment;
+    typedef ::std::true_type                 propagate_on_container_swap;
+
+    ArenaAllocator() noexcept {}
+
+    explicit ArenaAllocator(const ::std::shared_ptr<Arena> & arena) noexcept
+      : _arena(arena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> & rhs) noexcept
+      : _arena(rhs.arena()) {}
+
+    inline T * allocate(::std::size_t n)
+    {
+      if(_arena)
+      {
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+      }
+      else
+      {
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      }
+    }
+
+    inline void deallocate(T * p, ::std::size_t)
+    {
+      if(!_arena)
+      {
+        ::operator delete(p);
+      }
+    }
+
+    inline const ::std::shared_ptr<Arena> & arena() const { return _arena; }
+
+  private:
+    ::std::shared_ptr<Arena> _arena;
+  };
+
+  template<typename T, typename U>
+  inline bool operator==(const ArenaAllocator<T> & a, const ArenaAllocator<U> & b)
+  {
+    return a.arena() == b.arena();
+  }
+
+  template<typename T, typename U>
+  inline bool operator!=(const ArenaAllocator<T> & a, const ArenaAllocator<U> & b)
+  {
+    return a.arena() != b.arena();
+  }
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  inline Arena::Arena(::std::size_t block_size)
+    : _block_size(block_size ? block_size : ::std::size_t(default_block_size)),
+      _pos(nullptr),
+      _end(nullptr),
+      _used(0),
+      _capacity(0)
+  {
+  }
+
+  inline void * Arena::allocate(::std::size_t bytes, ::std::size_t alignment)
+  {
+    ::std::lock_guard< ::std::mutex > lock(_mutex);
+    ::std::size_t pad = _pos ? 
+      (alignment - reinterpret_cast< ::std::uintptr_t>(_pos) % alignment) % alignment : 0;
+    if(!_pos || pad + bytes > ::std::size_t(_end - _pos))
+    {
+      // blocks from new[] are aligned for any fundamental type
+      ::std::size_t size = bytes > _block_size ? bytes : _block_size;
+      ::std::shared_ptr<char> block(new char[size], ::std::default_delete<char[]>());
+      _capacity += size;
+      if(size > _block_size)
+      {
+        // oversized request, keep bumping in the current block,
+        // which stays the last one
+        _blocks.insert(_pos ? _blocks.end() - 1 : _blocks.end(), block);
+        _used += bytes;
+        return block.get();
+      }
+      _blocks.push_back(block);
+      _pos = block.get();
+      _end = _pos + size;
+      pad  = 0;
+    }
+    void * ret = _pos + pad;
+    _pos  += pad + bytes;
+    _used += bytes;
+    return ret;
+  }
+
+  inline void Arena::continueFrom(Arena & previous)
+  {
+    ::std::lock_guard< ::std::mutex > lock_previous(previous._mutex);
+    ::std::lock_guard< ::std::mutex > lock(_mutex);
+    if(previous._pos != previous._end)
+    {
+      _blocks.push_back(previous._blocks.back());
+      _pos = previous._pos;
+      _end = previous._end;
+      previous._pos = previous._end;
+    }
+  }
+}
@@ -0,0 +1,752 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <initializer_list>
+#include <limits>
+#include <locale>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <vector>
+#include "csv_common.h"
+#include "reader.h"
+#include "serializer.h"
+#include "utf8.h"
+
+namespace csv
+{
+  enum class ArrowType
+  {
+    INT64,
+    DOUBLE,
+    UTF8,
+    BOOLEAN
+  };
+
+  namespace detail
+  {
+    /**
+     * Minimal FlatBuffers serializer. Objects are written front to back,
+     * a parent before its children, so that offsets written as 
+     * placeholders point forward once they are patched.
+     */
+    class FlatBufferBuilder
+    {
+    public:
+      struct Field
+      {
+        ::std::uint16_t id;
+        ::std::uint8_t  size;
+        ::std::uint64_t value;
+      };
+
+      struct Table
+      {
+        ::std::size_t                 pos;
+        // position of each field by id, 0 if absent
+        ::std::vector< ::std::size_t> fields;
+
+        inline ::std::size_t field(::std::uint16_t id) const { return fields[id]; }
+      };
+
+      FlatBufferBuilder()
+      {
+        // offset of the root table
+        put< ::std::uint32_t>(0);
+      }
+
+      template<typename T>
+      static Field field(::std::uint16_t id, T value)
+      {
+        Field ret = { id, ::std::uint8_t(sizeof(T)), 0 };
+        ::std::memcpy(&ret.value, &value, sizeof(T));
+        return ret;
+      }
+
+      /** offset to a child object, set with patch() */
+      static Field offset(::std::uint16_t id)
+      {
+        return field< ::std::uint32_t>(id, 0);
+      }
+
+      Table table(::std::initializer_list<Field> fields);
+
+      ::std::size_t string(const ::std::string & str);
+
+      /** vector of scalars or structs */
+      ::std::size_t vector(const void * data, ::std::size_t count, 
+                           ::std::size_t element_size, ::std::size_t alignment);
+
+      /** vector of offsets, slot i at pos + 4 + 4 * i is set with patch() */
+      ::std::size_t offsetVector(::std::size_t count);
+
+      inline void patch(::std::size_t at, ::std::size_t target)
+      {
+        ::std::uint32_t offset = ::std::uint32_t(target - at);
+        ::std::memcpy(&_data[at], &offset, sizeof(offset));
+      }
+
+      inline void root(::std::size_t table) { patch(0, table); }
+
+      /** the buffer padded to 8 bytes */
+      const ::std::vector<char> & finish()
+      {
+        align(8);
+        return _data;
+      }
+
+    private:
+      ::std::vector<char> _data;
+
+      inline void align(::std::size_t alignment)
+      {
+        while(_data.size() % alignment)
+        {
+          _data.push_back(0);
+        }
+      }
+
+      template<typename T>
+      inline void put(T value)
+      {
+        const char * p = reinterpret_cast<const char *>(&value);
+        _data.insert(_data.end(), p, p + sizeof(T));
+      }
+    };
+  }
+
+  /**
+   * Writes the rows of a reader as an Apache Arrow IPC file, one record 
+   * batch per batch_size rows, without depending on the Arrow library.
+   *
+   *   std::ofstream ost("trades.arrow", std::ios::binary);
+   *   csv::ArrowWriter writer(ost);
+   *   writer.withColumn("id", csv::ArrowType::INT64)
+   *         .withColumn("price", csv::ArrowType::DOUBLE)
+   *         .withColumn("symbol", csv::ArrowType::UTF8);
+   *   writer.write(reader);
+   *
+   * Without withColumn() all columns of the first row, or of the header
+   * if there are no rows, are written as UTF8. Empty and missing cells
+   * are null; other cells which cannot be converted raise 
+   * ConversionError. BOOLEAN cells are true, false, 1 or 0. Strings are
+   * written as UTF-8.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicArrowWriter
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef ::std::basic_string<char_type, char_traits>  string_type;
+    typedef BasicReader<char_type, char_traits>          reader_type;
+    typedef typename reader_type::spec_type              spec_type;
+
+    static const ::std::size_t default_batch_size = 1u << 16;
+
+    BasicArrowWriter(::std::ostream & ost, 
+                     ::std::size_t batch_size = default_batch_size);
+
+    BasicArrowWriter & withColumn(const string_type & name, ArrowType type);
+    BasicArrowWriter & withColumn(::std::size_t index, ArrowType type);
+
+    /**
+     * Writes the complete file: schema, record batches and footer.
+     * Returns the number of rows.
+     */
+    ::std::size_t write(reader_type & reader);
+
+    /** number of record batches written */
+    inline ::std::size_t batches() const { return _blocks.size(); }
+
+  private:
+    struct Column
+    {
+      string_type                     name;
+      ::std::size_t                   index;
+      ArrowType                       type;
+      ::std::string                   field_name;
+      ::std::vector< ::std::uint8_t>  validity;
+      ::std::vector<char>             values;
+      ::std::vector< ::std::int32_t>  offsets;
+      ::std::size_t                   nulls;
+    };
+
+    struct Block
+    {
+      ::std::int64_t offset;
+      ::std::int32_t metadata_length;
+      ::std::int32_t padding;
+      ::std::int64_t body_length;
+    };
+
+    struct FieldNode
+    {
+      ::std::int64_t length;
+      ::std::int64_t null_count;
+    };
+
+    struct Buffer
+    {
+      ::std::int64_t offset;
+      ::std::int64_t length;
+    };
+
+    static const ::std::int16_t metadata_version = 4;
+    static const ::std::size_t  max_batch_bytes  = 1u << 30;
+
+    ::std::ostream &          _ost;
+    ::std::size_t             _batch_size;
+    ::std::vector<Column>     _columns;
+    ::std::vector<Block>      _blocks;
+    ::std::uint64_t           _pos;
+    ::std::size_t             _rows;
+    ::std::size_t             _csv_row;
+    ::std::size_t             _input_line;
+    ::std::locale             _locale;
+
+    void resolve(reader_type & reader);
+    inline void append(Column & column, ::std::size_t row,
+                       const char_type * begin, const char_type * end);
+    void writeBatch(::std::size_t rows);
+    ::std::size_t schema(detail::FlatBufferBuilder & builder) const;
+    Block writeMessage(const ::std::vector<char> & metadata, 
+                       ::std::int64_t body_length);
+    void writeBytes(const void * data, ::std::size_t size);
+    void pad();
+
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  inline detail::FlatBufferBuilder::Table 
+  detail::FlatBufferBuilder::table(::std::initializer_list<Field> fields)
+  {
+    ::std::vector<Field> sorted(fields);
+    // larger fields first, which keeps all of them aligned
+    ::std::stable_sort(sorted.begin(), sorted.end(), [](const Field & a, const Field & b)
+    {
+      return a.size > b.size;
+    });
+    ::std::size_t max_id    = 0;
+    ::std::size_t alignment = 4;
+    for(auto & field : sorted)
+    {
+      max_id    = ::std::max< ::std::size_t>(max_id, field.id + 1);
+      alignment = ::std::max< ::std::size_t>(alignment, field.size);
+    }
+    ::std::vector< ::std::uint16_t> layout(max_id, 0);
+    ::std::size_t size = 4;
+    for(auto & field : sorted)
+    {
+      size = (size + field.size - 1) / field.size * field.size;
+      layout[field.id] = ::std::uint16_t(size);
+      size+= field.size;
+    }
+    // vtable right before the table
+    align(2);
+    const ::std::size_t vtable = _data.size();
+    put< ::std::uint16_t>(::std::uint16_t(4 + 2 * max_id));
+    put< ::std::uint16_t>(::std::uint16_t(size));
+    for(auto offset : layout)
+    {
+      put(offset);
+    }
+    align(alignment);
+    Table ret;
+    ret.pos = _data.size();
+    ret.fields.resize(max_id, 0);
+    _data.resize(ret.pos + size, 0);
+    const ::std::int32_t soffset = ::std::int32_t(ret.pos - vtable);
+    ::std::memcpy(&_data[ret.pos], &soffset, sizeof(soffset));
+    for(auto & field : fields)
+    {
+      ret.fields[field.id] = ret.pos + layout[field.id];
+      ::std::memcpy(&_data[ret.fields[field.id]], &field.value, field.size);
+    }
+    return ret;
+  }
+
+  inline ::std::size_t detail::FlatBufferBuilder::string(const ::std::string & str)
+  {
+    align(4);
+    const ::std::size_t ret = _data.size();
+    put< ::std::uint32_t>(::std::uint32_t(str.size()));
+    _data.insert(_data.end(), str.begin(), str.end());
+    _data.push_back(0);
+    return ret;
+  }
+
+  inline ::std::size_t detail::FlatBufferBuilder::vector(const void * data, 
+                                                         ::std::size_t count,
+                                                         ::std::size_t element_size,
+                                                         ::std::size_t alignment)
+  {
+    alignment = ::std::max< ::std::size_t>(alignment, 4);
+    // the elements are aligned, the length right before them
+    while((_data.size() + 4) % alignment)
+    {
+      _data.push_back(0);
+    }
+    const ::std::size_t ret = _data.size();
+    put< ::std::uint32_t>(::std::uint32_t(count));
+    const char * p = static_cast<const char *>(data);
+    _data.insert(_data.end(), p, p + count * element_size);
+    return ret;
+  }
+
+  inline ::std::size_t detail::FlatBufferBuilder::offsetVector(::std::size_t count)
+  {
+    align(4);
+    const ::std::size_t ret = _data.size();
+    put< ::std::uint32_t>(::std::uint32_t(count));
+    _data.resize(_data.size() + 4 * count, 0);
+    return ret;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicArrowWriter<CHAR, TRAITS>::default_batch_size;
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::int16_t BasicArrowWriter<CHAR, TRAITS>::metadata_version;
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicArrowWriter<CHAR, TRAITS>::max_batch_bytes;
+
+  template<typename CHAR, typename TRAITS>
+  BasicArrowWriter<CHAR, TRAITS>::BasicArrowWriter(::std::ostream & ost,
+                                                   ::std::size_t batch_size)
+    : _ost(ost),
+      _batch_size(batch_size ? batch_size : default_batch_size),
+      _pos(0),
+      _rows(0),
+      _csv_row(0),
+      _input_line(0)
+  {
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicArrowWriter<CHAR, TRAITS> & 
+  BasicArrowWriter<CHAR, TRAITS>::withColumn(const string_type & name, ArrowType type)
+  {
+    Column column;
+    column.name  = name;
+    column.index = spec_type::npos;
+    column.type  = type;
+    _columns.push_back(column);
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicArrowWriter<CHAR, TRAITS> & 
+  BasicArrowWriter<CHAR, TRAITS>::withColumn(::std::size_t index, ArrowType type)
+  {
+    Column column;
+    column.index = index;
+    column.type  = type;
+    _columns.push_back(column);
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicArrowWriter<CHAR, TRAITS>::resolve(reader_type & reader)
+  {
+    const spec_type & spec = reader.specification();
+    _locale = spec.locale();
+    for(auto & column : _columns)
+    {
+      if(!column.name.empty())
+      {
+        column.index = spec.columnIndex(column.name);
+        if(column.index == spec_type::npos)
+        {
+          throw UndefinedColumnError("Undefined column in arrow writer.", 
+                                     spec.numColumns(), 0, 0, 0, 0);
+        }
+      }
+      string_type name = spec.columnName(column.index);
+      column.field_name.clear();
+      if(name.empty())
+      {
+        column.field_name = ::std::to_string(column.index);
+      }
+      else
+      {
+        encodeUtf8(name.data(), name.data() + name.size(), column.field_name);
+      }
+      // nothing is left of a previous write() that failed
+      column.validity.clear();
+      column.values.clear();
+      column.offsets.clear();
+      column.nulls = 0;
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicArrowWriter<CHAR, TRAITS>::append(Column & column, 
+                                                     ::std::size_t row,
+                                                     const char_type * begin, 
+                                                     const char_type * end)
+  {
+    if(row % 8 == 0)
+    {
+      column.validity.push_back(0);
+      if(column.type == ArrowType::BOOLEAN)
+      {
+        column.values.push_back(0);
+      }
+    }
+    if(begin == end)
+    {
+      column.nulls++;
+    }
+    else
+    {
+      column.validity[row / 8]|= ::std::uint8_t(1u << (row % 8));
+    }
+    bool ok = true;
+    switch(column.type)
+    {
+    case ArrowType::INT64:
+      {
+        ::std::int64_t value = 0;
+        ok = (begin == end) || 
+          BasicSerializer<char_type, char_traits, ::std::int64_t>::parse(begin, end, 
+                                                                         _locale, value);
+        const char * p = reinterpret_cast<const char *>(&value);
+        column.values.insert(column.values.end(), p, p + sizeof(value));
+      }
+      break;
+    case ArrowType::DOUBLE:
+      {
+        double value = 0.0;
+        ok = (begin == end) || 
+          BasicSerializer<char_type, char_traits, double>::parse(begin, end, 
+                                                                 _locale, value);
+        const char * p = reinterpret_cast<const char *>(&value);
+        column.values.insert(column.values.end(), p, p + sizeof(value));
+      }
+      break;
+    case ArrowType::UTF8:
+      if(column.offsets.empty())
+      {
+        column.offsets.push_back(0);
+      }
+      encodeUtf8(begin, end, column.values);
+      if(column.values.size() > ::std::size_t(::std::numeric_limits< ::std::int32_t>::max()))
+      {
+        throw ConversionError("String data of record batch exceeds 2 GB.",
+                              ::std::type_index(typeid(::std::string)),
+                              _input_line, 0, _csv_row, column.index);
+      }
+      column.offsets.push_back(::std::int32_t(column.values.size()));
+      break;
+    case ArrowType::BOOLEAN:
+      {
+        const ::std::size_t n = end - begin;
+        bool value = false;
+        if(n == 1 && (*begin == '1' || *begin == '0'))
+        {
+          value = (*begin == '1');
+        }
+        else if(n == 4 && begin[0] == 't' && begin[1] == 'r' && 
+                begin[2] == 'u' && begin[3] == 'e')
+        {
+          value = true;
+        }
+        else if(!(n == 0 || (n == 5 && begin[0] == 'f' && begin[1] == 'a' && 
+                             begin[2] == 'l' && begin[3] == 's' && begin[4] == 'e')))
+        {
+          ok = false;
+        }
+        if(value)
+        {
+          column.values[row / 8]|= char(1u << (row % 8));
+        }
+      }
+      break;
+    }
+    if(!ok)
+    {
+      ::std::type_index ti(column.type == ArrowType::INT64 ? typeid(::std::int64_t) :
+                           column.type == ArrowType::DOUBLE ? typeid(double) : 
+                           typeid(bool));
+      throw ConversionError(::std::string("Cannot convert cell content ") + ti.name(),
+                            ti, _input_line, 0, _csv_row, column.index);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicArrowWriter<CHAR, TRAITS>::writeBytes(const void * data, ::std::size_t size)
+  {
+    _ost.write(static_cast<const char *>(data), size);
+    _pos+= size;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicArrowWriter<CHAR, TRAITS>::pad()
+  {
+    static const char zeros[8] = { 0 };
+    if(_pos % 8)
+    {
+      writeBytes(zeros, 8 - _pos % 8);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  typename BasicArrowWriter<CHAR, TRAITS>::Block
+  BasicArrowWriter<CHAR, TRAITS>::writeMessage(const ::std::vector<char> & metadata,
+                                               ::std::int64_t body_length)
+  {
+    Block block;
+    block.offset          = ::std::int64_t(_pos);
+    block.metadata_length = ::std::int32_t(8 + metadata.size());
+    block.padding         = 0;
+    block.body_length     = body_length;
+    const ::std::uint32_t continuation = 0xFFFFFFFF;
+    const ::std::int32_t  length       = ::std::int32_t(metadata.size());
+    writeBytes(&continuation, sizeof(continuation));
+    writeBytes(&length, sizeof(length));
+    writeBytes(metadata.data(), metadata.size());
+    return block;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t 
+  BasicArrowWriter<CHAR, TRAITS>::schema(detail::FlatBufferBuilder & builder) const
+  {
+    typedef detail::FlatBufferBuilder B;
+    // Schema { endianness, fields }
+    B::Table schema = builder.table({ B::field< ::std::int16_t>(0, 0), B::offset(1) });
+    const ::std::size_t fields = builder.offsetVector(_columns.size());
+    builder.patch(schema.field(1), fields);
+    for(::std::size_t i = 0; i < _columns.size(); i++)
+    {
+      const Column & column = _columns[i];
+      // Type union: Int = 2, FloatingPoint = 3, Utf8 = 5, Bool = 6
+      ::std::uint8_t type = 0;
+      switch(column.type)
+      {
+      case ArrowType::INT64:   type = 2; break;
+      case ArrowType::DOUBLE:  type = 3; break;
+      case ArrowType::UTF8:    type = 5; break;
+      case ArrowType::BOOLEAN: type = 6; break;
+      }
+      // Field { name, nullable, type_type, type, dictionary, children }
+      B::Table field = builder.table({ B::offset(0), 
+                                       B::field< ::std::uint8_t>(1, 1),
+                                       B::field< ::std::uint8_t>(2, type),
+                                       B::offset(3),
+                                       B::offset(5) });
+      builder.patch(fields + 4 + 4 * i, field.pos);
+      builder.patch(field.field(0), builder.string(column.field_name));
+      switch(column.type)
+      {
+      case ArrowType::INT64:
+        // Int { bitWidth, is_signed }
+        builder.patch(field.field(3), 
+                      builder.table({ B::field< ::std::int32_t>(0, 64), 
+                                      B::field< ::std::uint8_t>(1, 1) }).pos);
+        break;
+      case ArrowType::DOUBLE:
+        // FloatingPoint { precision = DOUBLE }
+        builder.patch(field.field(3), 
+                      builder.table({ B::field< ::std::int16_t>(0, 2) }).pos);
+        break;
+      case ArrowType::UTF8:
+      case ArrowType::BOOLEAN:
+        builder.patch(field.field(3), builder.table({}).pos);
+        break;
+      }
+      builder.patch(field.field(5), builder.offsetVector(0));
+    }
+    return schema.pos;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicArrowWriter<CHAR, TRAITS>::writeBatch(::std::size_t rows)
+  {
+    typedef detail::FlatBufferBuilder B;
+    ::std::vector<FieldNode> nodes;
+    ::std::vector<Buffer>    buffers;
+    ::std::int64_t           body = 0;
+    auto add = [&buffers, &body](::std::size_t length)
+    {
+      buffers.push_back(Buffer{ body, ::std::int64_t(length) });
+      body+= (length + 7) / 8 * 8;
+    };
+    for(auto & column : _columns)
+    {
+      nodes.push_back(FieldNode{ ::std::int64_t(rows), ::std::int64_t(column.nulls) });
+      add(column.validity.size());
+      if(column.type == ArrowType::UTF8)
+      {
+        add(column.offsets.size() * sizeof(::std::int32_t));
+      }
+      add(column.values.size());
+    }
+
+    // Message { version, header_type = RecordBatch, header, bodyLength }
+    B builder;
+    B::Table message = builder.table({ B::field< ::std::int16_t>(0, metadata_version),
+                                       B::field< ::std::uint8_t>(1, 3),
+                                       B::offset(2),
+                                       B::field< ::std::int64_t>(3, body) });
+    builder.root(message.pos);
+    // RecordBatch { length, nodes, buffers }
+    B::Table batch = builder.table({ B::field< ::std::int64_t>(0, ::std::int64_t(rows)),
+                                     B::offset(1),
+                                     B::offset(2) });
+    builder.patch(message.field(2), batch.pos);
+    builder.patch(batch.field(1), builder.vector(nodes.data(), nodes.size(), 
+                                                 sizeof(FieldNode), 8));
+    builder.patch(batch.field(2), builder.vector(buffers.data(), buffers.size(), 
+                                                 sizeof(Buffer), 8));
+    Block block = writeMessage(builder.finish(), body);
+    for(auto & column : _columns)
+    {
+      writeBytes(column.validity.data(), column.validity.size());
+      pad();
+      if(column.type == ArrowType::UTF8)
+      {
+        writeBytes(column.offsets.data(), column.offsets.size() * sizeof(::std::int32_t));
+        pad();
+      }
+      writeBytes(column.values.data(), column.values.size());
+      pad();
+      column.validity.clear();
+      column.values.clear();
+      column.offsets.clear();
+      column.nulls = 0;
+    }
+    _blocks.push_back(block);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicArrowWriter<CHAR, TRAITS>::write(reader_type & reader)
+  {
+    typedef detail::FlatBufferBuilder B;
+    _blocks.clear();
+    _pos  = 0;
+    _rows = 0;
+    bool resolved = false;
+    ::std::size_t batch_rows  = 0;
+    ::std::size_t batch_bytes = 0;
+    auto start = [&](::std::size_t n)
+    {
+      if(_columns.empty())
+      {
+        for(::std::size_t i = 0; i < n; i++)
+        {
+          withColumn(i, ArrowType::UTF8);
+        }
+      }
+      resolve(reader);
+      resolved = true;
+      writeBytes("ARROW1\0\0", 8);
+      // Message { version, header_type = Schema, header, bodyLength }
+      B builder;
+      B::Table message = builder.table({ B::field< ::std::int16_t>(0, metadata_version),
+                                         B::field< ::std::uint8_t>(1, 1),
+                                         B::offset(2),
+                                         B::field< ::std::int64_t>(3, 0) });
+      builder.root(message.pos);
+      builder.patch(message.field(2), schema(builder));
+      writeMessage(builder.finish(), 0);
+    };
+    while(reader.nextRawRow())
+    {
+      const ::std::size_t n = reader.rawRowSize();
+      _input_line = reader.rawInputLine();
+      _csv_row    = reader.rawRow();
+      if(!resolved)
+      {
+        start(n);
+      }
+      batch_bytes = 0;
+      for(auto & column : _columns)
+      {
+        const char_type * begin = nullptr;
+        const char_type * end   = nullptr;
+        if(column.index < n)
+        {
+          reader.rawCell(column.index, begin, end);
+        }
+        append(column, batch_rows, begin, end);
+        batch_bytes+= column.values.size();
+      }
+      _rows++;
+      batch_rows++;
+      if(batch_rows == _batch_size || batch_bytes >= max_batch_bytes)
+      {
+        writeBatch(batch_rows);
+        batch_rows = 0;
+      }
+    }
+    if(!resolved)
+    {
+      start(reader.specification().numColumns());
+    }
+    if(batch_rows)
+    {
+      writeBatch(batch_rows);
+    }
+    // end of stream marker
+    const ::std::uint32_t eos[2] = { 0xFFFFFFFF, 0 };
+    writeBytes(eos, sizeof(eos));
+
+    // Footer { version, schema, dictionaries, recordBatches }
+    B builder;
+    B::Table footer = builder.table({ B::field< ::std::int16_t>(0, metadata_version),
+                                      B::offset(1),
+                                      B::offset(2),
+                                      B::offset(3) });
+    builder.root(footer.pos);
+    builder.patch(footer.field(1), schema(builder));
+    builder.patch(footer.field(2), builder.vector(nullptr, 0, sizeof(Block), 8));
+    builder.patch(footer.field(3), builder.vector(_blocks.data(), _blocks.size(), 
+                                                  sizeof(Block), 8));
+    const ::std::vector<char> & data = builder.finish();
+    const ::std::int32_t length = ::std::int32_t(data.size());
+    writeBytes(data.data(), data.size());
+    writeBytes(&length, sizeof(length));
+    writeBytes("ARROW1", 6);
+    _ost.flush();
+    return _rows;
+  }
+}
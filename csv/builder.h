@@ -34,10 +34,15 @@ either expressed or implied, of the FreeBSD Project.
 #include <vector>
 #include <string>
 #include <ostream>
+#include <sstream>
 #include <type_traits>
 #include <typeinfo>
+#include <utility>
+#include <algorithm>
 #include "csv_common.h"
 #include "serializer.h"
+#include "formatter.h"
+#include "statistics.h"
 
 
 namespace csv
@@ -59,6 +64,30 @@ public:
   virtual void streamOut(::std::ostream & ost, const object_type & obj) = 0;
   virtual const std::type_info& getTypeInfo() const = 0;
 
+  /**
+   * Parses the characters [begin, end), the default copies them 
+   * to a string.
+   */
+  virtual void parse(object_type & cls, const char_type * begin, const char_type * end, const::std::locale & locale) const
+  {
+    parse(cls, string_type(begin, end), locale);
+  }
+
+  /**
+   * Appends the member to out, the default goes through streamOut.
+   */
+  virtual void format(string_type & out, const object_type & obj, const ::std::locale & locale) const
+  {
+    ::std::ostringstream ss;
+    ss.imbue(locale);
+    const_cast<MemberInterface*>(this)->streamOut(ss, obj);
+    const ::std::string str(ss.str());
+    for(char ch : str)
+    {
+      out.push_back(char_type(ch));
+    }
+  }
+
   template<typename T> T& bind(object_type & obj) const
   {
     T * ptr = (T*)bindMember(obj);
@@ -120,11 +149,23 @@ public:
     obj.*_pointerToMember = serializer_type::as(str, locale);
   }
 
+  virtual void parse(object_type & obj, const char_type * begin, const char_type * end, const ::std::locale & locale) const override
+  {
+    typedef BasicSerializer<char_type, char_traits, member_type> serializer_type;
+    obj.*_pointerToMember = serializer_type::as(begin, end, locale);
+  }
+
   virtual void streamOut(::std::ostream & ost, const object_type & obj) override
   {
     ost << obj.*_pointerToMember;
   }
 
+  virtual void format(string_type & out, const object_type & obj, const ::std::locale & locale) const override
+  {
+    typedef BasicFormatter<char_type, char_traits, member_type> formatter_type;
+    formatter_type::format(out, obj.*_pointerToMember, locale);
+  }
+
   const std::type_info& getTypeInfo() const override
   {
     return typeid(member_type);
@@ -219,6 +260,83 @@ public:
     return members.end();
   }
 
+  /**
+   * Column to member mapping, resolved once from the specification
+   * (i.e. after the header has been read).
+   */
+  template<typename ROW>
+  class Mapping
+  {
+  public:
+    typedef ROW                                 row_type;
+    typedef typename row_type::cell_type        cell_type;
+    typedef typename row_type::spec_type        spec_type;
+
+    Mapping(const std::shared_ptr<self_type> & builder,
+            const spec_type & spec)
+      : _builder(builder), _locale(spec.locale()), _min_row_size(0)
+    {
+      CSV_STATISTICS(_statistics = spec.conversionStatistics());
+      for(auto & field : *_builder)
+      {
+        std::size_t index = spec.columnIndex(field->getName());
+        if(index != spec_type::npos)
+        {
+          _columns.push_back(column_type(index, field.get()));
+          _min_row_size = std::max(_min_row_size, index + 1);
+        }
+      }
+      std::sort(_columns.begin(), _columns.end(),
+                [](const column_type & a, const column_type & b)
+                { return a.first < b.first; });
+    }
+
+    /**
+     * True if all mapped members are assigned from the row.
+     */
+    inline bool covers(const row_type & row) const
+    {
+      return row.size() >= _min_row_size;
+    }
+
+    inline void map(object_type & obj, const row_type & row) const
+    {
+      std::size_t n = row.size();
+      for(auto & column : _columns)
+      {
+        if(column.first < n)
+        {
+          const cell_type & cell(*(row.begin() + column.first));
+          CSV_STATISTICS(StatisticsTimer timer(_statistics));
+          try
+          {
+            column.second->parse(obj,
+                                 cell.data(),
+                                 cell.data() + cell.size(),
+                                 _locale);
+          }
+          catch(const BasicSerializerFailure & failure)
+          {
+            throw ConversionError(::std::string(failure.what()),
+                                  failure.getType(),
+                                  cell.inputLine(),
+                                  cell.inputColumn(),
+                                  cell.row(),
+                                  cell.column());
+          }
+        }
+      }
+    }
+
+  private:
+    typedef std::pair<std::size_t, const member_type*> column_type;
+    std::shared_ptr<self_type>      _builder;
+    std::vector<column_type>        _columns;
+    std::locale                     _locale;
+    std::size_t                     _min_row_size;
+    CSV_STATISTICS(ConversionStatistics * _statistics;)
+  };
+
 private:
   std::vector<shared_member_type> members;
 };
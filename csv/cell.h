@@ -36,6 +36,8 @@ either expressed or implied, of the FreeBSD Project.
 #include "csv_common.h"
 #include "serializer.h"
 #include "specification.h"
+#include "arena.h"
+#include "statistics.h"
 
 namespace csv
 {
@@ -48,7 +50,8 @@ namespace csv
     typedef std::basic_string<char_type, char_traits>  string_type;
     typedef BasicSpecification<char_type, char_traits> spec_type;    
     typedef std::shared_ptr<spec_type>                 shared_spec_type;
-    typedef std::vector<char_type>                     buffer_type;
+    typedef ArenaAllocator<char_type>                  allocator_type;
+    typedef std::vector<char_type, allocator_type>     buffer_type;
     typedef std::shared_ptr<buffer_type>               shared_buffer_type;
     typedef typename buffer_type::const_iterator       const_iterator;
 
@@ -65,10 +68,26 @@ namespace csv
 
     const_iterator begin() const;
     const_iterator end() const;
+    inline const char_type * data() const;
+    inline ::std::size_t size() const;
 
     template<typename RET> 
     RET as() const;
 
+    /**
+     * Converts the cell without throwing, returns false if the content
+     * cannot be converted to RET. value is unspecified in this case.
+     */
+    template<typename RET>
+    inline bool tryAs(RET & value) const;
+
+    /**
+     * The error as<RET>() throws for this cell, e.g. to report a
+     * failed tryAs().
+     */
+    template<typename RET>
+    ConversionError conversionError() const;
+
     inline const string_type & name() const;
     inline ::std::size_t inputColumn() const;
     inline ::std::size_t inputLine() const;
@@ -76,6 +95,13 @@ namespace csv
     inline ::std::size_t column() const;
     shared_spec_type specification() const ;
 
+    /**
+     * Code of the value in the column's dictionary, 
+     * spec_type::npos if the column is not dictionary encoded.
+     */
+    inline ::std::size_t code() const;
+    inline bool isEncoded() const;
+
   private:
     friend class BasicRow<char_type, char_traits>;
     friend class BasicReader<char_type, char_traits>;
@@ -87,13 +113,15 @@ namespace csv
       ::std::size_t _csv_column;
       ::std::size_t _input_line;
       ::std::size_t _input_column;
+      ::std::size_t _code;
 
       range_type(::std::size_t begin,
                  ::std::size_t end,
                  ::std::size_t csv_row      = 0,
                  ::std::size_t csv_column   = 0,
                  ::std::size_t input_line   = 0,
-                 ::std::size_t input_column = 0);
+                 ::std::size_t input_column = 0,
+                 ::std::size_t code         = spec_type::npos);
     };
     typedef typename spec_type::Column                 column_type;
     typedef std::shared_ptr<column_type>               shared_column_type;
@@ -175,26 +203,39 @@ namespace csv
   inline typename BasicCell<CHAR,TRAITS>::const_iterator
   BasicCell<CHAR,TRAITS>::begin() const
   {
-    _shared_buffer->begin() + _range._begin;
+    return _shared_buffer->begin() + _range._begin;
   }
 
   template<typename CHAR, typename TRAITS> 
   inline typename BasicCell<CHAR,TRAITS>::const_iterator
   BasicCell<CHAR,TRAITS>::end() const
   {
-    _shared_buffer->begin() + _range._end;
+    return _shared_buffer->begin() + _range._end;
+  }
+
+
+  template<typename CHAR, typename TRAITS> 
+  inline const typename BasicCell<CHAR,TRAITS>::char_type *
+  BasicCell<CHAR,TRAITS>::data() const
+  {
+    return _shared_buffer->data() + _range._begin;
   }
 
+  template<typename CHAR, typename TRAITS> 
+  inline ::std::size_t BasicCell<CHAR,TRAITS>::size() const
+  {
+    return _range._end - _range._begin;
+  }
 
   template<typename CHAR, typename TRAITS>
   template<typename RET> 
   inline RET BasicCell<CHAR,TRAITS>::as() const
   {
     typedef BasicSerializer<char_type, char_traits, RET> serializer_type;
+    CSV_STATISTICS(StatisticsTimer timer(_specs->conversionStatistics()));
     try
     {
-      return serializer_type::as(string_type(begin(), end()),
-                                 specification()->locale());
+      return serializer_type::as(data(), data() + size(), _specs->locale());
     }
     catch(BasicSerializerFailure failure)
     {
@@ -207,6 +248,30 @@ namespace csv
     }
   }
 
+  template<typename CHAR, typename TRAITS>
+  template<typename RET> 
+  inline bool BasicCell<CHAR,TRAITS>::tryAs(RET & value) const
+  {
+    typedef BasicSerializer<char_type, char_traits, RET> serializer_type;
+    CSV_STATISTICS(StatisticsTimer timer(_specs->conversionStatistics()));
+    return serializer_type::parse(data(), data() + size(), 
+                                  _specs->locale(), value);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename RET> 
+  ConversionError BasicCell<CHAR,TRAITS>::conversionError() const
+  {
+    typedef BasicSerializer<char_type, char_traits, RET> serializer_type;
+    BasicSerializerFailure failure(serializer_type::failure());
+    return ConversionError(::std::string(failure.what()),
+                           failure.getType(),
+                           inputLine(),
+                           inputColumn(),
+                           row(),
+                           column());
+  }
+
   template<typename CHAR, typename TRAITS>
   inline const typename BasicCell<CHAR,TRAITS>::string_type & 
   BasicCell<CHAR,TRAITS>::name() const 
@@ -245,19 +310,33 @@ namespace csv
     return _specs;
   }
 
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicCell<CHAR,TRAITS>::code() const
+  {
+    return _range._code;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline bool BasicCell<CHAR,TRAITS>::isEncoded() const
+  {
+    return _range._code != spec_type::npos;
+  }
+
   template<typename CHAR, typename TRAITS>
   BasicCell<CHAR,TRAITS>::range_type::range_type(::std::size_t begin,
                                                  ::std::size_t end,
                                                  ::std::size_t csv_row,
                                                  ::std::size_t csv_column,
                                                  ::std::size_t input_line,
-                                                 ::std::size_t input_column )
+                                                 ::std::size_t input_column,
+                                                 ::std::size_t code )
         : _begin(begin), 
           _end(end),
           _csv_row(csv_row),
           _csv_column(csv_column),
           _input_line(input_line),
-          _input_column(input_column)
+          _input_column(input_column),
+          _code(code)
       {}
 
   template<typename CHAR, typename TRAITS>
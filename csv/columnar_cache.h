@@ -0,0 +1,1157 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <type_traits>
+#include <vector>
+#include <sys/stat.h>
+#if defined(__unix__) || defined(__APPLE__)
+#define CSV_HAS_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "csv_common.h"
+#include "reader.h"
+#include "serializer.h"
+#include "formatter.h"
+#include "dictionary.h"
+#include "flat_hash_map.h"
+
+namespace csv
+{
+  enum class ColumnType
+  {
+    INT64,
+    DOUBLE,
+    STRING
+  };
+
+  namespace detail
+  {
+    /**
+     * true if converting a cached NUMBER to RET gives the same value as
+     * parsing the text of the cell: double targets (cells are only 
+     * stored as numbers if they format back to their text) and signed 
+     * integer targets of integer columns, with a range check. Unsigned 
+     * targets take the text path, the stream accepts negative numbers.
+     */
+    template<typename NUMBER, typename RET>
+    struct IsDirectConversion : ::std::integral_constant<bool,
+      ::std::is_same<RET, double>::value ||
+      (::std::is_integral<NUMBER>::value && 
+       ::std::is_integral<RET>::value &&
+       ::std::is_signed<RET>::value &&
+       !::std::is_same<RET, char>::value &&
+       !::std::is_same<RET, signed char>::value &&
+       !::std::is_same<RET, wchar_t>::value)>
+    {
+    };
+
+    /**
+     * Read only view of a whole file, memory mapped where available.
+     * The data is aligned to 8 bytes.
+     */
+    class MappedFile
+    {
+    public:
+      MappedFile() : _data(nullptr), _size(0) {}
+      ~MappedFile() { close(); }
+
+      MappedFile(const MappedFile &) = delete;
+      MappedFile & operator=(const MappedFile &) = delete;
+
+      bool open(const ::std::string & path);
+      void close();
+
+      inline const char * data() const  { return _data; }
+      inline ::std::size_t size() const { return _size; }
+
+    private:
+      const char *                  _data;
+      ::std::size_t                 _size;
+#ifndef CSV_HAS_MMAP
+      ::std::vector< ::std::uint64_t> _buffer;
+#endif
+    };
+
+    /** 
+     * Size and modification time (in nanoseconds where the platform
+     * provides them) of a file, false if it does not exist.
+     */
+    inline bool fileStamp(const ::std::string & path, 
+                          ::std::uint64_t & size, 
+                          ::std::uint64_t & mtime);
+  }
+
+  /**
+   * Binary columnar copy of a CSV file for fast reloads.
+   *
+   *   csv::ColumnarCache cache;
+   *   cache.open("rates.csv", "rates.csv.cache", 
+   *              csv::Specification().withHeader());
+   *   for(std::size_t i = 0; i < cache.size(); i++)
+   *     std::cout << cache.row(i)["rate"].as<double>() << std::endl;
+   *
+   * open() maps the cache file if it was built from the source with 
+   * the same size, modification time and specification, otherwise it 
+   * rebuilds the cache first. 
+   *
+   * Columns are INT64 or DOUBLE if every non-empty cell is a number 
+   * whose formatted value is identical to the cell, all other columns 
+   * are STRING with dictionary encoded values. Rows are stored in row
+   * groups, each with a validity bitmap per column, so the text of 
+   * every cell is preserved. Empty and missing cells are null.
+   * The file uses the byte order of the machine that wrote it.
+   *
+   * row(i) returns a CachedRow instead of a BasicRow: it has the same
+   * operator[] by index or name, size(), as() and tryAs(), but it is a
+   * view into the mapped file and cannot be iterated or copied into a
+   * container of rows. as() and tryAs() give the same results as on 
+   * the cells of a reader.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicColumnarCache
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef ::std::basic_string<char_type, char_traits>  string_type;
+    typedef BasicReader<char_type, char_traits>          reader_type;
+    typedef typename reader_type::spec_type              spec_type;
+
+    static const ::std::size_t default_row_group_size = 1u << 16;
+
+    class CachedCell
+    {
+      friend class BasicColumnarCache<char_type, char_traits>;
+    public:
+      inline bool isNull() const { return _cache->isNull(_row, _column); }
+      inline ColumnType type() const { return _cache->type(_column); }
+      inline string_type name() const { return _cache->columnName(_column); }
+      inline ::std::size_t row() const { return _row; }
+      inline ::std::size_t column() const { return _column; }
+
+      template<typename RET>
+      inline RET as() const { return _cache->template as<RET>(_row, _column); }
+
+      template<typename RET>
+      inline bool tryAs(RET & value) const 
+      {
+        return _cache->tryAs(_row, _column, value); 
+      }
+
+    private:
+      CachedCell(const BasicColumnarCache * cache, 
+                 ::std::size_t row, 
+                 ::std::size_t column)
+        : _cache(cache), _row(row), _column(column) {}
+
+      const BasicColumnarCache * _cache;
+      ::std::size_t              _row;
+      ::std::size_t              _column;
+    };
+
+    class CachedRow
+    {
+      friend class BasicColumnarCache<char_type, char_traits>;
+    public:
+      inline ::std::size_t size() const { return _cache->rowSize(_row); }
+      inline ::std::size_t row() const { return _row; }
+      CachedCell operator[](::std::size_t i) const;
+      CachedCell operator[](const string_type & name) const;
+
+    private:
+      CachedRow(const BasicColumnarCache * cache, ::std::size_t row)
+        : _cache(cache), _row(row) {}
+
+      const BasicColumnarCache * _cache;
+      ::std::size_t              _row;
+    };
+
+    BasicColumnarCache();
+
+    /**
+     * Maps cache_path, rebuilding it from source_path if it is missing 
+     * or stale.
+     */
+    void open(const ::std::string & source_path,
+              const ::std::string & cache_path,
+              spec_type specs = spec_type(),
+              ::std::size_t row_group_size = default_row_group_size);
+
+    /**
+     * Writes the cache of source_path to cache_path. Reads the source 
+     * twice, once to infer the column types.
+     */
+    static void save(const ::std::string & source_path,
+                     const ::std::string & cache_path,
+                     spec_type specs = spec_type(),
+                     ::std::size_t row_group_size = default_row_group_size);
+
+    /** true if the last open() had to rebuild the cache */
+    inline bool rebuilt() const { return _rebuilt; }
+
+    /** number of rows */
+    inline ::std::size_t size() const { return _header ? _header->rows : 0; }
+    inline ::std::size_t numColumns() const { return _columns.size(); }
+    inline string_type columnName(::std::size_t column) const;
+    /** index of the column or spec_type::npos */
+    inline ::std::size_t columnIndex(const string_type & name) const;
+    inline ColumnType type(::std::size_t column) const;
+
+    inline CachedRow row(::std::size_t i) const { return CachedRow(this, i); }
+
+    /** number of cells of row i in the source */
+    inline ::std::size_t rowSize(::std::size_t i) const;
+    inline bool isNull(::std::size_t i, ::std::size_t column) const;
+
+    /**
+     * Text of a STRING cell, empty for null cells. Points into the 
+     * mapped file.
+     */
+    inline void cellData(::std::size_t i, ::std::size_t column,
+                         const char_type *& begin,
+                         const char_type *& end) const;
+
+    template<typename RET>
+    bool tryAs(::std::size_t i, ::std::size_t column, RET & value) const;
+
+    /** Throws ConversionError if the cell cannot be converted */
+    template<typename RET>
+    RET as(::std::size_t i, ::std::size_t column) const;
+
+  private:
+    static const ::std::uint64_t version = 1;
+
+    struct FileHeader
+    {
+      char            magic[8];
+      ::std::uint64_t version;
+      ::std::uint64_t char_size;
+      ::std::uint64_t source_size;
+      ::std::uint64_t source_mtime;
+      ::std::uint64_t spec_hash;
+      ::std::uint64_t rows;
+      ::std::uint64_t columns;
+      ::std::uint64_t row_group_size;
+      ::std::uint64_t row_groups;
+      ::std::uint64_t directory;
+      ::std::uint64_t file_size;
+    };
+
+    struct ColumnEntry
+    {
+      ::std::uint64_t type;
+      ::std::uint64_t name;
+      ::std::uint64_t name_length;
+      ::std::uint64_t dictionary_size;
+      // dictionary_size + 1 character offsets into dictionary_data
+      ::std::uint64_t dictionary_offsets;
+      ::std::uint64_t dictionary_data;
+    };
+
+    // per row group: row sizes, then validity and values per column
+    struct GroupEntry
+    {
+      ::std::uint64_t sizes;
+    };
+
+    struct ChunkEntry
+    {
+      ::std::uint64_t validity;
+      ::std::uint64_t values;
+    };
+
+    class Output;
+    struct ColumnBuilder;
+
+    detail::MappedFile                  _file;
+    const FileHeader *                  _header;
+    const ColumnEntry *                 _columns_begin;
+    ::std::vector<ColumnEntry>          _columns;
+    const ::std::uint64_t *             _groups;
+    FlatHashMap<string_type, ::std::size_t, 
+                StringHash<string_type> > _names;
+    ::std::locale                       _locale;
+    bool                                _rebuilt;
+
+    bool load(const ::std::string & cache_path,
+              ::std::uint64_t source_size,
+              ::std::uint64_t source_mtime,
+              ::std::uint64_t spec_hash);
+    bool validate(const FileHeader & header) const;
+    inline const ChunkEntry & chunk(::std::size_t i, 
+                                    ::std::size_t column) const;
+    template<typename T>
+    inline const T * at(::std::uint64_t offset) const
+    {
+      return reinterpret_cast<const T *>(_file.data() + offset);
+    }
+
+    template<typename NUMBER, typename RET>
+    inline static typename ::std::enable_if< detail::IsDirectConversion<NUMBER, RET>::value, 
+                                            bool>::type
+    convert(NUMBER number, RET & value, const ::std::locale & locale);
+
+    template<typename NUMBER, typename RET>
+    inline static typename ::std::enable_if<!detail::IsDirectConversion<NUMBER, RET>::value, 
+                                            bool>::type
+    convert(NUMBER number, RET & value, const ::std::locale & locale);
+
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  inline bool detail::MappedFile::open(const ::std::string & path)
+  {
+    close();
+#ifdef CSV_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+      return false;
+    }
+    struct stat st;
+    if(::fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+      ::close(fd);
+      return false;
+    }
+    void * data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+    {
+      return false;
+    }
+    _data = static_cast<const char *>(data);
+    _size = st.st_size;
+    return true;
+#else
+    ::std::ifstream file(path.c_str(), ::std::ios::in | ::std::ios::binary);
+    if(!file)
+    {
+      return false;
+    }
+    file.seekg(0, ::std::ios::end);
+    ::std::size_t size = ::std::size_t(file.tellg());
+    file.seekg(0, ::std::ios::beg);
+    _buffer.resize((size + 7) / 8);
+    if(!file.read(reinterpret_cast<char *>(_buffer.data()), size))
+    {
+      _buffer.clear();
+      return false;
+    }
+    _data = reinterpret_cast<const char *>(_buffer.data());
+    _size = size;
+    return true;
+#endif
+  }
+
+  inline void detail::MappedFile::close()
+  {
+#ifdef CSV_HAS_MMAP
+    if(_data)
+    {
+      ::munmap(const_cast<char *>(_data), _size);
+    }
+#else
+    _buffer.clear();
+#endif
+    _data = nullptr;
+    _size = 0;
+  }
+
+  inline bool detail::fileStamp(const ::std::string & path, 
+                                ::std::uint64_t & size, 
+                                ::std::uint64_t & mtime)
+  {
+    struct stat st;
+    if(::stat(path.c_str(), &st) != 0)
+    {
+      return false;
+    }
+    size  = ::std::uint64_t(st.st_size);
+    // nanoseconds, a rewrite within the same second changes the stamp
+    mtime = ::std::uint64_t(st.st_mtime) * 1000000000u;
+#if defined(__APPLE__)
+    mtime += ::std::uint64_t(st.st_mtimespec.tv_nsec);
+#elif defined(__unix__)
+    mtime += ::std::uint64_t(st.st_mtim.tv_nsec);
+#endif
+    return true;
+  }
+
+  /**
+   * Sequential binary output, every block is padded to 8 bytes.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicColumnarCache<CHAR, TRAITS>::Output
+  {
+  public:
+    Output(const ::std::string & path) 
+      : _path(path), 
+        _file(path.c_str(), ::std::ios::out | ::std::ios::binary | ::std::ios::trunc),
+        _pos(0)
+    {
+      if(!_file)
+      {
+        throw CacheError("Cannot create cache file " + path);
+      }
+    }
+
+    inline ::std::uint64_t pos() const { return _pos; }
+
+    template<typename T>
+    ::std::uint64_t append(const T * data, ::std::size_t n)
+    {
+      ::std::uint64_t ret = _pos;
+      _file.write(reinterpret_cast<const char *>(data), n * sizeof(T));
+      _pos+= n * sizeof(T);
+      return ret;
+    }
+
+    void pad()
+    {
+      static const char zeros[8] = { 0 };
+      if(_pos % 8)
+      {
+        _file.write(zeros, 8 - _pos % 8);
+        _pos+= 8 - _pos % 8;
+      }
+    }
+
+    template<typename T>
+    ::std::uint64_t write(const T * data, ::std::size_t n)
+    {
+      ::std::uint64_t ret = append(data, n);
+      pad();
+      return ret;
+    }
+
+    template<typename T>
+    inline ::std::uint64_t write(const ::std::vector<T> & data)
+    {
+      return write(data.data(), data.size());
+    }
+
+    void writeAt(::std::uint64_t pos, const char * data, ::std::size_t n)
+    {
+      _file.seekp(pos);
+      _file.write(data, n);
+      _file.seekp(_pos);
+    }
+
+    void close()
+    {
+      _file.close();
+      if(!_file)
+      {
+        throw CacheError("Cannot write cache file " + _path);
+      }
+    }
+
+  private:
+    ::std::string  _path;
+    ::std::ofstream _file;
+    ::std::uint64_t _pos;
+  };
+
+  /**
+   * Values of one column of the current row group.
+   */
+  template<typename CHAR, typename TRAITS>
+  struct BasicColumnarCache<CHAR, TRAITS>::ColumnBuilder
+  {
+    ColumnType                                type;
+    ::std::vector< ::std::uint8_t>            validity;
+    ::std::vector< ::std::int64_t>            integers;
+    ::std::vector<double>                     reals;
+    ::std::vector< ::std::uint32_t>           codes;
+    BasicDictionary<char_type, char_traits>   dictionary;
+    ::std::vector<ChunkEntry>                 chunks;
+
+    void add(::std::size_t row, const char_type * begin, const char_type * end,
+             const ::std::locale & locale)
+    {
+      if(begin != end)
+      {
+        validity[row / 8]|= ::std::uint8_t(1u << (row % 8));
+      }
+      switch(type)
+      {
+      case ColumnType::INT64:
+        integers.push_back(0);
+        if(begin != end)
+        {
+          BasicSerializer<char_type, char_traits, ::std::int64_t>::parse(begin, end, locale, 
+                                                                         integers.back());
+        }
+        break;
+      case ColumnType::DOUBLE:
+        reals.push_back(0.0);
+        if(begin != end)
+        {
+          BasicSerializer<char_type, char_traits, double>::parse(begin, end, locale, 
+                                                                 reals.back());
+        }
+        break;
+      case ColumnType::STRING:
+        codes.push_back(0);
+        if(begin != end)
+        {
+          ::std::size_t code = dictionary.intern(begin, end);
+          if(code > ::std::numeric_limits< ::std::uint32_t>::max())
+          {
+            throw CacheError("Too many distinct values in column.");
+          }
+          codes.back() = ::std::uint32_t(code);
+        }
+        break;
+      }
+    }
+
+    void flush(Output & out)
+    {
+      ChunkEntry entry;
+      entry.validity = out.write(validity);
+      switch(type)
+      {
+      case ColumnType::INT64:  entry.values = out.write(integers); break;
+      case ColumnType::DOUBLE: entry.values = out.write(reals);    break;
+      case ColumnType::STRING: entry.values = out.write(codes);    break;
+      }
+      chunks.push_back(entry);
+      validity.clear();
+      integers.clear();
+      reals.clear();
+      codes.clear();
+    }
+  };
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicColumnarCache<CHAR, TRAITS>::default_row_group_size;
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::uint64_t BasicColumnarCache<CHAR, TRAITS>::version;
+
+  template<typename CHAR, typename TRAITS>
+  BasicColumnarCache<CHAR, TRAITS>::BasicColumnarCache()
+    : _header(nullptr),
+      _columns_begin(nullptr),
+      _groups(nullptr),
+      _rebuilt(false)
+  {
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicColumnarCache<CHAR, TRAITS>::save(const ::std::string & source_path,
+                                              const ::std::string & cache_path,
+                                              spec_type specs,
+                                              ::std::size_t row_group_size)
+  {
+    typedef ::std::basic_ifstream<char_type, char_traits> ifstream_type;
+    ::std::uint64_t source_size;
+    ::std::uint64_t source_mtime;
+    if(!detail::fileStamp(source_path, source_size, source_mtime))
+    {
+      throw CacheError("Cannot read source file " + source_path);
+    }
+    if(row_group_size == 0)
+    {
+      row_group_size = default_row_group_size;
+    }
+    const ::std::locale locale = specs.locale();
+    const char_type * begin;
+    const char_type * end;
+
+    // first pass: types of the columns
+    ::std::vector<ColumnType> types;
+    ::std::vector<bool>       seen;
+    // all cells so far survive a conversion to double, integer columns
+    // are demoted to strings if an earlier integer did not
+    ::std::vector<bool>       reals;
+    {
+      ifstream_type ist(source_path.c_str());
+      reader_type reader(ist, specs);
+      string_type text;
+      auto roundTrips = [&](const char_type * begin, const char_type * end) -> bool
+      {
+        return text.size() == ::std::size_t(end - begin) &&
+          !char_traits::compare(text.data(), begin, text.size());
+      };
+      while(reader.nextRawRow())
+      {
+        const ::std::size_t n = reader.rawRowSize();
+        if(n > types.size())
+        {
+          types.resize(n, ColumnType::INT64);
+          seen.resize(n, false);
+          reals.resize(n, true);
+        }
+        for(::std::size_t c = 0; c < n; c++)
+        {
+          reader.rawCell(c, begin, end);
+          if(begin == end)
+          {
+            continue;
+          }
+          seen[c] = true;
+          if(types[c] == ColumnType::STRING)
+          {
+            continue;
+          }
+          bool integer = false;
+          if(types[c] == ColumnType::INT64)
+          {
+            ::std::int64_t value;
+            text.clear();
+            if(BasicSerializer<char_type, char_traits, ::std::int64_t>::parse(begin, end, 
+                                                                              locale, value))
+            {
+              BasicFormatter<char_type, char_traits, ::std::int64_t>::format(text, value, 
+                                                                             locale);
+            }
+            integer = roundTrips(begin, end);
+          }
+          if(reals[c])
+          {
+            double value;
+            text.clear();
+            if(BasicSerializer<char_type, char_traits, double>::parse(begin, end, 
+                                                                      locale, value))
+            {
+              BasicFormatter<char_type, char_traits, double>::format(text, value, locale);
+            }
+            reals[c] = roundTrips(begin, end);
+          }
+          if(!integer)
+          {
+            types[c] = reals[c] ? ColumnType::DOUBLE : ColumnType::STRING;
+          }
+        }
+      }
+      for(::std::size_t c = 0; c < types.size(); c++)
+      {
+        if(!seen[c])
+        {
+          types[c] = ColumnType::STRING;
+        }
+      }
+    }
+
+    // second pass: row groups, written to a temporary file which 
+    // replaces the cache at the end
+    // unique, concurrent rebuilds of the same cache do not share it
+    static ::std::atomic< ::std::size_t> counter(0);
+    const ::std::string tmp_path = cache_path + "." +
+#ifdef CSV_HAS_MMAP
+      ::std::to_string(::getpid()) + "_" +
+#endif
+      ::std::to_string(::std::chrono::steady_clock::now().time_since_epoch().count()) +
+      "_" + ::std::to_string(counter++) + ".tmp";
+    try
+    {
+      ifstream_type ist(source_path.c_str());
+      reader_type reader(ist, specs);
+      Output out(tmp_path);
+      FileHeader header;
+      ::std::memset(&header, 0, sizeof(header));
+      out.write(&header, 1);
+
+      const ::std::size_t columns = types.size();
+      ::std::vector<ColumnBuilder> builders(columns);
+      for(::std::size_t c = 0; c < columns; c++)
+      {
+        builders[c].type = types[c];
+      }
+      ::std::vector< ::std::uint32_t> sizes;
+      ::std::vector<GroupEntry> groups;
+      ::std::uint64_t rows = 0;
+      auto flush = [&]()
+      {
+        groups.push_back(GroupEntry{out.write(sizes)});
+        for(auto & builder : builders)
+        {
+          builder.flush(out);
+        }
+        sizes.clear();
+      };
+      while(reader.nextRawRow())
+      {
+        const ::std::size_t row = sizes.size();
+        const ::std::size_t n = reader.rawRowSize();
+        sizes.push_back(::std::uint32_t(n));
+        if(row % 8 == 0)
+        {
+          for(auto & builder : builders)
+          {
+            builder.validity.push_back(0);
+          }
+        }
+        for(::std::size_t c = 0; c < columns; c++)
+        {
+          if(c < n)
+          {
+            reader.rawCell(c, begin, end);
+          }
+          else
+          {
+            begin = end = nullptr;
+          }
+          builders[c].add(row, begin, end, locale);
+        }
+        rows++;
+        if(sizes.size() == row_group_size)
+        {
+          flush();
+        }
+      }
+      if(!sizes.empty())
+      {
+        flush();
+      }
+
+      ::std::vector<ColumnEntry> entries(columns);
+      const spec_type & names = reader.specification();
+      for(::std::size_t c = 0; c < columns; c++)
+      {
+        ColumnEntry & entry = entries[c];
+        string_type name = names.columnName(c);
+        entry.type        = ::std::uint64_t(types[c]);
+        entry.name_length = name.size();
+        entry.name        = out.write(name.data(), name.size());
+        const auto & dictionary = builders[c].dictionary;
+        ::std::vector< ::std::uint64_t> offsets(1, 0);
+        for(::std::size_t code = 0; code < dictionary.size(); code++)
+        {
+          offsets.push_back(offsets.back() + dictionary.length(code));
+        }
+        entry.dictionary_size    = dictionary.size();
+        entry.dictionary_offsets = out.write(offsets);
+        entry.dictionary_data    = out.pos();
+        for(::std::size_t code = 0; code < dictionary.size(); code++)
+        {
+          out.append(dictionary.data(code), dictionary.length(code));
+        }
+        out.pad();
+      }
+
+      header.directory = out.write(entries);
+      for(::std::size_t g = 0; g < groups.size(); g++)
+      {
+        out.append(&groups[g], 1);
+        for(auto & builder : builders)
+        {
+          out.append(&builder.chunks[g], 1);
+        }
+      }
+      ::std::memcpy(header.magic, "CSVCACHE", 8);
+      header.version        = version;
+      header.char_size      = sizeof(char_type);
+      header.source_size    = source_size;
+      header.source_mtime   = source_mtime;
+      header.spec_hash      = specs.hash();
+      header.rows           = rows;
+      header.columns        = columns;
+      header.row_group_size = row_group_size;
+      header.row_groups     = groups.size();
+      header.file_size      = out.pos();
+      out.writeAt(0, reinterpret_cast<const char *>(&header), sizeof(header));
+      out.close();
+    }
+    catch(...)
+    {
+      ::std::remove(tmp_path.c_str());
+      throw;
+    }
+    ::std::remove(cache_path.c_str());
+    if(::std::rename(tmp_path.c_str(), cache_path.c_str()) != 0)
+    {
+      ::std::remove(tmp_path.c_str());
+      throw CacheError("Cannot create cache file " + cache_path);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  bool BasicColumnarCache<CHAR, TRAITS>::load(const ::std::string & cache_path,
+                                              ::std::uint64_t source_size,
+                                              ::std::uint64_t source_mtime,
+                                              ::std::uint64_t spec_hash)
+  {
+    _header = nullptr;
+    _columns.clear();
+    _names.clear();
+    if(!_file.open(cache_path) || _file.size() < sizeof(FileHeader))
+    {
+      return false;
+    }
+    const FileHeader * header = at<FileHeader>(0);
+    if(::std::memcmp(header->magic, "CSVCACHE", 8) != 0 ||
+       header->version      != version ||
+       header->char_size    != sizeof(char_type) ||
+       header->file_size    != _file.size() ||
+       header->source_size  != source_size ||
+       header->source_mtime != source_mtime ||
+       header->spec_hash    != spec_hash)
+    {
+      _file.close();
+      return false;
+    }
+    if(!validate(*header))
+    {
+      _file.close();
+      return false;
+    }
+    _header = header;
+    const ColumnEntry * entries = at<ColumnEntry>(header->directory);
+    _columns.assign(entries, entries + header->columns);
+    _groups = at< ::std::uint64_t>(header->directory + 
+                                   header->columns * sizeof(ColumnEntry));
+    for(::std::size_t c = 0; c < _columns.size(); c++)
+    {
+      string_type name = columnName(c);
+      if(!name.empty())
+      {
+        _names.insert(::std::make_pair(name, c));
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Checks that the directory, the dictionaries and all row group 
+   * chunks lie within the mapped file before any of them is accessed.
+   */
+  template<typename CHAR, typename TRAITS>
+  bool BasicColumnarCache<CHAR, TRAITS>::validate(const FileHeader & header) const
+  {
+    const ::std::uint64_t size = _file.size();
+    // count elements of width bytes at offset, aligned and inside the file
+    auto inside = [size](::std::uint64_t offset, 
+                         ::std::uint64_t count, 
+                         ::std::uint64_t width)
+    {
+      return offset % (width < 8 ? width : 8) == 0 && offset <= size && 
+        count <= (size - offset) / width;
+    };
+    const ::std::uint64_t rows       = header.rows;
+    const ::std::uint64_t group_size = header.row_group_size;
+    if(group_size == 0 || 
+       header.row_groups != rows / group_size + (rows % group_size ? 1 : 0) ||
+       !inside(header.directory, header.columns, sizeof(ColumnEntry)))
+    {
+      return false;
+    }
+    const ::std::uint64_t columns     = header.columns;
+    const ::std::uint64_t group_table = header.directory + columns * sizeof(ColumnEntry);
+    if(!inside(group_table, header.row_groups, (1 + 2 * columns) * 8))
+    {
+      return false;
+    }
+    const ColumnEntry * entries = at<ColumnEntry>(header.directory);
+    for(::std::uint64_t c = 0; c < columns; c++)
+    {
+      const ColumnEntry & entry = entries[c];
+      if(entry.type > ::std::uint64_t(ColumnType::STRING) ||
+         !inside(entry.name, entry.name_length, sizeof(char_type)) ||
+         entry.dictionary_size > ::std::numeric_limits< ::std::uint32_t>::max() ||
+         !inside(entry.dictionary_offsets, entry.dictionary_size + 1, 8))
+      {
+        return false;
+      }
+      const ::std::uint64_t * offsets = at< ::std::uint64_t>(entry.dictionary_offsets);
+      for(::std::uint64_t code = 0; code < entry.dictionary_size; code++)
+      {
+        if(offsets[code] > offsets[code + 1])
+        {
+          return false;
+        }
+      }
+      if(offsets[0] != 0 ||
+         !inside(entry.dictionary_data, offsets[entry.dictionary_size], sizeof(char_type)))
+      {
+        return false;
+      }
+    }
+    const ::std::uint64_t * group = at< ::std::uint64_t>(group_table);
+    for(::std::uint64_t g = 0; g < header.row_groups; g++, group+= 1 + 2 * columns)
+    {
+      const ::std::uint64_t n = ::std::min(group_size, rows - g * group_size);
+      if(!inside(group[0], n, sizeof(::std::uint32_t)))
+      {
+        return false;
+      }
+      const ChunkEntry * chunks = reinterpret_cast<const ChunkEntry *>(group + 1);
+      for(::std::uint64_t c = 0; c < columns; c++)
+      {
+        const ::std::uint64_t width = 
+          ColumnType(entries[c].type) == ColumnType::STRING ? 
+          sizeof(::std::uint32_t) : sizeof(::std::int64_t);
+        if(!inside(chunks[c].validity, (n + 7) / 8, 1) || 
+           !inside(chunks[c].values, n, width))
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicColumnarCache<CHAR, TRAITS>::open(const ::std::string & source_path,
+                                              const ::std::string & cache_path,
+                                              spec_type specs,
+                                              ::std::size_t row_group_size)
+  {
+    ::std::uint64_t source_size;
+    ::std::uint64_t source_mtime;
+    if(!detail::fileStamp(source_path, source_size, source_mtime))
+    {
+      throw CacheError("Cannot read source file " + source_path);
+    }
+    _locale  = specs.locale();
+    _rebuilt = false;
+    if(load(cache_path, source_size, source_mtime, specs.hash()))
+    {
+      return;
+    }
+    save(source_path, cache_path, specs, row_group_size);
+    _rebuilt = true;
+    if(!load(cache_path, source_size, source_mtime, specs.hash()))
+    {
+      throw CacheError("Cannot load cache file " + cache_path);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline typename BasicColumnarCache<CHAR, TRAITS>::string_type
+  BasicColumnarCache<CHAR, TRAITS>::columnName(::std::size_t column) const
+  {
+    const ColumnEntry & entry = _columns[column];
+    const char_type * name = at<char_type>(entry.name);
+    return string_type(name, name + entry.name_length);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t 
+  BasicColumnarCache<CHAR, TRAITS>::columnIndex(const string_type & name) const
+  {
+    auto itr = _names.find(name);
+    return itr == _names.end() ? spec_type::npos : itr->second;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ColumnType BasicColumnarCache<CHAR, TRAITS>::type(::std::size_t column) const
+  {
+    return ColumnType(_columns[column].type);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline const typename BasicColumnarCache<CHAR, TRAITS>::ChunkEntry &
+  BasicColumnarCache<CHAR, TRAITS>::chunk(::std::size_t i, ::std::size_t column) const
+  {
+    const ::std::size_t g = i / _header->row_group_size;
+    const ::std::uint64_t * group = _groups + g * (1 + 2 * _columns.size());
+    return reinterpret_cast<const ChunkEntry *>(group + 1)[column];
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicColumnarCache<CHAR, TRAITS>::rowSize(::std::size_t i) const
+  {
+    const ::std::size_t g = i / _header->row_group_size;
+    const ::std::uint64_t * group = _groups + g * (1 + 2 * _columns.size());
+    return at< ::std::uint32_t>(group[0])[i % _header->row_group_size];
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline bool BasicColumnarCache<CHAR, TRAITS>::isNull(::std::size_t i, 
+                                                       ::std::size_t column) const
+  {
+    if(column >= _columns.size())
+    {
+      return true;
+    }
+    const ::std::size_t r = i % _header->row_group_size;
+    const ::std::uint8_t * validity = at< ::std::uint8_t>(chunk(i, column).validity);
+    return !(validity[r / 8] & (1u << (r % 8)));
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicColumnarCache<CHAR, TRAITS>::cellData(::std::size_t i, 
+                                                         ::std::size_t column,
+                                                         const char_type *& begin,
+                                                         const char_type *& end) const
+  {
+    if(isNull(i, column) || type(column) != ColumnType::STRING)
+    {
+      begin = end = nullptr;
+      return;
+    }
+    const ColumnEntry & entry = _columns[column];
+    const ::std::uint32_t code = 
+      at< ::std::uint32_t>(chunk(i, column).values)[i % _header->row_group_size];
+    if(code >= entry.dictionary_size)
+    {
+      throw CacheError("Corrupt cache file, invalid dictionary code.");
+    }
+    const ::std::uint64_t * offsets = at< ::std::uint64_t>(entry.dictionary_offsets);
+    const char_type * data = at<char_type>(entry.dictionary_data);
+    begin = data + offsets[code];
+    end   = data + offsets[code + 1];
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename NUMBER, typename RET>
+  inline typename ::std::enable_if< detail::IsDirectConversion<NUMBER, RET>::value, bool>::type
+  BasicColumnarCache<CHAR, TRAITS>::convert(NUMBER number, RET & value, 
+                                            const ::std::locale &)
+  {
+    if(::std::is_integral<RET>::value)
+    {
+      // integer columns are int64, narrower targets are range checked
+      if(static_cast<long long>(number) < 
+         static_cast<long long>(::std::numeric_limits<RET>::lowest()) ||
+         static_cast<long long>(number) > 
+         static_cast<long long>(::std::numeric_limits<RET>::max()))
+      {
+        return false;
+      }
+    }
+    value = static_cast<RET>(number);
+    return true;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename NUMBER, typename RET>
+  inline typename ::std::enable_if<!detail::IsDirectConversion<NUMBER, RET>::value, bool>::type
+  BasicColumnarCache<CHAR, TRAITS>::convert(NUMBER number, RET & value, 
+                                            const ::std::locale & locale)
+  {
+    // same as converting the text of the cell
+    string_type text;
+    BasicFormatter<char_type, char_traits, NUMBER>::format(text, number, locale);
+    return BasicSerializer<char_type, char_traits, RET>::parse(text.data(), 
+                                                              text.data() + text.size(),
+                                                              locale, 
+                                                              value);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename RET>
+  bool BasicColumnarCache<CHAR, TRAITS>::tryAs(::std::size_t i, 
+                                               ::std::size_t column, 
+                                               RET & value) const
+  {
+    typedef BasicSerializer<char_type, char_traits, RET> serializer_type;
+    const char_type * begin = nullptr;
+    const char_type * end   = nullptr;
+    if(!isNull(i, column))
+    {
+      const ::std::size_t r = i % _header->row_group_size;
+      switch(type(column))
+      {
+      case ColumnType::INT64:
+        return convert(at< ::std::int64_t>(chunk(i, column).values)[r], value, _locale);
+      case ColumnType::DOUBLE:
+        return convert(at<double>(chunk(i, column).values)[r], value, _locale);
+      case ColumnType::STRING:
+        cellData(i, column, begin, end);
+        break;
+      }
+    }
+    return serializer_type::parse(begin, end, _locale, value);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename RET>
+  RET BasicColumnarCache<CHAR, TRAITS>::as(::std::size_t i, 
+                                           ::std::size_t column) const
+  {
+    RET value;
+    if(!tryAs(i, column, value))
+    {
+      ::std::type_index ti(typeid(RET));
+      throw ConversionError(::std::string("Cannot convert cell content ") + ti.name(),
+                            ti, 0, 0, i, column);
+    }
+    return value;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  typename BasicColumnarCache<CHAR, TRAITS>::CachedCell 
+  BasicColumnarCache<CHAR, TRAITS>::CachedRow::operator[](::std::size_t i) const
+  {
+    const ::std::size_t n = size();
+    if(i >= n)
+    {
+      throw CellOutOfRangeError("Cell index " + ::std::to_string(i) + 
+                                " out of range [0," + ::std::to_string(n) + ")",
+                                i, n, 0, 0, _row, i);
+    }
+    return CachedCell(_cache, _row, i);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  typename BasicColumnarCache<CHAR, TRAITS>::CachedCell 
+  BasicColumnarCache<CHAR, TRAITS>::CachedRow::operator[](const string_type & name) const
+  {
+    const ::std::size_t i = _cache->columnIndex(name);
+    const ::std::size_t n = size();
+    if(i == spec_type::npos)
+    {
+      throw UndefinedColumnError("Accessing undefined column by name.",
+                                 n, 0, 0, _row, 0);
+    }
+    else if(i >= n)
+    {
+      throw DefinedCellOutOfRangeError("Column " + ::std::to_string(i) + 
+                                       " out of range [0," + ::std::to_string(n) + ")",
+                                       i, n, 0, 0, _row, i);
+    }
+    return CachedCell(_cache, _row, i);
+  }
+}
@@ -0,0 +1,548 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <istream>
+#include <fstream>
+#include <streambuf>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstring>
+#include <algorithm>
+#include <zlib.h>
+#ifdef CSV_WITH_ZSTD
+#include <zstd.h>
+#endif
+#include "csv_common.h"
+
+namespace csv
+{
+  enum class Compression
+  {
+    AUTO,
+    NONE,
+    GZIP,
+    ZSTD
+  };
+
+  /**
+   * Stream buffer that decompresses a gzip (or zstd) compressed source.
+   *
+   * Decompression runs on a separate thread into two blocks. While the
+   * reader tokenizes one block, the next one is being decompressed.
+   * With Compression::AUTO the format is detected from the magic bytes,
+   * uncompressed input is passed through.
+   */
+  class CompressedInputBuffer : public ::std::streambuf
+  {
+  public:
+    static const ::std::size_t default_block_size = 1u << 20;
+
+    CompressedInputBuffer(::std::istream & source,
+                          Compression      compression = Compression::AUTO,
+                          ::std::size_t    block_size  = default_block_size);
+    ~CompressedInputBuffer();
+
+    CompressedInputBuffer(const CompressedInputBuffer &) = delete;
+    CompressedInputBuffer & operator=(const CompressedInputBuffer &) = delete;
+
+    inline Compression compression() const;
+
+  protected:
+    int_type underflow() override;
+
+  private:
+    class Source
+    {
+    public:
+      Source(::std::istream & ist);
+      inline ::std::size_t available() const;
+      inline const char * data() const;
+      inline void consume(::std::size_t n);
+      ::std::size_t fill();
+    private:
+      ::std::istream    & _ist;
+      ::std::vector<char> _buffer;
+      ::std::size_t       _begin;
+      ::std::size_t       _end;
+    };
+
+    class Decoder
+    {
+    public:
+      virtual ~Decoder() {}
+      /* returns 0 if the end of the compressed data has been reached */
+      virtual ::std::size_t decode(char * out, ::std::size_t size) = 0;
+    };
+
+    class PlainDecoder;
+    class GzipDecoder;
+#ifdef CSV_WITH_ZSTD
+    class ZstdDecoder;
+#endif
+
+    struct Block
+    {
+      ::std::vector<char> data;
+      ::std::size_t       size;
+      bool                filled;
+      bool                last;
+      /* set if decompression failed after the data of this block */
+      ::std::exception_ptr error;
+    };
+
+    void run();
+
+    Source                      _source;
+    Compression                 _compression;
+    ::std::unique_ptr<Decoder>  _decoder;
+    Block                       _blocks[2];
+    ::std::size_t               _current;
+    bool                        _consuming;
+    bool                        _stop;
+    ::std::mutex                _mutex;
+    ::std::condition_variable   _cond;
+    ::std::thread               _thread;
+  };
+
+  /**
+   * Input stream over a CompressedInputBuffer, can be passed directly
+   * to BasicReader. Decompression errors are rethrown as
+   * DecompressionError.
+   */
+  class CompressedInputStream : public ::std::istream
+  {
+  public:
+    CompressedInputStream(::std::istream & source,
+                          Compression      compression = Compression::AUTO,
+                          ::std::size_t    block_size  =
+                            CompressedInputBuffer::default_block_size);
+
+    CompressedInputStream(const ::std::string & filename,
+                          Compression           compression = Compression::AUTO,
+                          ::std::size_t         block_size  =
+                            CompressedInputBuffer::default_block_size);
+
+    inline Compression compression() const;
+
+  private:
+    static ::std::istream & open(::std::unique_ptr<::std::ifstream> & file,
+                                 const ::std::string & filename);
+
+    ::std::unique_ptr<::std::ifstream> _file;
+    CompressedInputBuffer              _buffer;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////////
+
+  // Source
+  inline CompressedInputBuffer::Source::Source(::std::istream & ist)
+    : _ist(ist), _buffer(1u << 18), _begin(0), _end(0)
+  {
+  }
+
+  inline ::std::size_t CompressedInputBuffer::Source::available() const
+  {
+    return _end - _begin;
+  }
+
+  inline const char * CompressedInputBuffer::Source::data() const
+  {
+    return _buffer.data() + _begin;
+  }
+
+  inline void CompressedInputBuffer::Source::consume(::std::size_t n)
+  {
+    _begin+= n;
+  }
+
+  inline ::std::size_t CompressedInputBuffer::Source::fill()
+  {
+    if(_begin == _end)
+    {
+      _begin = 0;
+      _end   = 0;
+    }
+    if(_end < _buffer.size() && _ist.good())
+    {
+      _ist.read(_buffer.data() + _end, _buffer.size() - _end);
+      _end+= static_cast<::std::size_t>(_ist.gcount());
+      if(_ist.bad())
+      {
+        throw DecompressionError("Cannot read compressed input.");
+      }
+    }
+    return available();
+  }
+
+  // Decoders
+  class CompressedInputBuffer::PlainDecoder : public Decoder
+  {
+  public:
+    PlainDecoder(Source & source) : _source(source) {}
+
+    ::std::size_t decode(char * out, ::std::size_t size) override
+    {
+      if(!_source.available())
+      {
+        _source.fill();
+      }
+      ::std::size_t n = ::std::min(size, _source.available());
+      ::std::memcpy(out, _source.data(), n);
+      _source.consume(n);
+      return n;
+    }
+
+  private:
+    Source & _source;
+  };
+
+  class CompressedInputBuffer::GzipDecoder : public Decoder
+  {
+  public:
+    GzipDecoder(Source & source) : _source(source), _in_member(true)
+    {
+      ::std::memset(&_zs, 0, sizeof(_zs));
+      // 15 window bits, +32 detects gzip and zlib headers
+      if(inflateInit2(&_zs, 15 + 32) != Z_OK)
+      {
+        throw DecompressionError("Cannot initialize zlib.");
+      }
+    }
+
+    ~GzipDecoder()
+    {
+      inflateEnd(&_zs);
+    }
+
+    ::std::size_t decode(char * out, ::std::size_t size) override
+    {
+      _zs.next_out  = reinterpret_cast<Bytef*>(out);
+      _zs.avail_out = static_cast<uInt>(size);
+      while(_zs.avail_out > 0)
+      {
+        if(!_source.available() && !_source.fill())
+        {
+          if(_in_member)
+          {
+            throw DecompressionError("Unexpected end of gzip stream.");
+          }
+          break;
+        }
+        if(!_in_member)
+        {
+          // concatenated gzip members
+          inflateReset(&_zs);
+          _in_member = true;
+        }
+        _zs.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(_source.data()));
+        _zs.avail_in = static_cast<uInt>(_source.available());
+        int ret = inflate(&_zs, Z_NO_FLUSH);
+        _source.consume(_source.available() - _zs.avail_in);
+        if(ret == Z_STREAM_END)
+        {
+          _in_member = false;
+        }
+        else if(ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+          throw DecompressionError(::std::string("gzip: ") +
+                                   (_zs.msg ? _zs.msg : "invalid data"));
+        }
+      }
+      return size - _zs.avail_out;
+    }
+
+  private:
+    Source & _source;
+    z_stream _zs;
+    bool     _in_member;
+  };
+
+#ifdef CSV_WITH_ZSTD
+  class CompressedInputBuffer::ZstdDecoder : public Decoder
+  {
+  public:
+    ZstdDecoder(Source & source)
+      : _source(source), _stream(ZSTD_createDStream()), _in_frame(true)
+    {
+      if(!_stream || ZSTD_isError(ZSTD_initDStream(_stream)))
+      {
+        throw DecompressionError("Cannot initialize zstd.");
+      }
+    }
+
+    ~ZstdDecoder()
+    {
+      ZSTD_freeDStream(_stream);
+    }
+
+    ::std::size_t decode(char * out, ::std::size_t size) override
+    {
+      ZSTD_outBuffer output = { out, size, 0 };
+      while(output.pos < output.size)
+      {
+        if(!_source.available() && !_source.fill())
+        {
+          if(_in_frame)
+          {
+            throw DecompressionError("Unexpected end of zstd stream.");
+          }
+          break;
+        }
+        ZSTD_inBuffer input = { _source.data(), _source.available(), 0 };
+        ::std::size_t ret = ZSTD_decompressStream(_stream, &output, &input);
+        _source.consume(input.pos);
+        if(ZSTD_isError(ret))
+        {
+          throw DecompressionError(::std::string("zstd: ") +
+                                   ZSTD_getErrorName(ret));
+        }
+        _in_frame = (ret != 0);
+      }
+      return output.pos;
+    }
+
+  private:
+    Source        & _source;
+    ZSTD_DStream  * _stream;
+    bool            _in_frame;
+  };
+#endif
+
+  // CompressedInputBuffer
+  inline CompressedInputBuffer::CompressedInputBuffer(::std::istream & source,
+                                                      Compression compression,
+                                                      ::std::size_t block_size)
+    : _source(source),
+      _compression(compression),
+      _current(0),
+      _consuming(false),
+      _stop(false)
+  {
+    if(_compression == Compression::AUTO)
+    {
+      ::std::size_t n = _source.fill();
+      const unsigned char * magic =
+        reinterpret_cast<const unsigned char*>(_source.data());
+      if(n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+      {
+        _compression = Compression::GZIP;
+      }
+      else if(n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+              magic[2] == 0x2f && magic[3] == 0xfd)
+      {
+        _compression = Compression::ZSTD;
+      }
+      else
+      {
+        _compression = Compression::NONE;
+      }
+    }
+    switch(_compression)
+    {
+    case Compression::GZIP:
+      _decoder.reset(new GzipDecoder(_source));
+      break;
+    case Compression::ZSTD:
+#ifdef CSV_WITH_ZSTD
+      _decoder.reset(new ZstdDecoder(_source));
+      break;
+#else
+      throw DecompressionError("zstd support has not been compiled in.");
+#endif
+    default:
+      _decoder.reset(new PlainDecoder(_source));
+      break;
+    }
+    for(auto & block : _blocks)
+    {
+      block.data.resize(block_size ? block_size : 1u);
+      block.size   = 0;
+      block.filled = false;
+      block.last   = false;
+    }
+    setg(nullptr, nullptr, nullptr);
+    _thread = ::std::thread(&CompressedInputBuffer::run, this);
+  }
+
+  inline CompressedInputBuffer::~CompressedInputBuffer()
+  {
+    {
+      ::std::lock_guard<::std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _cond.notify_all();
+    _thread.join();
+  }
+
+  inline Compression CompressedInputBuffer::compression() const
+  {
+    return _compression;
+  }
+
+  inline void CompressedInputBuffer::run()
+  {
+    ::std::size_t i = 0;
+    while(true)
+    {
+      Block & block = _blocks[i];
+      {
+        ::std::unique_lock<::std::mutex> lock(_mutex);
+        _cond.wait(lock, [this, &block]{ return _stop || !block.filled; });
+        if(_stop)
+        {
+          return;
+        }
+      }
+      bool last = false;
+      ::std::exception_ptr error;
+      ::std::size_t size = 0;
+      try
+      {
+        while(size < block.data.size())
+        {
+          ::std::size_t n = _decoder->decode(block.data.data() + size,
+                                             block.data.size() - size);
+          if(n == 0)
+          {
+            last = true;
+            break;
+          }
+          size+= n;
+        }
+      }
+      catch(...)
+      {
+        error = ::std::current_exception();
+        last  = true;
+      }
+      {
+        ::std::lock_guard<::std::mutex> lock(_mutex);
+        block.size   = size;
+        block.last   = last;
+        block.filled = true;
+        block.error  = error;
+      }
+      _cond.notify_all();
+      if(last)
+      {
+        return;
+      }
+      i^= 1;
+    }
+  }
+
+  inline CompressedInputBuffer::int_type CompressedInputBuffer::underflow()
+  {
+    if(gptr() < egptr())
+    {
+      return traits_type::to_int_type(*gptr());
+    }
+    ::std::unique_lock<::std::mutex> lock(_mutex);
+    if(_consuming)
+    {
+      if(_blocks[_current].last)
+      {
+        if(_blocks[_current].error)
+        {
+          ::std::rethrow_exception(_blocks[_current].error);
+        }
+        return traits_type::eof();
+      }
+      // hand the block back to the decompression thread
+      _blocks[_current].filled = false;
+      _consuming = false;
+      _current^= 1;
+      _cond.notify_all();
+    }
+    _cond.wait(lock, [this]{ return _blocks[_current].filled; });
+    Block & block = _blocks[_current];
+    // the data decompressed before an error is delivered first
+    if(block.error && block.size == 0)
+    {
+      ::std::rethrow_exception(block.error);
+    }
+    _consuming = true;
+    setg(block.data.data(), block.data.data(), block.data.data() + block.size);
+    if(block.size == 0)
+    {
+      return traits_type::eof();
+    }
+    return traits_type::to_int_type(*gptr());
+  }
+
+  // CompressedInputStream
+  inline CompressedInputStream::CompressedInputStream(::std::istream & source,
+                                                      Compression compression,
+                                                      ::std::size_t block_size)
+    : ::std::istream(nullptr),
+      _buffer(source, compression, block_size)
+  {
+    rdbuf(&_buffer);
+    exceptions(::std::ios::badbit);
+  }
+
+  inline CompressedInputStream::CompressedInputStream(const ::std::string & filename,
+                                                      Compression compression,
+                                                      ::std::size_t block_size)
+    : ::std::istream(nullptr),
+      _buffer(open(_file, filename), compression, block_size)
+  {
+    rdbuf(&_buffer);
+    exceptions(::std::ios::badbit);
+  }
+
+  inline Compression CompressedInputStream::compression() const
+  {
+    return _buffer.compression();
+  }
+
+  inline ::std::istream &
+  CompressedInputStream::open(::std::unique_ptr<::std::ifstream> & file,
+                              const ::std::string & filename)
+  {
+    file.reset(new ::std::ifstream(filename.c_str(), ::std::ios::binary));
+    if(!file->is_open())
+    {
+      throw DecompressionError("Cannot open file " + filename);
+    }
+    return *file;
+  }
+
+} // namespace csv
@@ -34,6 +34,7 @@ either expressed or implied, of the FreeBSD Project.
 #include <exception>
 #include <string>
 #include <typeindex>
+#include <vector>
 
 namespace csv
 {
@@ -52,10 +53,42 @@ namespace csv
   template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
   class BasicReader;
 
+  template<typename OBJECT, typename CHAR, typename TRAITS>
+  class BasicBuilder;
+
   template<typename CLASS, typename CHAR=char,
-           typename TRAITS=::std::char_traits<CHAR> >
+           typename TRAITS=::std::char_traits<CHAR>,
+           typename BUILDER=BasicBuilder<CLASS, CHAR, TRAITS> >
   class BasicObjectReader;
 
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicWriter;
+
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicDictionary;
+
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicAggregator;
+
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicSorter;
+
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicHashJoin;
+
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicColumnarCache;
+
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicArrowWriter;
+
+  template<typename CHAR=char, typename TRAITS=::std::char_traits<CHAR> >
+  class BasicJsonlWriter;
+
+  template<typename CLASS, typename CHAR=char,
+           typename TRAITS=::std::char_traits<CHAR> >
+  class BasicObjectWriter;
+
   typedef BasicSpecification<char, char_traits> Specification;
   typedef BasicCell<char, char_traits> Cell;
   typedef BasicRow<char, char_traits> Row;
@@ -64,6 +97,22 @@ namespace csv
   typedef BasicCell<wchar_t, wchar_traits> WCell;
   typedef BasicRow<wchar_t, wchar_traits> WRow;
   typedef BasicReader<wchar_t, wchar_traits> WReader;
+  typedef BasicWriter<char, char_traits> Writer;
+  typedef BasicWriter<wchar_t, wchar_traits> WWriter;
+  typedef BasicDictionary<char, char_traits> Dictionary;
+  typedef BasicDictionary<wchar_t, wchar_traits> WDictionary;
+  typedef BasicAggregator<char, char_traits> Aggregator;
+  typedef BasicAggregator<wchar_t, wchar_traits> WAggregator;
+  typedef BasicSorter<char, char_traits> Sorter;
+  typedef BasicSorter<wchar_t, wchar_traits> WSorter;
+  typedef BasicHashJoin<char, char_traits> HashJoin;
+  typedef BasicHashJoin<wchar_t, wchar_traits> WHashJoin;
+  typedef BasicColumnarCache<char, char_traits> ColumnarCache;
+  typedef BasicColumnarCache<wchar_t, wchar_traits> WColumnarCache;
+  typedef BasicArrowWriter<char, char_traits> ArrowWriter;
+  typedef BasicArrowWriter<wchar_t, wchar_traits> WArrowWriter;
+  typedef BasicJsonlWriter<char, char_traits> JsonlWriter;
+  typedef BasicJsonlWriter<wchar_t, wchar_traits> WJsonlWriter;
 
   class CsvException : public ::std::exception
   {
@@ -193,6 +242,76 @@ namespace csv
     ::std::type_index _type_index;
   };
 
+  class DecompressionError : public CsvException
+  {
+  public:
+    DecompressionError( const ::std::string & message );
+  };
+
+  class TemporaryFileError : public CsvException
+  {
+  public:
+    TemporaryFileError( const ::std::string & message );
+  };
+
+  class CacheError : public CsvException
+  {
+  public:
+    CacheError( const ::std::string & message );
+  };
+
+  /**
+   * Kinds of malformed input skipped by a lenient reader.
+   */
+  enum class ParseErrorCode
+  {
+    UNEXPECTED_CHARACTER_AFTER_QUOTE,
+    UNTERMINATED_QUOTE
+  };
+
+  inline const char * parseErrorMessage(ParseErrorCode code);
+
+  struct ParseErrorRecord
+  {
+    // number of characters read before the error
+    ::std::size_t  offset;
+    ::std::size_t  input_line;
+    ::std::size_t  input_column;
+    ::std::size_t  row;
+    ::std::size_t  column;
+    ParseErrorCode code;
+  };
+
+  /**
+   * Bounded log of parse errors. The first capacity() errors are kept,
+   * later ones are only counted.
+   */
+  class ParseErrorLog
+  {
+  public:
+    typedef ::std::vector<ParseErrorRecord>::const_iterator const_iterator;
+
+    ParseErrorLog(::std::size_t capacity = 1000);
+
+    inline void add(const ParseErrorRecord & record);
+    inline void clear();
+
+    /** number of kept records */
+    inline ::std::size_t size() const;
+    /** number of errors including those not kept */
+    inline ::std::size_t count() const;
+    inline ::std::size_t capacity() const;
+    inline bool empty() const;
+    inline const ParseErrorRecord & operator[](::std::size_t i) const;
+    inline const_iterator begin() const;
+    inline const_iterator end() const;
+
+  private:
+    ::std::vector<ParseErrorRecord> _records;
+    ::std::size_t                   _capacity;
+    ::std::size_t                   _count;
+  };
+
   ////////////////////////////////////////////////////////////////////////////
   //
   // Implementation
@@ -379,4 +498,82 @@ namespace csv
     return _type_index;
   }
 
+  inline DecompressionError::DecompressionError( const ::std::string & message )
+    : CsvException(message, 0, 0, 0, 0)
+  {}
+
+  inline TemporaryFileError::TemporaryFileError( const ::std::string & message )
+    : CsvException(message, 0, 0, 0, 0)
+  {}
+
+  inline CacheError::CacheError( const ::std::string & message )
+    : CsvException(message, 0, 0, 0, 0)
+  {}
+
+  inline const char * parseErrorMessage(ParseErrorCode code)
+  {
+    switch(code)
+    {
+    case ParseErrorCode::UNEXPECTED_CHARACTER_AFTER_QUOTE:
+      return "Unexpected character at the end of quoted cell.";
+    case ParseErrorCode::UNTERMINATED_QUOTE:
+      return "Unexpected end of input in quoted cell.";
+    }
+    return "Parse error.";
+  }
+
+  inline ParseErrorLog::ParseErrorLog(::std::size_t capacity)
+    : _capacity(capacity), _count(0)
+  {}
+
+  inline void ParseErrorLog::add(const ParseErrorRecord & record)
+  {
+    if(_records.size() < _capacity)
+    {
+      _records.push_back(record);
+    }
+    _count++;
+  }
+
+  inline void ParseErrorLog::clear()
+  {
+    _records.clear();
+    _count = 0;
+  }
+
+  inline ::std::size_t ParseErrorLog::size() const
+  {
+    return _records.size();
+  }
+
+  inline ::std::size_t ParseErrorLog::count() const
+  {
+    return _count;
+  }
+
+  inline ::std::size_t ParseErrorLog::capacity() const
+  {
+    return _capacity;
+  }
+
+  inline bool ParseErrorLog::empty() const
+  {
+    return _count == 0;
+  }
+
+  inline const ParseErrorRecord & ParseErrorLog::operator[](::std::size_t i) const
+  {
+    return _records[i];
+  }
+
+  inline ParseErrorLog::const_iterator ParseErrorLog::begin() const
+  {
+    return _records.begin();
+  }
+
+  inline ParseErrorLog::const_iterator ParseErrorLog::end() const
+  {
+    return _records.end();
+  }
+
 } // namespace
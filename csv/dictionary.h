@@ -0,0 +1,245 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "csv_common.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "flat_hash_map.h"
+
+namespace csv
+{
+  /**
+   * Set of distinct cell values of a column. Each value is stored once 
+   * and identified by a code, codes are assigned in order of first 
+   * occurrence starting at 0.
+   * Interning is not synchronized; values of existing codes are never 
+   * moved, cells referring to them may be read while the reader interns 
+   * further values.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicDictionary
+  {
+  public:
+    typedef CHAR                                          char_type;
+    typedef TRAITS                                        char_traits;
+    typedef ::std::basic_string<char_type, char_traits>   string_type;
+    typedef ::std::vector<char_type, 
+                          ArenaAllocator<char_type> >     buffer_type;
+    typedef ::std::shared_ptr<buffer_type>                shared_buffer_type;
+
+    static const ::std::size_t npos = ::std::size_t(-1);
+    static const ::std::size_t default_chunk_size = 1 << 16;
+
+    BasicDictionary(::std::size_t chunk_size = default_chunk_size);
+
+    /**
+     * Returns the code of the value [begin, end), adds the value if
+     * it is not in the dictionary yet.
+     */
+    ::std::size_t intern(const char_type * begin, const char_type * end);
+
+    /**
+     * Returns the code of value or npos.
+     */
+    ::std::size_t code(const string_type & value) const;
+    ::std::size_t code(const char_type * begin, const char_type * end) const;
+
+    inline ::std::size_t size() const { return _entries.size(); }
+    inline string_type value(::std::size_t code) const;
+    inline const char_type * data(::std::size_t code) const;
+    inline ::std::size_t length(::std::size_t code) const;
+
+    /** Buffer holding the value of code and its offset in this buffer */
+    inline const shared_buffer_type & buffer(::std::size_t code) const;
+    inline ::std::size_t offset(::std::size_t code) const;
+
+    /** Heap bytes of the values and of the lookup table */
+    ::std::size_t memoryUsage() const;
+
+  private:
+    struct Entry
+    {
+      ::std::size_t _chunk;
+      ::std::size_t _offset;
+      ::std::size_t _length;
+    };
+
+    struct Key
+    {
+      const char_type * _data;
+      ::std::size_t     _length;
+    };
+
+    struct KeyHash
+    {
+      inline ::std::size_t operator()(const Key & key) const
+      {
+        return hashChars(key._data, key._length);
+      }
+    };
+
+    struct KeyEqual
+    {
+      inline bool operator()(const Key & a, const Key & b) const
+      {
+        return a._length == b._length && 
+          char_traits::compare(a._data, b._data, a._length) == 0;
+      }
+    };
+
+    ::std::size_t                                   _chunk_size;
+    ::std::size_t                                   _current;
+    ::std::vector<shared_buffer_type>               _chunks;
+    ::std::vector<Entry>                            _entries;
+    FlatHashMap<Key, ::std::size_t, KeyHash, KeyEqual> _codes;
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicDictionary<CHAR, TRAITS>::npos;
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicDictionary<CHAR, TRAITS>::default_chunk_size;
+
+  template<typename CHAR, typename TRAITS>
+  BasicDictionary<CHAR, TRAITS>::BasicDictionary(::std::size_t chunk_size)
+    : _chunk_size(chunk_size ? chunk_size : default_chunk_size),
+      _current(npos)
+  {
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicDictionary<CHAR, TRAITS>::intern(const char_type * begin,
+                                                      const char_type * end)
+  {
+    Key key = { begin, ::std::size_t(end - begin) };
+    auto itr = _codes.find(key);
+    if(itr != _codes.end())
+    {
+      return itr->second;
+    }
+    // chunks never grow beyond their reserved size, values keep their address
+    if(_current == npos || 
+       _chunks[_current]->capacity() - _chunks[_current]->size() < key._length)
+    {
+      auto chunk = ::std::make_shared<buffer_type>();
+      chunk->reserve(key._length > _chunk_size ? key._length : _chunk_size);
+      _chunks.push_back(chunk);
+      if(key._length <= _chunk_size)
+      {
+        _current = _chunks.size() - 1;
+      }
+    }
+    ::std::size_t chunk = key._length > _chunk_size ? _chunks.size() - 1 : _current;
+    buffer_type & storage = *_chunks[chunk];
+    Entry entry = { chunk, storage.size(), key._length };
+    storage.insert(storage.end(), begin, end);
+    key._data = storage.data() + entry._offset;
+    _entries.push_back(entry);
+    _codes.insert(::std::make_pair(key, _entries.size() - 1));
+    return _entries.size() - 1;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t 
+  BasicDictionary<CHAR, TRAITS>::code(const string_type & value) const
+  {
+    return code(value.data(), value.data() + value.size());
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t 
+  BasicDictionary<CHAR, TRAITS>::code(const char_type * begin, 
+                                      const char_type * end) const
+  {
+    Key key = { begin, ::std::size_t(end - begin) };
+    auto itr = _codes.find(key);
+    return itr == _codes.end() ? npos : itr->second;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline typename BasicDictionary<CHAR, TRAITS>::string_type
+  BasicDictionary<CHAR, TRAITS>::value(::std::size_t code) const
+  {
+    return string_type(data(code), _entries[code]._length);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline const typename BasicDictionary<CHAR, TRAITS>::char_type *
+  BasicDictionary<CHAR, TRAITS>::data(::std::size_t code) const
+  {
+    const Entry & entry = _entries[code];
+    return _chunks[entry._chunk]->data() + entry._offset;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t 
+  BasicDictionary<CHAR, TRAITS>::length(::std::size_t code) const
+  {
+    return _entries[code]._length;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline const typename BasicDictionary<CHAR, TRAITS>::shared_buffer_type &
+  BasicDictionary<CHAR, TRAITS>::buffer(::std::size_t code) const
+  {
+    return _chunks[_entries[code]._chunk];
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t 
+  BasicDictionary<CHAR, TRAITS>::offset(::std::size_t code) const
+  {
+    return _entries[code]._offset;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicDictionary<CHAR, TRAITS>::memoryUsage() const
+  {
+    ::std::size_t ret = 
+      _chunks.capacity() * sizeof(shared_buffer_type) +
+      _entries.capacity() * sizeof(Entry) +
+      _codes.memoryUsage();
+    for(auto & chunk : _chunks)
+    {
+      ret += chunk->capacity() * sizeof(char_type);
+    }
+    return ret;
+  }
+}
@@ -0,0 +1,256 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <functional>
+
+namespace csv
+{
+  /**
+   * FNV-1a hash of a character range, the high bits are folded in
+   * since the tables index with the low bits.
+   */
+  template<typename CHAR>
+  inline ::std::size_t hashChars(const CHAR * data, ::std::size_t length)
+  {
+    ::std::uint64_t h = 14695981039346656037ull;
+    for(::std::size_t i = 0; i < length; i++)
+    {
+      h ^= ::std::uint64_t(data[i]);
+      h *= 1099511628211ull;
+    }
+    h ^= h >> 32;
+    return ::std::size_t(h);
+  }
+
+  template<typename STRING>
+  struct StringHash
+  {
+    inline ::std::size_t operator()(const STRING & str) const
+    {
+      return hashChars(str.data(), str.size());
+    }
+  };
+
+  /**
+   * Open addressing hash map with linear probing. 
+   * Entries are stored densely in insertion order, the probing table only 
+   * holds entry indices. Iterators are invalidated by insert().
+   * Elements cannot be erased.
+   */
+  template<typename KEY, 
+           typename VALUE, 
+           typename HASH  = ::std::hash<KEY>, 
+           typename EQUAL = ::std::equal_to<KEY> >
+  class FlatHashMap
+  {
+  public:
+    typedef KEY                                           key_type;
+    typedef VALUE                                         mapped_type;
+    typedef ::std::pair<KEY, VALUE>                       value_type;
+    typedef HASH                                          hasher;
+    typedef EQUAL                                         key_equal;
+    typedef typename ::std::vector<value_type>::iterator       iterator;
+    typedef typename ::std::vector<value_type>::const_iterator const_iterator;
+
+    FlatHashMap(const hasher & hash = hasher(), 
+                const key_equal & equal = key_equal());
+
+    inline iterator begin()             { return _entries.begin(); }
+    inline iterator end()               { return _entries.end();   }
+    inline const_iterator begin() const { return _entries.begin(); }
+    inline const_iterator end() const   { return _entries.end();   }
+    inline ::std::size_t size() const   { return _entries.size();  }
+    inline bool empty() const           { return _entries.empty(); }
+
+    inline iterator find(const key_type & key);
+    inline const_iterator find(const key_type & key) const;
+
+    ::std::pair<iterator, bool> insert(const value_type & value);
+    mapped_type & operator[](const key_type & key);
+
+    void clear();
+    void reserve(::std::size_t n);
+
+    /** Heap bytes of the entries and of the probing table */
+    inline ::std::size_t memoryUsage() const;
+
+  private:
+    typedef ::std::uint32_t slot_type;
+
+    hasher                        _hash;
+    key_equal                     _equal;
+    ::std::vector<value_type>     _entries;
+    ::std::vector< ::std::size_t> _hashes;
+    // 0: empty, i + 1: index of entry i
+    ::std::vector<slot_type>      _slots;
+
+    inline ::std::size_t lookup(const key_type & key, ::std::size_t hash) const;
+    void rehash(::std::size_t slots);
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  FlatHashMap<KEY, VALUE, HASH, EQUAL>::FlatHashMap(const hasher & hash,
+                                                    const key_equal & equal)
+    : _hash(hash), _equal(equal)
+  {
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  inline ::std::size_t 
+  FlatHashMap<KEY, VALUE, HASH, EQUAL>::lookup(const key_type & key,
+                                               ::std::size_t hash) const
+  {
+    if(_slots.empty())
+    {
+      return 0;
+    }
+    const ::std::size_t mask = _slots.size() - 1;
+    for(::std::size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+      slot_type slot = _slots[i];
+      if(slot == 0 || 
+         (_hashes[slot - 1] == hash && _equal(_entries[slot - 1].first, key)))
+      {
+        return i;
+      }
+    }
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::iterator
+  FlatHashMap<KEY, VALUE, HASH, EQUAL>::find(const key_type & key)
+  {
+    if(_slots.empty())
+    {
+      return end();
+    }
+    slot_type slot = _slots[lookup(key, _hash(key))];
+    return slot ? _entries.begin() + (slot - 1) : end();
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  inline typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::const_iterator
+  FlatHashMap<KEY, VALUE, HASH, EQUAL>::find(const key_type & key) const
+  {
+    if(_slots.empty())
+    {
+      return end();
+    }
+    slot_type slot = _slots[lookup(key, _hash(key))];
+    return slot ? _entries.begin() + (slot - 1) : end();
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  ::std::pair<typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::iterator, bool>
+  FlatHashMap<KEY, VALUE, HASH, EQUAL>::insert(const value_type & value)
+  {
+    // keep the load factor below 1/2
+    if(2 * (_entries.size() + 1) > _slots.size())
+    {
+      rehash(_slots.empty() ? 16 : 2 * _slots.size());
+    }
+    ::std::size_t hash = _hash(value.first);
+    ::std::size_t i = lookup(value.first, hash);
+    if(_slots[i])
+    {
+      return ::std::make_pair(_entries.begin() + (_slots[i] - 1), false);
+    }
+    _entries.push_back(value);
+    _hashes.push_back(hash);
+    _slots[i] = slot_type(_entries.size());
+    return ::std::make_pair(_entries.end() - 1, true);
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  typename FlatHashMap<KEY, VALUE, HASH, EQUAL>::mapped_type &
+  FlatHashMap<KEY, VALUE, HASH, EQUAL>::operator[](const key_type & key)
+  {
+    return insert(value_type(key, mapped_type())).first->second;
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  void FlatHashMap<KEY, VALUE, HASH, EQUAL>::clear()
+  {
+    _entries.clear();
+    _hashes.clear();
+    _slots.clear();
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  inline ::std::size_t FlatHashMap<KEY, VALUE, HASH, EQUAL>::memoryUsage() const
+  {
+    return 
+      _entries.capacity() * sizeof(value_type) +
+      _hashes.capacity() * sizeof(::std::size_t) +
+      _slots.capacity() * sizeof(slot_type);
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  void FlatHashMap<KEY, VALUE, HASH, EQUAL>::reserve(::std::size_t n)
+  {
+    ::std::size_t slots = 16;
+    while(slots < 2 * n)
+    {
+      slots *= 2;
+    }
+    if(slots > _slots.size())
+    {
+      rehash(slots);
+    }
+    _entries.reserve(n);
+    _hashes.reserve(n);
+  }
+
+  template<typename KEY, typename VALUE, typename HASH, typename EQUAL>
+  void FlatHashMap<KEY, VALUE, HASH, EQUAL>::rehash(::std::size_t slots)
+  {
+    _slots.assign(slots, slot_type(0));
+    const ::std::size_t mask = slots - 1;
+    for(::std::size_t k = 0; k < _entries.size(); k++)
+    {
+      ::std::size_t i = _hashes[k] & mask;
+      while(_slots[i])
+      {
+        i = (i + 1) & mask;
+      }
+      _slots[i] = slot_type(k + 1);
+    }
+  }
+}
@@ -0,0 +1,527 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <locale>
+#include <sstream>
+#include <string>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <type_traits>
+
+namespace csv
+{
+  /**
+   * Appends the textual representation of a value to a string.
+   *
+   * Integers are formatted with a digit-pair table and floating point
+   * numbers with the fewest significant digits that parse back to the 
+   * same value, all other types fall back to std::basic_ostream.
+   */
+  template<typename CHAR, typename TRAITS, typename SOURCE, typename ENABLE=void>
+  class BasicFormatter
+  {
+  public:
+    typedef CHAR                                             char_type;
+    typedef TRAITS                                           char_traits;
+    typedef SOURCE                                           source_type;
+    typedef std::basic_string<char_type, char_traits>        string_type;
+    typedef std::basic_ostringstream<char_type, char_traits> stream_type;
+
+    static void format(string_type & out, const source_type & value,
+                       const ::std::locale & locale = ::std::locale())
+    {
+      stream_type ss;
+      ss.imbue(locale);
+      ss << value;
+      out.append(ss.str());
+    }
+  };
+
+  template<typename CHAR, typename TRAITS>
+  class BasicFormatter<CHAR, TRAITS, std::basic_string<CHAR, TRAITS> >
+  {
+  public:
+    typedef CHAR                                      char_type;
+    typedef TRAITS                                    char_traits;
+    typedef std::basic_string<char_type, char_traits> string_type;
+    typedef string_type                               source_type;
+
+    static void format(string_type & out, const source_type & value,
+                       const ::std::locale & = ::std::locale())
+    {
+      out.append(value);
+    }
+  };
+
+  template<typename CHAR, typename TRAITS>
+  class BasicFormatter<CHAR, TRAITS, bool>
+  {
+  public:
+    typedef CHAR                                      char_type;
+    typedef TRAITS                                    char_traits;
+    typedef std::basic_string<char_type, char_traits> string_type;
+    typedef bool                                      source_type;
+
+    static void format(string_type & out, const source_type & value,
+                       const ::std::locale & = ::std::locale())
+    {
+      out.push_back(char_type(value ? '1' : '0'));
+    }
+  };
+
+  template<typename CHAR, typename TRAITS, typename SOURCE>
+  class BasicFormatter<CHAR, TRAITS, SOURCE,
+                       typename ::std::enable_if<
+                         ::std::is_integral<SOURCE>::value &&
+                         !::std::is_same<SOURCE, bool>::value &&
+                         !::std::is_same<SOURCE, char>::value &&
+                         !::std::is_same<SOURCE, signed char>::value &&
+                         !::std::is_same<SOURCE, unsigned char>::value &&
+                         !::std::is_same<SOURCE, CHAR>::value>::type>
+  {
+  public:
+    typedef CHAR                                      char_type;
+    typedef TRAITS                                    char_traits;
+    typedef std::basic_string<char_type, char_traits> string_type;
+    typedef SOURCE                                    source_type;
+    typedef typename ::std::make_unsigned<source_type>::type unsigned_type;
+
+    static void format(string_type & out, const source_type & value,
+                       const ::std::locale & = ::std::locale())
+    {
+      static const char digits[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+      char_type buffer[::std::numeric_limits<unsigned_type>::digits10 + 3];
+      char_type * end = buffer + sizeof(buffer) / sizeof(char_type);
+      char_type * pos = end;
+      bool negative = value < 0;
+      unsigned_type u = negative ? 
+        unsigned_type(0) - static_cast<unsigned_type>(value) : 
+        static_cast<unsigned_type>(value);
+      while(u >= 100)
+      {
+        unsigned idx = static_cast<unsigned>(u % 100) * 2;
+        u/= 100;
+        *--pos = char_type(digits[idx + 1]);
+        *--pos = char_type(digits[idx]);
+      }
+      if(u >= 10)
+      {
+        unsigned idx = static_cast<unsigned>(u) * 2;
+        *--pos = char_type(digits[idx + 1]);
+        *--pos = char_type(digits[idx]);
+      }
+      else
+      {
+        *--pos = char_type('0' + u);
+      }
+      if(negative)
+      {
+        *--pos = char_type('-');
+      }
+      out.append(pos, end);
+    }
+  };
+
+  namespace detail
+  {
+    /**
+     * Shortest decimal digits of a float or double with the Grisu2
+     * algorithm (Loitsch, "Printing Floating-Point Numbers Quickly and
+     * Accurately with Integers", PLDI 2010), after the reference 
+     * implementation, Copyright (c) 2009 Florian Loitsch, MIT license.
+     * The digits always parse back to the value and are the shortest
+     * such digits in all but very few cases.
+     */
+    struct DiyFp
+    {
+      ::std::uint64_t f;
+      int             e;
+
+      DiyFp(::std::uint64_t _f, int _e) : f(_f), e(_e) {}
+
+      /** upper 64 bits of the product, rounded */
+      static DiyFp mul(const DiyFp & x, const DiyFp & y)
+      {
+        const ::std::uint64_t u_lo = x.f & 0xFFFFFFFFu;
+        const ::std::uint64_t u_hi = x.f >> 32;
+        const ::std::uint64_t v_lo = y.f & 0xFFFFFFFFu;
+        const ::std::uint64_t v_hi = y.f >> 32;
+        const ::std::uint64_t p0 = u_lo * v_lo;
+        const ::std::uint64_t p1 = u_lo * v_hi;
+        const ::std::uint64_t p2 = u_hi * v_lo;
+        const ::std::uint64_t p3 = u_hi * v_hi;
+        ::std::uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+        q += ::std::uint64_t(1) << 31;
+        return DiyFp(p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32), x.e + y.e + 64);
+      }
+
+      static DiyFp normalize(DiyFp x)
+      {
+        while((x.f >> 63) == 0)
+        {
+          x.f <<= 1;
+          x.e--;
+        }
+        return x;
+      }
+    };
+
+    /** 
+     * Cached power c = f * 2^e ~ 10^k, such that the product with a 
+     * normalized value of binary exponent e_value has an exponent 
+     * in [-60, -32]
+     */
+    inline void cachedPower(int e_value, DiyFp & c, int & k)
+    {
+      static const ::std::uint64_t significands[] = {
+        0xAB70FE17C79AC6CAull, 0xFF77B1FCBEBCDC4Full, 0xBE5691EF416BD60Cull,
+        0x8DD01FAD907FFC3Cull, 0xD3515C2831559A83ull, 0x9D71AC8FADA6C9B5ull,
+        0xEA9C227723EE8BCBull, 0xAECC49914078536Dull, 0x823C12795DB6CE57ull,
+        0xC21094364DFB5637ull, 0x9096EA6F3848984Full, 0xD77485CB25823AC7ull,
+        0xA086CFCD97BF97F4ull, 0xEF340A98172AACE5ull, 0xB23867FB2A35B28Eull,
+        0x84C8D4DFD2C63F3Bull, 0xC5DD44271AD3CDBAull, 0x936B9FCEBB25C996ull,
+        0xDBAC6C247D62A584ull, 0xA3AB66580D5FDAF6ull, 0xF3E2F893DEC3F126ull,
+        0xB5B5ADA8AAFF80B8ull, 0x87625F056C7C4A8Bull, 0xC9BCFF6034C13053ull,
+        0x964E858C91BA2655ull, 0xDFF9772470297EBDull, 0xA6DFBD9FB8E5B88Full,
+        0xF8A95FCF88747D94ull, 0xB94470938FA89BCFull, 0x8A08F0F8BF0F156Bull,
+        0xCDB02555653131B6ull, 0x993FE2C6D07B7FACull, 0xE45C10C42A2B3B06ull,
+        0xAA242499697392D3ull, 0xFD87B5F28300CA0Eull, 0xBCE5086492111AEBull,
+        0x8CBCCC096F5088CCull, 0xD1B71758E219652Cull, 0x9C40000000000000ull,
+        0xE8D4A51000000000ull, 0xAD78EBC5AC620000ull, 0x813F3978F8940984ull,
+        0xC097CE7BC90715B3ull, 0x8F7E32CE7BEA5C70ull, 0xD5D238A4ABE98068ull,
+        0x9F4F2726179A2245ull, 0xED63A231D4C4FB27ull, 0xB0DE65388CC8ADA8ull,
+        0x83C7088E1AAB65DBull, 0xC45D1DF942711D9Aull, 0x924D692CA61BE758ull,
+        0xDA01EE641A708DEAull, 0xA26DA3999AEF774Aull, 0xF209787BB47D6B85ull,
+        0xB454E4A179DD1877ull, 0x865B86925B9BC5C2ull, 0xC83553C5C8965D3Dull,
+        0x952AB45CFA97A0B3ull, 0xDE469FBD99A05FE3ull, 0xA59BC234DB398C25ull,
+        0xF6C69A72A3989F5Cull, 0xB7DCBF5354E9BECEull, 0x88FCF317F22241E2ull,
+        0xCC20CE9BD35C78A5ull, 0x98165AF37B2153DFull, 0xE2A0B5DC971F303Aull,
+        0xA8D9D1535CE3B396ull, 0xFB9B7CD9A4A7443Cull, 0xBB764C4CA7A44410ull,
+        0x8BAB8EEFB6409C1Aull, 0xD01FEF10A657842Cull, 0x9B10A4E5E9913129ull,
+        0xE7109BFBA19C0C9Dull, 0xAC2820D9623BF429ull, 0x80444B5E7AA7CF85ull,
+        0xBF21E44003ACDD2Dull, 0x8E679C2F5E44FF8Full, 0xD433179D9C8CB841ull,
+        0x9E19DB92B4E31BA9ull
+      };
+      static const short exponents[] = {
+        -1060, -1034, -1007,  -980,  -954,  -927,  -901,  -874,  -847,  -821,
+         -794,  -768,  -741,  -715,  -688,  -661,  -635,  -608,  -582,  -555,
+         -529,  -502,  -475,  -449,  -422,  -396,  -369,  -343,  -316,  -289,
+         -263,  -236,  -210,  -183,  -157,  -130,  -103,   -77,   -50,   -24,
+            3,    30,    56,    83,   109,   136,   162,   189,   216,   242,
+          269,   295,   322,   348,   375,   402,   428,   455,   481,   508,
+          534,   561,   588,   614,   641,   667,   694,   720,   747,   774,
+          800,   827,   853,   880,   907,   933,   960,   986,  1013
+      };
+      // the table holds 10^k for k = -300, -292, ..., 324
+      const int f = -60 - e_value - 1;
+      const int min_k = (f * 78913) / (1 << 18) + int(f > 0);
+      const int index = (300 + min_k + 7) / 8;
+      c = DiyFp(significands[index], exponents[index]);
+      k = -300 + index * 8;
+    }
+
+    inline int largestPow10(::std::uint32_t n, ::std::uint32_t & pow10)
+    {
+      int digits = 1;
+      pow10 = 1;
+      while(digits < 10 && n / 10 >= pow10)
+      {
+        pow10 *= 10;
+        digits++;
+      }
+      return digits;
+    }
+
+    inline void grisu2Round(char * buffer, int length, ::std::uint64_t dist, 
+                            ::std::uint64_t delta, ::std::uint64_t rest, 
+                            ::std::uint64_t ten_k)
+    {
+      // move the last digit towards the value while staying in the interval
+      while(rest < dist && delta - rest >= ten_k &&
+            (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+      {
+        buffer[length - 1]--;
+        rest += ten_k;
+      }
+    }
+
+    /**
+     * Digits of the shortest decimal in [minus, plus] closest to w, 
+     * value = digits * 10^exponent.
+     */
+    inline void grisu2(char * buffer, int & length, int & exponent,
+                       DiyFp minus, DiyFp w, DiyFp plus)
+    {
+      DiyFp c(0, 0);
+      int k;
+      cachedPower(plus.e, c, k);
+      w     = DiyFp::mul(w, c);
+      minus = DiyFp::mul(minus, c);
+      plus  = DiyFp::mul(plus, c);
+      // conservative interval, the products are exact up to one ulp
+      minus.f++;
+      plus.f--;
+      exponent = -k;
+
+      ::std::uint64_t delta = plus.f - minus.f;
+      ::std::uint64_t dist  = plus.f - w.f;
+      const int             shift = -plus.e;
+      const ::std::uint64_t one   = ::std::uint64_t(1) << shift;
+      ::std::uint32_t p1 = ::std::uint32_t(plus.f >> shift);
+      ::std::uint64_t p2 = plus.f & (one - 1);
+      ::std::uint32_t pow10;
+      int n = largestPow10(p1, pow10);
+      length = 0;
+      // integral digits
+      while(n > 0)
+      {
+        buffer[length++] = char('0' + p1 / pow10);
+        p1 %= pow10;
+        n--;
+        const ::std::uint64_t rest = (::std::uint64_t(p1) << shift) + p2;
+        if(rest <= delta)
+        {
+          exponent += n;
+          grisu2Round(buffer, length, dist, delta, rest, 
+                      ::std::uint64_t(pow10) << shift);
+          return;
+        }
+        pow10 /= 10;
+      }
+      // fractional digits
+      int m = 0;
+      for(;;)
+      {
+        p2 *= 10;
+        buffer[length++] = char('0' + (p2 >> shift));
+        p2 &= one - 1;
+        m++;
+        delta *= 10;
+        dist  *= 10;
+        if(p2 <= delta)
+        {
+          break;
+        }
+      }
+      exponent -= m;
+      grisu2Round(buffer, length, dist, delta, p2, one);
+    }
+
+    template<typename BITS, typename FLOAT>
+    inline void shortestDigits(char * buffer, int & length, int & exponent,
+                               FLOAT value)
+    {
+      // value is finite and positive
+      const int             precision = ::std::numeric_limits<FLOAT>::digits;
+      const int             bias = ::std::numeric_limits<FLOAT>::max_exponent - 1 + 
+                                   (precision - 1);
+      const ::std::uint64_t hidden = ::std::uint64_t(1) << (precision - 1);
+      BITS bits;
+      ::std::memcpy(&bits, &value, sizeof(bits));
+      const ::std::uint64_t biased_e = ::std::uint64_t(bits) >> (precision - 1);
+      const ::std::uint64_t fraction = ::std::uint64_t(bits) & (hidden - 1);
+      const DiyFp v = biased_e == 0 ? 
+        DiyFp(fraction, 1 - bias) :
+        DiyFp(fraction + hidden, int(biased_e) - bias);
+      // boundaries halfway to the neighbours, the lower one is closer 
+      // at powers of two
+      const DiyFp plus = DiyFp::normalize(DiyFp(2 * v.f + 1, v.e - 1));
+      DiyFp minus = (fraction == 0 && biased_e > 1) ?
+        DiyFp(4 * v.f - 1, v.e - 2) :
+        DiyFp(2 * v.f - 1, v.e - 1);
+      minus = DiyFp(minus.f << (minus.e - plus.e), plus.e);
+      grisu2(buffer, length, exponent, minus, DiyFp::normalize(v), plus);
+    }
+
+    inline void shortestDigits(char * buffer, int & length, int & exponent, 
+                               double value)
+    {
+      shortestDigits< ::std::uint64_t>(buffer, length, exponent, value);
+    }
+
+    inline void shortestDigits(char * buffer, int & length, int & exponent, 
+                               float value)
+    {
+      shortestDigits< ::std::uint32_t>(buffer, length, exponent, value);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS, typename SOURCE>
+  class BasicFormatter<CHAR, TRAITS, SOURCE,
+                       typename ::std::enable_if<
+                         ::std::is_floating_point<SOURCE>::value>::type>
+  {
+  public:
+    typedef CHAR                                      char_type;
+    typedef TRAITS                                    char_traits;
+    typedef std::basic_string<char_type, char_traits> string_type;
+    typedef SOURCE                                    source_type;
+
+    /**
+     * Formats like printf("%.*g") with the shortest precision of at 
+     * least digits10 that parses back to value.
+     */
+    static void format(string_type & out, const source_type & value,
+                       const ::std::locale & locale = ::std::locale())
+    {
+      char_type decimal_point = 
+        ::std::use_facet< ::std::numpunct<char_type> >(locale).decimal_point();
+      if(::std::signbit(value))
+      {
+        out.push_back(char_type('-'));
+      }
+      if(value != value)
+      {
+        appendAscii(out, "nan");
+      }
+      else if(value == ::std::numeric_limits<source_type>::infinity() ||
+              value == -::std::numeric_limits<source_type>::infinity())
+      {
+        appendAscii(out, "inf");
+      }
+      else if(value == source_type(0))
+      {
+        out.push_back(char_type('0'));
+      }
+      else
+      {
+        write(out, value < 0 ? -value : value, decimal_point);
+      }
+    }
+
+  private:
+    static void appendAscii(string_type & out, const char * str)
+    {
+      while(*str)
+      {
+        out.push_back(char_type(*str++));
+      }
+    }
+
+    template<typename T>
+    static void write(string_type & out, T value, char_type decimal_point)
+    {
+      char digits[32];
+      int  length;
+      int  exponent;
+      detail::shortestDigits(digits, length, exponent, value);
+      // printf("%g") switches to scientific notation below 1e-4 and 
+      // from 1e<precision>
+      const int precision = length > ::std::numeric_limits<T>::digits10 ? 
+        length : ::std::numeric_limits<T>::digits10;
+      const int x = length + exponent - 1;
+      if(x < -4 || x >= precision)
+      {
+        out.push_back(char_type(digits[0]));
+        if(length > 1)
+        {
+          out.push_back(decimal_point);
+          appendDigits(out, digits + 1, length - 1);
+        }
+        out.push_back(char_type('e'));
+        out.push_back(char_type(x < 0 ? '-' : '+'));
+        char exp[8];
+        int n = ::std::snprintf(exp, sizeof(exp), "%02d", x < 0 ? -x : x);
+        appendDigits(out, exp, n);
+      }
+      else if(x < 0)
+      {
+        out.push_back(char_type('0'));
+        out.push_back(decimal_point);
+        out.append(::std::size_t(-x - 1), char_type('0'));
+        appendDigits(out, digits, length);
+      }
+      else if(length <= x + 1)
+      {
+        appendDigits(out, digits, length);
+        out.append(::std::size_t(x + 1 - length), char_type('0'));
+      }
+      else
+      {
+        appendDigits(out, digits, x + 1);
+        out.push_back(decimal_point);
+        appendDigits(out, digits + x + 1, length - x - 1);
+      }
+    }
+
+    /** 
+     * long double exceeds the 64 bit arithmetic of Grisu2, the precision
+     * is searched with snprintf and strtold instead
+     */
+    static void write(string_type & out, long double value, char_type decimal_point)
+    {
+      char buffer[64];
+      int n = 0;
+      for(int precision = ::std::numeric_limits<long double>::digits10;
+          precision <= ::std::numeric_limits<long double>::max_digits10;
+          precision++)
+      {
+        n = ::std::snprintf(buffer, sizeof(buffer), "%.*Lg", precision, value);
+        if(::std::strtold(buffer, nullptr) == value)
+        {
+          break;
+        }
+      }
+      for(int i = 0; i < n; i++)
+      {
+        const char ch = buffer[i];
+        // snprintf uses the decimal point of LC_NUMERIC
+        const bool is_decimal_point = 
+          !(ch >= '0' && ch <= '9') && !(ch >= 'a' && ch <= 'z') &&
+          !(ch >= 'A' && ch <= 'Z') && ch != '-' && ch != '+';
+        out.push_back(is_decimal_point ? decimal_point : char_type(ch));
+      }
+    }
+
+    static void appendDigits(string_type & out, const char * digits, int n)
+    {
+      for(int i = 0; i < n; i++)
+      {
+        out.push_back(char_type(digits[i]));
+      }
+    }
+  };
+
+}
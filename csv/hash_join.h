@@ -0,0 +1,465 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "csv_common.h"
+#include "reader.h"
+#include "writer.h"
+#include "dictionary.h"
+
+namespace csv
+{
+  /**
+   * Hash join of two CSV inputs. The rows of the smaller input are 
+   * loaded by build(), keeping only the key and the projected columns 
+   * in compact buffers. The larger input is streamed by probe(), which 
+   * emits each probe row followed by the projected columns of every 
+   * matching build row.
+   *
+   *   csv::HashJoin join;
+   *   join.withKey("id", "customer_id").withColumn("segment");
+   *   join.build(customers);
+   *   join.probe(orders, writer);
+   *
+   * Keys are compared by the raw content of their cells. Like SQL 
+   * NULLs, empty or missing key cells never match: such build rows are
+   * not loaded, such probe rows are only emitted by a left join. With a
+   * left join, probe rows without a match are emitted once with empty 
+   * projected columns. Probe rows shorter than the header (or the first
+   * probe row without a header) are padded with empty cells, so the 
+   * projected columns stay aligned.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicHashJoin
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef ::std::basic_string<char_type, char_traits>  string_type;
+    typedef BasicReader<char_type, char_traits>          reader_type;
+    typedef BasicWriter<char_type, char_traits>          writer_type;
+    typedef typename reader_type::spec_type              spec_type;
+
+    static const ::std::size_t npos = ::std::size_t(-1);
+
+    /**
+     * Cells of a probe row followed by the projected cells of the build 
+     * row. Only valid during the callback.
+     */
+    class JoinedRow
+    {
+      friend class BasicHashJoin<char_type, char_traits>;
+    public:
+      inline ::std::size_t size() const { return _begins.size(); }
+      inline const char_type * begin(::std::size_t i) const { return _begins[i]; }
+      inline const char_type * end(::std::size_t i) const   { return _ends[i];   }
+      inline string_type operator[](::std::size_t i) const 
+      {
+        return string_type(_begins[i], _ends[i]);
+      }
+      /** false for unmatched rows of a left join */
+      inline bool matched() const { return _matched; }
+
+    private:
+      ::std::vector<const char_type *> _begins;
+      ::std::vector<const char_type *> _ends;
+      bool                             _matched;
+    };
+
+    BasicHashJoin();
+
+    /** Key column of the build input and of the probe input */
+    BasicHashJoin & withKey(const string_type & build, const string_type & probe);
+    BasicHashJoin & withKey(::std::size_t build, ::std::size_t probe);
+
+    /**
+     * Column of the build input appended to the joined rows. By default 
+     * all columns of the first build row except the keys are appended.
+     */
+    BasicHashJoin & withColumn(const string_type & name);
+    BasicHashJoin & withColumn(::std::size_t index);
+
+    inline BasicHashJoin & withLeftJoin()    { _left = true;  return *this; }
+    inline BasicHashJoin & withoutLeftJoin() { _left = false; return *this; }
+    inline bool isLeftJoin() const           { return _left; }
+
+    /**
+     * Loads the rows of the build input, replacing previous ones.
+     */
+    void build(reader_type & reader);
+
+    /**
+     * Streams the probe input, calling callback(const JoinedRow&) for 
+     * each joined row. Returns the number of joined rows.
+     */
+    template<typename F>
+    ::std::size_t probe(reader_type & reader, F callback);
+
+    /**
+     * Writes the joined rows, preceded by a header if the probe input 
+     * has one.
+     */
+    ::std::size_t probe(reader_type & reader, writer_type & writer);
+
+    void clear();
+
+    /** number of build rows */
+    inline ::std::size_t size() const { return _next.size(); }
+    inline ::std::size_t numProjectedColumns() const { return _projected.size(); }
+
+    /** Heap bytes of the build rows and of the hash table */
+    ::std::size_t memoryUsage() const;
+
+  private:
+    struct Column
+    {
+      string_type   name;
+      ::std::size_t index;
+    };
+
+    ::std::vector<Column>                   _build_keys;
+    ::std::vector<Column>                   _probe_keys;
+    ::std::vector<Column>                   _columns;
+    bool                                    _left;
+
+    ::std::vector< ::std::size_t>           _build_key_index;
+    ::std::vector< ::std::size_t>           _probe_key_index;
+    ::std::vector< ::std::size_t>           _projected;
+    ::std::vector<string_type>              _projected_names;
+
+    // distinct keys, first and last build row per key code
+    BasicDictionary<char_type, char_traits> _keys;
+    ::std::vector< ::std::size_t>           _first;
+    ::std::vector< ::std::size_t>           _last;
+    // next build row with the same key
+    ::std::vector< ::std::size_t>           _next;
+    // projected cell j of build row r is [_offsets[r * P + j], _offsets[r * P + j + 1])
+    ::std::vector<char_type>                _values;
+    ::std::vector< ::std::size_t>           _offsets;
+
+    string_type                             _key;
+    JoinedRow                               _row;
+
+    static ::std::vector< ::std::size_t> resolve(const ::std::vector<Column> & columns,
+                                                 const spec_type & spec);
+    /** false if a key cell is empty or missing */
+    inline bool key(reader_type & reader, 
+                    const ::std::vector< ::std::size_t> & columns,
+                    const char_type *& begin,
+                    const char_type *& end);
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicHashJoin<CHAR, TRAITS>::npos;
+
+  template<typename CHAR, typename TRAITS>
+  BasicHashJoin<CHAR, TRAITS>::BasicHashJoin() : _left(false)
+  {
+    _offsets.push_back(0);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicHashJoin<CHAR, TRAITS> & 
+  BasicHashJoin<CHAR, TRAITS>::withKey(const string_type & build, 
+                                       const string_type & probe)
+  {
+    _build_keys.push_back(Column{build, npos});
+    _probe_keys.push_back(Column{probe, npos});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicHashJoin<CHAR, TRAITS> & 
+  BasicHashJoin<CHAR, TRAITS>::withKey(::std::size_t build, ::std::size_t probe)
+  {
+    _build_keys.push_back(Column{string_type(), build});
+    _probe_keys.push_back(Column{string_type(), probe});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicHashJoin<CHAR, TRAITS> & 
+  BasicHashJoin<CHAR, TRAITS>::withColumn(const string_type & name)
+  {
+    _columns.push_back(Column{name, npos});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicHashJoin<CHAR, TRAITS> & 
+  BasicHashJoin<CHAR, TRAITS>::withColumn(::std::size_t index)
+  {
+    _columns.push_back(Column{string_type(), index});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::vector< ::std::size_t> 
+  BasicHashJoin<CHAR, TRAITS>::resolve(const ::std::vector<Column> & columns,
+                                       const spec_type & spec)
+  {
+    ::std::vector< ::std::size_t> ret;
+    for(auto & column : columns)
+    {
+      ::std::size_t index = column.index;
+      if(!column.name.empty())
+      {
+        index = spec.columnIndex(column.name);
+        if(index == spec_type::npos)
+        {
+          throw UndefinedColumnError("Undefined column in join.", 
+                                     spec.numColumns(), 0, 0, 0, 0);
+        }
+      }
+      ret.push_back(index);
+    }
+    return ret;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline bool 
+  BasicHashJoin<CHAR, TRAITS>::key(reader_type & reader,
+                                   const ::std::vector< ::std::size_t> & columns,
+                                   const char_type *& begin,
+                                   const char_type *& end)
+  {
+    const ::std::size_t n = reader.rawRowSize();
+    if(columns.size() == 1)
+    {
+      if(columns[0] >= n)
+      {
+        return false;
+      }
+      reader.rawCell(columns[0], begin, end);
+      return begin != end;
+    }
+    // composite keys: cells prefixed by their length
+    _key.clear();
+    for(auto column : columns)
+    {
+      const char_type * b = nullptr;
+      const char_type * e = nullptr;
+      if(column < n)
+      {
+        reader.rawCell(column, b, e);
+      }
+      if(b == e)
+      {
+        return false;
+      }
+      ::std::size_t length = e - b;
+      for(::std::size_t i = 0; i < sizeof(::std::size_t); i++)
+      {
+        _key.push_back(char_type((length >> (8 * i)) & 0xff));
+      }
+      _key.append(b, e);
+    }
+    begin = _key.data();
+    end   = _key.data() + _key.size();
+    return true;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicHashJoin<CHAR, TRAITS>::clear()
+  {
+    _keys = BasicDictionary<char_type, char_traits>();
+    _first.clear();
+    _last.clear();
+    _next.clear();
+    _values.clear();
+    _offsets.resize(1);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicHashJoin<CHAR, TRAITS>::build(reader_type & reader)
+  {
+    clear();
+    const spec_type & spec = reader.specification();
+    _build_key_index = resolve(_build_keys, spec);
+    _projected       = resolve(_columns, spec);
+    bool first_row   = true;
+    while(reader.nextRawRow())
+    {
+      const ::std::size_t n = reader.rawRowSize();
+      if(first_row && _columns.empty())
+      {
+        for(::std::size_t i = 0; i < n; i++)
+        {
+          if(::std::find(_build_key_index.begin(), _build_key_index.end(), i) == 
+             _build_key_index.end())
+          {
+            _projected.push_back(i);
+          }
+        }
+      }
+      first_row = false;
+      const char_type * begin;
+      const char_type * end;
+      if(!key(reader, _build_key_index, begin, end))
+      {
+        continue;
+      }
+      const ::std::size_t code = _keys.intern(begin, end);
+      const ::std::size_t row  = _next.size();
+      if(code == _first.size())
+      {
+        _first.push_back(row);
+        _last.push_back(row);
+      }
+      else
+      {
+        _next[_last[code]] = row;
+        _last[code] = row;
+      }
+      _next.push_back(npos);
+      for(auto column : _projected)
+      {
+        if(column < n)
+        {
+          reader.rawCell(column, begin, end);
+          _values.insert(_values.end(), begin, end);
+        }
+        _offsets.push_back(_values.size());
+      }
+    }
+    _projected_names.clear();
+    for(auto column : _projected)
+    {
+      _projected_names.push_back(spec.columnName(column));
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename F>
+  ::std::size_t BasicHashJoin<CHAR, TRAITS>::probe(reader_type & reader, F callback)
+  {
+    const spec_type & spec = reader.specification();
+    _probe_key_index = resolve(_probe_keys, spec);
+    const ::std::size_t width = _projected.size();
+    // short probe rows are padded to the header or to the first row
+    ::std::size_t probe_width = spec.hasHeader() ? spec.numColumns() : npos;
+    ::std::size_t ret = 0;
+    while(reader.nextRawRow())
+    {
+      const ::std::size_t size = reader.rawRowSize();
+      if(probe_width == npos)
+      {
+        probe_width = size;
+      }
+      const ::std::size_t n = ::std::max(size, probe_width);
+      _row._begins.resize(n + width);
+      _row._ends.resize(n + width);
+      for(::std::size_t i = 0; i < size; i++)
+      {
+        reader.rawCell(i, _row._begins[i], _row._ends[i]);
+      }
+      for(::std::size_t i = size; i < n; i++)
+      {
+        _row._begins[i] = _row._ends[i] = _values.data();
+      }
+      const char_type * begin;
+      const char_type * end;
+      const ::std::size_t code = key(reader, _probe_key_index, begin, end) ? 
+        _keys.code(begin, end) : npos;
+      if(code != npos)
+      {
+        _row._matched = true;
+        for(::std::size_t r = _first[code]; r != npos; r = _next[r])
+        {
+          const ::std::size_t * offsets = &_offsets[r * width];
+          for(::std::size_t j = 0; j < width; j++)
+          {
+            _row._begins[n + j] = _values.data() + offsets[j];
+            _row._ends[n + j]   = _values.data() + offsets[j + 1];
+          }
+          callback(static_cast<const JoinedRow &>(_row));
+          ret++;
+        }
+      }
+      else if(_left)
+      {
+        _row._matched = false;
+        for(::std::size_t j = 0; j < width; j++)
+        {
+          _row._begins[n + j] = _row._ends[n + j] = _values.data();
+        }
+        callback(static_cast<const JoinedRow &>(_row));
+        ret++;
+      }
+    }
+    return ret;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicHashJoin<CHAR, TRAITS>::probe(reader_type & reader, 
+                                                   writer_type & writer)
+  {
+    const spec_type & spec = reader.specification();
+    if(spec.hasHeader())
+    {
+      for(::std::size_t i = 0; i < spec.numColumns(); i++)
+      {
+        writer.writeCell(spec.columnName(i));
+      }
+      for(auto & name : _projected_names)
+      {
+        writer.writeCell(name);
+      }
+      writer.endRow();
+    }
+    return probe(reader, [&writer](const JoinedRow & row)
+    {
+      for(::std::size_t i = 0; i < row.size(); i++)
+      {
+        writer.writeCell(row.begin(i), row.end(i));
+      }
+      writer.endRow();
+    });
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicHashJoin<CHAR, TRAITS>::memoryUsage() const
+  {
+    return 
+      _keys.memoryUsage() +
+      (_first.capacity() + _last.capacity() + _next.capacity() + 
+       _offsets.capacity()) * sizeof(::std::size_t) +
+      _values.capacity() * sizeof(char_type);
+  }
+}
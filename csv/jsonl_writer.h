@@ -0,0 +1,610 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <typeindex>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "csv_common.h"
+#include "reader.h"
+#include "serializer.h"
+#include "formatter.h"
+#include "thread_pool.h"
+#include "utf8.h"
+
+namespace csv
+{
+  namespace detail
+  {
+    /**
+     * First character in [begin, end) which has to be escaped in a JSON
+     * string: '"', '\\' or a control character. Scans 16 bytes at a time
+     * if SSE2 is available.
+     */
+    inline const char * findJsonEscape(const char * begin, const char * end);
+
+    /** Appends [begin, end) to out as the content of a JSON string. */
+    inline void escapeJson(const char * begin, const char * end, ::std::string & out);
+
+    /** true if [begin, end) is a number in JSON syntax */
+    inline bool isJsonNumber(const char * begin, const char * end);
+  }
+
+  /**
+   * Converts the rows of a reader to JSON Lines, one object per row
+   * keyed by the column names of the specification:
+   *
+   *   csv::Reader reader(ist, csv::Specification().withHeader());
+   *   csv::JsonlWriter writer(ost);
+   *   writer.withNumber("price");
+   *   writer.write(reader);
+   *
+   * gives {"symbol":"ABC","price":1.5} per row. Cells are written as 
+   * strings, cells of number columns unquoted (null if empty). Columns 
+   * without a name are keyed by their index. Output is UTF-8 and 
+   * collected in a buffer of buffer_size bytes before it is written
+   * to the stream.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicJsonlWriter
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef ::std::basic_string<char_type, char_traits>  string_type;
+    typedef BasicReader<char_type, char_traits>          reader_type;
+    typedef typename reader_type::spec_type              spec_type;
+
+    static const ::std::size_t default_buffer_size = 1u << 20;
+    static const ::std::size_t default_batch_size  = 4096;
+
+    BasicJsonlWriter(::std::ostream & ost, 
+                     ::std::size_t buffer_size = default_buffer_size);
+
+    /**
+     * Writes the cells of the column unquoted. Cells which are not JSON 
+     * numbers are parsed with the locale of the specification and 
+     * reformatted, ConversionError is thrown if that fails.
+     */
+    BasicJsonlWriter & withNumber(const string_type & name);
+    BasicJsonlWriter & withNumber(::std::size_t index);
+
+    /**
+     * Writes the remaining rows of reader. Returns the number of rows.
+     * If a row cannot be converted, the preceding rows are written 
+     * before the exception is rethrown.
+     */
+    ::std::size_t write(reader_type & reader);
+
+    /**
+     * Tokenizes the remaining rows of reader on the calling thread and 
+     * converts batches of rows on the pool. The output keeps the order
+     * of the rows, failures are handled as by write(reader).
+     */
+    ::std::size_t write(reader_type & reader, 
+                        ThreadPool & pool, 
+                        ::std::size_t batch_size = default_batch_size);
+
+    ::std::size_t write(reader_type & reader, 
+                        ::std::size_t threads, 
+                        ::std::size_t batch_size = default_batch_size);
+
+  private:
+    struct Batch
+    {
+      ::std::vector<char_type>      data;
+      // per cell
+      ::std::vector< ::std::size_t> offsets;
+      // per row: number of cells, csv row and input line
+      ::std::vector< ::std::size_t> cells;
+      ::std::vector< ::std::size_t> csv_rows;
+      ::std::vector< ::std::size_t> input_lines;
+      ::std::string                 out;
+      // rows in out, all rows unless conversion failed
+      ::std::size_t                 converted;
+      ::std::exception_ptr          error;
+    };
+
+    ::std::ostream &               _ost;
+    ::std::size_t                  _buffer_size;
+    ::std::string                  _buffer;
+    ::std::vector<string_type>     _number_names;
+    ::std::vector< ::std::size_t>  _number_indices;
+    ::std::vector<bool>            _numeric;
+    // "name": per column
+    ::std::vector< ::std::string>  _keys;
+    ::std::locale                  _locale;
+
+    void resolve(const spec_type & spec);
+    void formatRow(::std::string & out,
+                   ::std::string & scratch,
+                   const char_type * const * begins,
+                   const char_type * const * ends,
+                   ::std::size_t n,
+                   ::std::size_t csv_row,
+                   ::std::size_t input_line) const;
+    void formatNumber(::std::string & out,
+                      ::std::string & scratch,
+                      const char_type * begin,
+                      const char_type * end,
+                      ::std::size_t csv_row,
+                      ::std::size_t input_line,
+                      ::std::size_t column) const;
+    void flush();
+
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  inline const char * detail::findJsonEscape(const char * begin, const char * end)
+  {
+#ifdef __SSE2__
+    const __m128i quote     = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control   = _mm_set1_epi8(0x1F);
+    while(end - begin >= 16)
+    {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+      // unsigned block <= 0x1F
+      __m128i match = _mm_cmpeq_epi8(_mm_max_epu8(block, control), control);
+      match = _mm_or_si128(match, _mm_cmpeq_epi8(block, quote));
+      match = _mm_or_si128(match, _mm_cmpeq_epi8(block, backslash));
+      int mask = _mm_movemask_epi8(match);
+      if(mask)
+      {
+        return begin + __builtin_ctz(mask);
+      }
+      begin+= 16;
+    }
+#endif
+    for(; begin != end; ++begin)
+    {
+      const unsigned char ch = static_cast<unsigned char>(*begin);
+      if(ch == '"' || ch == '\\' || ch < 0x20)
+      {
+        return begin;
+      }
+    }
+    return end;
+  }
+
+  inline void detail::escapeJson(const char * begin, const char * end, ::std::string & out)
+  {
+    static const char hex[] = "0123456789abcdef";
+    while(begin != end)
+    {
+      const char * pos = findJsonEscape(begin, end);
+      out.append(begin, pos);
+      if(pos == end)
+      {
+        break;
+      }
+      const unsigned char ch = static_cast<unsigned char>(*pos);
+      switch(ch)
+      {
+      case '"':  out.append("\\\"", 2); break;
+      case '\\': out.append("\\\\", 2); break;
+      case '\n': out.append("\\n", 2);  break;
+      case '\r': out.append("\\r", 2);  break;
+      case '\t': out.append("\\t", 2);  break;
+      case '\b': out.append("\\b", 2);  break;
+      case '\f': out.append("\\f", 2);  break;
+      default:
+        {
+          const char code[6] = { '\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xF] };
+          out.append(code, 6);
+        }
+      }
+      begin = pos + 1;
+    }
+  }
+
+  inline bool detail::isJsonNumber(const char * begin, const char * end)
+  {
+    auto digits = [&begin, end]()
+    {
+      const char * start = begin;
+      while(begin != end && *begin >= '0' && *begin <= '9')
+      {
+        ++begin;
+      }
+      return begin != start;
+    };
+    if(begin != end && *begin == '-')
+    {
+      ++begin;
+    }
+    if(begin != end && *begin == '0')
+    {
+      ++begin;
+    }
+    else if(!digits())
+    {
+      return false;
+    }
+    if(begin != end && *begin == '.')
+    {
+      ++begin;
+      if(!digits())
+      {
+        return false;
+      }
+    }
+    if(begin != end && (*begin == 'e' || *begin == 'E'))
+    {
+      ++begin;
+      if(begin != end && (*begin == '+' || *begin == '-'))
+      {
+        ++begin;
+      }
+      if(!digits())
+      {
+        return false;
+      }
+    }
+    return begin == end;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicJsonlWriter<CHAR, TRAITS>::default_buffer_size;
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicJsonlWriter<CHAR, TRAITS>::default_batch_size;
+
+  template<typename CHAR, typename TRAITS>
+  BasicJsonlWriter<CHAR, TRAITS>::BasicJsonlWriter(::std::ostream & ost,
+                                                   ::std::size_t buffer_size)
+    : _ost(ost), _buffer_size(buffer_size)
+  {
+    _buffer.reserve(_buffer_size + 1024);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicJsonlWriter<CHAR, TRAITS> & 
+  BasicJsonlWriter<CHAR, TRAITS>::withNumber(const string_type & name)
+  {
+    _number_names.push_back(name);
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicJsonlWriter<CHAR, TRAITS> & 
+  BasicJsonlWriter<CHAR, TRAITS>::withNumber(::std::size_t index)
+  {
+    _number_indices.push_back(index);
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicJsonlWriter<CHAR, TRAITS>::resolve(const spec_type & spec)
+  {
+    _locale = spec.locale();
+    const ::std::size_t n = spec.numColumns();
+    _keys.assign(n, ::std::string());
+    _numeric.assign(n, false);
+    for(auto & name : _number_names)
+    {
+      ::std::size_t index = spec.columnIndex(name);
+      if(index == spec_type::npos)
+      {
+        throw UndefinedColumnError("Undefined column in JSON writer.", 
+                                   n, 0, 0, 0, 0);
+      }
+      _numeric[index] = true;
+    }
+    for(auto index : _number_indices)
+    {
+      if(index >= _numeric.size())
+      {
+        _numeric.resize(index + 1, false);
+      }
+      _numeric[index] = true;
+    }
+    ::std::string name;
+    for(::std::size_t i = 0; i < n; i++)
+    {
+      string_type column = spec.columnName(i);
+      name.clear();
+      encodeUtf8(column.data(), column.data() + column.size(), name);
+      _keys[i].push_back('"');
+      detail::escapeJson(name.data(), name.data() + name.size(), _keys[i]);
+      _keys[i].append("\":", 2);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicJsonlWriter<CHAR, TRAITS>::formatNumber(::std::string & out,
+                                                    ::std::string & scratch,
+                                                    const char_type * begin,
+                                                    const char_type * end,
+                                                    ::std::size_t csv_row,
+                                                    ::std::size_t input_line,
+                                                    ::std::size_t column) const
+  {
+    if(begin == end)
+    {
+      out.append("null", 4);
+      return;
+    }
+    scratch.clear();
+    encodeUtf8(begin, end, scratch);
+    if(detail::isJsonNumber(scratch.data(), scratch.data() + scratch.size()))
+    {
+      out.append(scratch);
+      return;
+    }
+    double value;
+    if(!BasicSerializer<char_type, char_traits, double>::parse(begin, end, _locale, value) ||
+       !::std::isfinite(value))
+    {
+      ::std::type_index ti(typeid(double));
+      throw ConversionError(::std::string("Cannot convert cell content ") + ti.name(),
+                            ti, input_line, 0, csv_row, column);
+    }
+    BasicFormatter<char, ::std::char_traits<char>, double>::format(out, value, 
+                                                                   ::std::locale::classic());
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicJsonlWriter<CHAR, TRAITS>::formatRow(::std::string & out,
+                                                 ::std::string & scratch,
+                                                 const char_type * const * begins,
+                                                 const char_type * const * ends,
+                                                 ::std::size_t n,
+                                                 ::std::size_t csv_row,
+                                                 ::std::size_t input_line) const
+  {
+    out.push_back('{');
+    for(::std::size_t i = 0; i < n; i++)
+    {
+      if(i)
+      {
+        out.push_back(',');
+      }
+      // columns without a name are keyed by their index
+      if(i < _keys.size() && _keys[i].size() > 3)
+      {
+        out.append(_keys[i]);
+      }
+      else
+      {
+        out.push_back('"');
+        BasicFormatter<char, ::std::char_traits<char>, ::std::size_t>::format(out, i);
+        out.append("\":", 2);
+      }
+      if(i < _numeric.size() && _numeric[i])
+      {
+        formatNumber(out, scratch, begins[i], ends[i], csv_row, input_line, i);
+      }
+      else
+      {
+        out.push_back('"');
+        if(sizeof(char_type) == 1)
+        {
+          detail::escapeJson(reinterpret_cast<const char *>(begins[i]), 
+                             reinterpret_cast<const char *>(ends[i]), out);
+        }
+        else
+        {
+          scratch.clear();
+          encodeUtf8(begins[i], ends[i], scratch);
+          detail::escapeJson(scratch.data(), scratch.data() + scratch.size(), out);
+        }
+        out.push_back('"');
+      }
+    }
+    out.append("}\n", 2);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicJsonlWriter<CHAR, TRAITS>::flush()
+  {
+    _ost.write(_buffer.data(), _buffer.size());
+    _buffer.clear();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicJsonlWriter<CHAR, TRAITS>::write(reader_type & reader)
+  {
+    resolve(reader.specification());
+    ::std::vector<const char_type *> begins;
+    ::std::vector<const char_type *> ends;
+    ::std::string scratch;
+    ::std::size_t rows = 0;
+    try
+    {
+      while(reader.nextRawRow())
+      {
+        const ::std::size_t n = reader.rawRowSize();
+        begins.resize(n);
+        ends.resize(n);
+        for(::std::size_t i = 0; i < n; i++)
+        {
+          reader.rawCell(i, begins[i], ends[i]);
+        }
+        const ::std::size_t mark = _buffer.size();
+        try
+        {
+          formatRow(_buffer, scratch, begins.data(), ends.data(), n, 
+                    reader.rawRow(),
+                    reader.rawInputLine());
+        }
+        catch(...)
+        {
+          // drop the incomplete row
+          _buffer.resize(mark);
+          throw;
+        }
+        if(_buffer.size() >= _buffer_size)
+        {
+          flush();
+        }
+        rows++;
+      }
+    }
+    catch(...)
+    {
+      // the rows before the failure are written
+      flush();
+      _ost.flush();
+      throw;
+    }
+    flush();
+    _ost.flush();
+    return rows;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicJsonlWriter<CHAR, TRAITS>::write(reader_type & reader,
+                                                      ::std::size_t threads,
+                                                      ::std::size_t batch_size)
+  {
+    ThreadPool pool(threads);
+    return write(reader, pool, batch_size);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicJsonlWriter<CHAR, TRAITS>::write(reader_type & reader,
+                                                      ThreadPool & pool,
+                                                      ::std::size_t batch_size)
+  {
+    resolve(reader.specification());
+    if(batch_size == 0)
+    {
+      batch_size = 1;
+    }
+    ::std::size_t rows = 0;
+    auto fill = [&](Batch & batch)
+    {
+      batch.offsets.push_back(0);
+      while(batch.cells.size() < batch_size && reader.nextRawRow())
+      {
+        const ::std::size_t n = reader.rawRowSize();
+        for(::std::size_t i = 0; i < n; i++)
+        {
+          const char_type * begin;
+          const char_type * end;
+          reader.rawCell(i, begin, end);
+          batch.data.insert(batch.data.end(), begin, end);
+          batch.offsets.push_back(batch.data.size());
+        }
+        batch.cells.push_back(n);
+        batch.csv_rows.push_back(reader.rawRow());
+        batch.input_lines.push_back(reader.rawInputLine());
+      }
+      return !batch.cells.empty();
+    };
+    const BasicJsonlWriter * self = this;
+    auto convert = [self](Batch & batch)
+    {
+      ::std::vector<const char_type *> begins;
+      ::std::vector<const char_type *> ends;
+      ::std::string scratch;
+      const char_type * data = batch.data.data();
+      ::std::size_t cell = 0;
+      ::std::size_t mark = 0;
+      batch.out.reserve(batch.data.size() * sizeof(char_type) + 
+                        batch.offsets.size() * 16);
+      batch.converted = 0;
+      try
+      {
+        for(; batch.converted < batch.cells.size(); batch.converted++)
+        {
+          const ::std::size_t r = batch.converted;
+          const ::std::size_t n = batch.cells[r];
+          begins.resize(n);
+          ends.resize(n);
+          for(::std::size_t i = 0; i < n; i++, cell++)
+          {
+            begins[i] = data + batch.offsets[cell];
+            ends[i]   = data + batch.offsets[cell + 1];
+          }
+          mark = batch.out.size();
+          self->formatRow(batch.out, scratch, begins.data(), ends.data(), n,
+                          batch.csv_rows[r], batch.input_lines[r]);
+        }
+      }
+      catch(...)
+      {
+        // keep the rows before the failure
+        batch.out.resize(mark);
+        batch.error = ::std::current_exception();
+      }
+    };
+    auto emit = [&](Batch & batch)
+    {
+      const ::std::string & out = batch.out;
+      if(_buffer.size() + out.size() > _buffer_size)
+      {
+        flush();
+      }
+      if(out.size() >= _buffer_size)
+      {
+        _ost.write(out.data(), out.size());
+      }
+      else
+      {
+        _buffer.append(out);
+      }
+      rows+= batch.converted;
+      if(batch.error)
+      {
+        ::std::rethrow_exception(batch.error);
+      }
+    };
+    try
+    {
+      processOrdered<Batch>(pool, fill, convert, emit);
+    }
+    catch(...)
+    {
+      // the rows before the failure are written
+      flush();
+      _ost.flush();
+      throw;
+    }
+    flush();
+    _ost.flush();
+    return rows;
+  }
+}
@@ -1,10 +1,13 @@
 #pragma once
+#include <vector>
+#include <exception>
 #include "builder.h"
 #include "reader.h"
+#include "thread_pool.h"
 
 namespace csv
 {
-  template<typename CLASS, typename CHAR, typename TRAITS>
+  template<typename CLASS, typename CHAR, typename TRAITS, typename BUILDER>
   class BasicObjectReader
   {
   public:
@@ -18,18 +21,173 @@ namespace csv
     typedef typename row_type::spec_type                 spec_type;
     typedef ::std::basic_istream<char_type,
                                  char_traits>            istream_type;
-    typedef BasicBuilder<object_type,
-                         char_type,
-                         char_traits>                    builder_type;
+    typedef BUILDER                                      builder_type;
+
+    typedef typename builder_type::template Mapping<row_type> mapping_type;
 
     BasicObjectReader(const builder_type & builder,
                       istream_type & ist,
                       spec_type specs = spec_type()) :
       _reader(ist, specs),
-      _builder(std::make_shared<builder_type>(builder))
+      _builder(std::make_shared<builder_type>(builder)),
+      _mapping(std::make_shared<mapping_type>(_builder, _reader.specification())),
+      _reuse(false),
+      _started(false)
     {
     }
 
+    /**
+     * Iterators map all rows into one object, allocated once per
+     * iterator. The object is only valid until the iterator is
+     * incremented.
+     */
+    inline BasicObjectReader & withObjectReuse()
+    {
+      _reuse = true;
+      return *this;
+    }
+
+    inline BasicObjectReader & withoutObjectReuse()
+    {
+      _reuse = false;
+      return *this;
+    }
+
+    inline bool isReusingObjects() const
+    {
+      return _reuse;
+    }
+
+    /**
+     * Heap bytes held by the underlying reader, objects are not 
+     * accounted.
+     */
+    inline ::std::size_t memoryUsage() const
+    {
+      return _reader.memoryUsage();
+    }
+
+    /**
+     * Appends up to max_rows objects to out, constructing them in place.
+     * Subsequent calls continue with the next row. Returns the number
+     * of objects read, 0 at the end of the input.
+     * Do not mix with begin() / end() on the same reader.
+     */
+    ::std::size_t readInto(::std::vector<object_type> & out,
+                           ::std::size_t max_rows = ::std::size_t(-1))
+    {
+      typedef typename reader_type::iterator reader_iterator;
+      if(!_started)
+      {
+        _cursor  = _reader.begin();
+        _started = true;
+      }
+      ::std::size_t n = 0;
+      while(n < max_rows && _cursor != reader_iterator())
+      {
+        out.emplace_back();
+        try
+        {
+          _mapping->map(out.back(), *_cursor);
+        }
+        catch(...)
+        {
+          out.pop_back();
+          ++_cursor;
+          throw;
+        }
+        ++_cursor;
+        ++n;
+      }
+      return n;
+    }
+
+    /**
+     * Tokenizes rows on the calling thread and maps batches of rows to
+     * objects on the thread pool. callback(const object_type&) is
+     * called on the calling thread in the original row order.
+     * If a row cannot be mapped, callback is called for all preceding
+     * rows before the exception is rethrown.
+     * Returns the number of objects.
+     */
+    template<typename F>
+    ::std::size_t readParallel(F callback,
+                               ThreadPool & pool,
+                               ::std::size_t batch_size = 1024)
+    {
+      typedef typename reader_type::iterator reader_iterator;
+      struct Batch
+      {
+        ::std::vector<row_type>    rows;
+        ::std::vector<object_type> objects;
+        // objects before the first row that failed to map
+        ::std::size_t              mapped;
+        ::std::exception_ptr       error;
+      };
+      if(batch_size == 0)
+      {
+        batch_size = 1;
+      }
+      ::std::shared_ptr<const mapping_type> mapping = _mapping;
+      ::std::size_t n = 0;
+      reader_iterator itr = _reader.begin();
+      auto fill = [&](Batch & batch)
+      {
+        batch.rows.reserve(batch_size);
+        for(; itr != reader_iterator() && batch.rows.size() < batch_size; ++itr)
+        {
+          batch.rows.push_back(*itr);
+        }
+        return !batch.rows.empty();
+      };
+      auto convert = [mapping](Batch & batch)
+      {
+        batch.objects.resize(batch.rows.size());
+        batch.mapped = 0;
+        try
+        {
+          for(; batch.mapped < batch.rows.size(); batch.mapped++)
+          {
+            mapping->map(batch.objects[batch.mapped], batch.rows[batch.mapped]);
+          }
+        }
+        catch(...)
+        {
+          batch.error = ::std::current_exception();
+        }
+      };
+      auto emit = [&](Batch & batch)
+      {
+        for(::std::size_t i = 0; i < batch.mapped; i++)
+        {
+          callback(static_cast<const object_type &>(batch.objects[i]));
+        }
+        n+= batch.mapped;
+        if(batch.error)
+        {
+          ::std::rethrow_exception(batch.error);
+        }
+      };
+      processOrdered<Batch>(pool, fill, convert, emit);
+      return n;
+    }
+
+    template<typename F>
+    ::std::size_t readParallel(F callback,
+                               ::std::size_t threads = 0,
+                               ::std::size_t batch_size = 1024)
+    {
+      ThreadPool pool(threads);
+      return readParallel(callback, pool, batch_size);
+    }
+
+    /**
+     * Maps a single row by looking up every member by name.
+     *
+     * Deprecated: the reader maps rows with a column mapping resolved 
+     * once per specification (BasicBuilder::Mapping), kept for callers
+     * which map rows themselves.
+     */
     static void map(object_type & obj,
                     const builder_type & builder,
                     const row_type & row)
@@ -46,9 +204,8 @@ namespace csv
                          string_type(col.begin(), col.end()),
                          col.specification()->locale());
           }
-          catch(BasicSerializerFailure failure)
+          catch(const BasicSerializerFailure & failure)
           {
-            
             throw ConversionError(::std::string(failure.what()),
                                   failure.getType(),
                                   col.inputLine(),
@@ -62,26 +219,46 @@ namespace csv
 
     class iterator : public ::std::iterator<::std::input_iterator_tag, object_type>
     {
-      friend class BasicObjectReader<object_type, char_type, char_traits>;
+      friend class BasicObjectReader<object_type, char_type, char_traits, builder_type>;
       typedef typename reader_type::iterator reader_iterator;
       reader_iterator _itr;
       ::std::shared_ptr<object_type> _obj;
-      ::std::shared_ptr<builder_type> _builder;
+      ::std::shared_ptr<const mapping_type> _mapping;
+      bool _reuse;
 
       iterator(reader_iterator itr,
-               std::shared_ptr<builder_type> builder) :
+               std::shared_ptr<const mapping_type> mapping,
+               bool reuse) :
         _itr(itr),
-        _builder(builder)
+        _mapping(mapping),
+        _reuse(reuse)
       {
         if(_itr != reader_iterator())
         {
           _obj.reset(new object_type());
-          BasicObjectReader::map(*_obj, *_builder, *_itr);
+          _mapping->map(*_obj, *_itr);
+        }
+      }
+
+      inline void next()
+      {
+        if(_reuse)
+        {
+          if(!_mapping->covers(*_itr))
+          {
+            // members missing in this row get their default values
+            *_obj = object_type();
+          }
+        }
+        else
+        {
+          _obj.reset(new object_type());
         }
+        _mapping->map(*_obj, *_itr);
       }
 
     public:
-      iterator() : _itr(reader_iterator())
+      iterator() : _itr(reader_iterator()), _reuse(false)
       {
         _obj = nullptr;
       }
@@ -89,8 +266,10 @@ namespace csv
       inline iterator& operator++()
       {
         ++_itr;
-        _obj.reset(new object_type());
-        BasicObjectReader::map(*_obj, *_builder, *_itr);
+        if(_itr != reader_iterator())
+        {
+          next();
+        }
         return *this;
       }
 
@@ -122,19 +301,23 @@ namespace csv
       }
     };
 
-    inline iterator begin() { return iterator(_reader.begin(), _builder); }
-    inline iterator end()   { return iterator(_reader.end(), _builder); }
+    inline iterator begin() { return iterator(_reader.begin(), _mapping, _reuse); }
+    inline iterator end()   { return iterator(_reader.end(), _mapping, _reuse); }
 
   private:
-    ::std::shared_ptr<builder_type> _builder;
     reader_type _reader;
+    ::std::shared_ptr<builder_type> _builder;
+    ::std::shared_ptr<const mapping_type> _mapping;
+    bool _reuse;
+    bool _started;
+    typename reader_type::iterator _cursor;
   };
 
-  template<typename CLASS>
-  class ObjectReader : public BasicObjectReader<CLASS, char, char_traits>
+  template<typename CLASS, typename BUILDER=BasicBuilder<CLASS, char, char_traits> >
+  class ObjectReader : public BasicObjectReader<CLASS, char, char_traits, BUILDER>
   {
   public:
-    typedef BasicObjectReader<CLASS, char, char_traits> parent_type;
+    typedef BasicObjectReader<CLASS, char, char_traits, BUILDER> parent_type;
     typedef typename parent_type::builder_type builder_type;
     typedef typename parent_type::istream_type istream_type;
     typedef typename parent_type::spec_type spec_type;
@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include "builder.h"
+#include "writer.h"
+
+namespace csv
+{
+  template<typename CLASS, typename CHAR, typename TRAITS>
+  class BasicObjectWriter
+  {
+  public:
+    typedef CLASS                                        object_type;
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef std::basic_string<char_type, char_traits>    string_type;
+    typedef BasicWriter<char_type, char_traits>          writer_type;
+    typedef typename writer_type::spec_type              spec_type;
+    typedef typename writer_type::ostream_type           ostream_type;
+    typedef BasicBuilder<object_type,
+                         char_type,
+                         char_traits>                    builder_type;
+
+    /**
+     * Writes the field names of the builder as header if
+     * specs.hasHeader() is set.
+     */
+    BasicObjectWriter(const builder_type & builder,
+                      ostream_type & ost,
+                      spec_type specs = spec_type(),
+                      ::std::size_t block_size = writer_type::default_block_size) :
+      _writer(ost, specs, block_size),
+      _builder(std::make_shared<builder_type>(builder)),
+      _locale(specs.locale())
+    {
+      if(specs.hasHeader())
+      {
+        _writer.writeRow(_builder->getFieldNames());
+      }
+    }
+
+    inline BasicObjectWriter & write(const object_type & obj)
+    {
+      for(auto & field : *_builder)
+      {
+        _field.clear();
+        field->format(_field, obj, _locale);
+        _writer.writeCell(_field);
+      }
+      _writer.endRow();
+      return *this;
+    }
+
+    template<typename ITER>
+    inline BasicObjectWriter & write(ITER begin, ITER end)
+    {
+      for(ITER itr = begin; itr != end; ++itr)
+      {
+        write(*itr);
+      }
+      return *this;
+    }
+
+    inline BasicObjectWriter & write(const ::std::vector<object_type> & objects)
+    {
+      return write(objects.begin(), objects.end());
+    }
+
+    inline void flush()
+    {
+      _writer.flush();
+    }
+
+  private:
+    writer_type                     _writer;
+    ::std::shared_ptr<builder_type> _builder;
+    ::std::locale                   _locale;
+    string_type                     _field;
+  };
+
+  template<typename CLASS>
+  class ObjectWriter : public BasicObjectWriter<CLASS, char, char_traits>
+  {
+  public:
+    typedef BasicObjectWriter<CLASS, char, char_traits> parent_type;
+    typedef typename parent_type::builder_type builder_type;
+    typedef typename parent_type::ostream_type ostream_type;
+    typedef typename parent_type::spec_type spec_type;
+    typedef typename parent_type::writer_type writer_type;
+
+    ObjectWriter(const builder_type & _builder,
+                 ostream_type & _ost,
+                 spec_type _specs = spec_type(),
+                 ::std::size_t _block_size = writer_type::default_block_size) :
+      parent_type(_builder, _ost, _specs, _block_size) {}
+  };
+
+}
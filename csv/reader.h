@@ -39,6 +39,8 @@ either expressed or implied, of the FreeBSD Project.
 #include "specification.h"
 #include "row.h"
 #include "cell.h"
+#include "arena.h"
+#include "statistics.h"
 
 namespace csv
 {
@@ -79,6 +81,55 @@ namespace csv
     inline iterator begin() { return iterator(this); }
     inline iterator end()   { return iterator();     }
 
+    inline const spec_type & specification() const { return *_specs; }
+
+    /**
+     * Allocates the buffers and cells of rows_per_arena consecutive rows 
+     * in one arena. The arena is released in bulk when the last of its 
+     * rows is destroyed.
+     */
+    BasicReader & withArena(::std::size_t rows_per_arena = 1024,
+                            ::std::size_t block_size = Arena::default_block_size);
+    BasicReader & withoutArena();
+
+    /**
+     * Counters of the reader. Only collected if CSV_ENABLE_STATISTICS
+     * is defined, all counters are 0 otherwise.
+     */
+    inline ReaderStatistics stats() const;
+
+    /**
+     * Heap bytes held by the reader: the tokenizer's buffers and cells
+     * and the dictionaries of the specification. Rows are accounted by 
+     * BasicRow::memoryUsage().
+     */
+    ::std::size_t memoryUsage() const;
+
+    /**
+     * In lenient mode malformed rows are skipped up to the next newline
+     * instead of throwing a ParseError. The first max_errors errors are
+     * kept in errors().
+     */
+    BasicReader & withLenientParsing(::std::size_t max_errors = 1000);
+    BasicReader & withoutLenientParsing();
+    inline bool isLenient() const { return _lenient; }
+    inline const ParseErrorLog & errors() const { return _errors; }
+
+    /**
+     * Row access without row or cell objects for bulk consumers:
+     * nextRawRow() advances to the next row and returns false at the
+     * end of the input. The cell ranges point into the reader's buffers
+     * and are valid until the next call. Do not mix with begin() / end().
+     */
+    inline bool nextRawRow();
+    inline ::std::size_t rawRowSize() const { return _last_cells.size(); }
+    inline void rawCell(::std::size_t i, 
+                        const char_type *& begin, 
+                        const char_type *& end) const { cellData(i, begin, end); }
+    /** csv row and input line of the current raw row */
+    inline ::std::size_t rawRow() const;
+    inline ::std::size_t rawInputLine() const { return _flushed_input_line; }
+
   protected:
     enum class State
     {
@@ -91,6 +142,7 @@ namespace csv
       UNQUOTED_COL,
       UNQUOTED_COL_RIGHT_WS,
       COMMENT,
+      SKIP_LINE,
       END
     };
     typedef typename row_type::buffer_type        buffer_type;
@@ -98,6 +150,8 @@ namespace csv
     typedef typename row_type::shared_spec_type   shared_spec_type;
     typedef typename row_type::cell_type          cell_type;
     typedef typename row_type::range_type         range_type;
+    typedef typename row_type::cell_vector_type   cell_vector_type;
+    typedef typename cell_type::allocator_type    allocator_type;
 
     istream_type                                & _ist;
     shared_spec_type                              _specs;
@@ -107,8 +161,21 @@ namespace csv
     row_type                                      _current_row;
     shared_buffer_type                            _last_buffer;
     shared_buffer_type                            _buffer;
-    ::std::vector<cell_type>                      _last_cells;
-    ::std::vector<cell_type>                      _cells;
+    ::std::vector<range_type>                     _last_cells;
+    ::std::vector<range_type>                     _cells;
+
+    // arena
+    allocator_type                                _allocator;
+    ::std::size_t                                 _rows_per_arena;
+    ::std::size_t                                 _arena_block_size;
+    ::std::size_t                                 _arena_rows;
+
+    CSV_STATISTICS(ReaderStatistics               _stats;)
+    CSV_STATISTICS(::std::size_t                  _buffer_capacity;)
+
+    // lenient mode
+    bool                                          _lenient;
+    ParseErrorLog                                 _errors;
 
     // state
     State                                         _state;
@@ -117,6 +184,7 @@ namespace csv
     ::std::size_t                                 _last_unquoted_non_ws_pos;
     ::std::size_t                                 _current_input_line;
     ::std::size_t                                 _current_input_column;
+    ::std::size_t                                 _input_offset;
     ::std::size_t                                 _last_input_line;
     ::std::size_t                                 _flushed_input_line;
     ::std::size_t                                 _last_cell_input_line;
@@ -133,6 +201,13 @@ namespace csv
     inline void flush();
     inline void addCell();
     inline void addEmptyCell();
+    inline void encode(range_type & range);
+    CSV_STATISTICS(inline void countStatistics(State previous, int ch);)
+    inline void fillRow(row_type & row);
+    void error(ParseErrorCode code, int ch);
+    inline void cellData(::std::size_t i, 
+                         const char_type *& begin, 
+                         const char_type *& end) const;
 
     void scanStateStart(int ch);
     void scanStateWhiteSpaceBeforeNextCol(int ch);
@@ -143,6 +218,7 @@ namespace csv
     void scanUnquotedCol(int ch);
     void scanUnquotedColRightWS(int ch);
     void scanStateComment(int ch);
+    void scanStateSkipLine(int ch);
     bool consume();
   };
 
@@ -160,7 +236,6 @@ namespace csv
   {
     row._shared_spec   = reader->_specs;
     row._shared_buffer = reader->_last_buffer;
-    row._cells         = reader->_last_cells;
     row._input_line    = reader->_last_input_line;
     ++*this;
   }
@@ -191,14 +266,11 @@ namespace csv
   {
     if(reader) 
     {
+      CSV_STATISTICS(StatisticsTimer timer(&reader->_stats.tokenize_time));
       while(reader->consume());
       if(reader->_has_been_flushed) 
       {
-        row._shared_spec          = reader->_specs;
-        row._shared_buffer        = reader->_last_buffer; 
-        row._cells                = reader->_last_cells;
-        row._input_line           = reader->_flushed_input_line;
-        row._row                  = reader->_last_buffer_csv_row;
+        reader->fillRow(row);
         reader->_has_been_flushed = false;
       }
       else if(reader->_state == BasicReader::State::END) 
@@ -241,11 +313,12 @@ namespace csv
     _buffer                   = ::std::make_shared<buffer_type>();
     _last_buffer              = ::std::make_shared<buffer_type>();
     _specs                    = ::std::make_shared<spec_type>(specs);
-    _quote                    = '"';
+    _quote                    = _specs->quote();
     _last_input_line          = 0;
     _flushed_input_line       = 0;
     _current_input_line       = 0;
     _current_input_column     = 0;
+    _input_offset             = 0;
     _last_cell_input_line     = 0;
     _last_cell_input_column   = 0;
     _csv_row                  = 0;
@@ -258,6 +331,15 @@ namespace csv
     _has_been_flushed         = false;
     _last_unquoted_non_ws_pos = 0;
 
+    _rows_per_arena           = 0;
+    _arena_block_size         = 0;
+    _arena_rows               = 0;
+    _lenient                  = false;
+
+    CSV_STATISTICS(_buffer_capacity = 0);
+    CSV_STATISTICS(_specs->_conversion_statistics = 
+                   ::std::make_shared<ConversionStatistics>());
+
     if(_specs->hasHeader()) 
     {
       // read header from file
@@ -284,55 +366,251 @@ namespace csv
         column++;
       }
     }
+    _specs->initDictionaries();
   }
   
+  template<typename CHAR, typename TRAITS>
+  BasicReader<CHAR,TRAITS> & 
+  BasicReader<CHAR,TRAITS>::withArena(::std::size_t rows_per_arena,
+                                      ::std::size_t block_size)
+  {
+    _rows_per_arena   = rows_per_arena ? rows_per_arena : 1;
+    _arena_block_size = block_size;
+    _arena_rows       = 0;
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ReaderStatistics BasicReader<CHAR,TRAITS>::stats() const
+  {
+    ReaderStatistics ret;
+    CSV_STATISTICS(ret = _stats);
+    CSV_STATISTICS(ret.conversions = _specs->_conversion_statistics->conversions());
+    CSV_STATISTICS(ret.conversion_time = _specs->_conversion_statistics->time());
+    return ret;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicReader<CHAR,TRAITS>::memoryUsage() const
+  {
+    ::std::size_t ret = 
+      (_cells.capacity() + _last_cells.capacity()) * sizeof(range_type);
+    // the last buffer is owned by the most recent row
+    if(_buffer)
+    {
+      ret += _buffer->capacity() * sizeof(char_type);
+    }
+    for(auto & dictionary : _specs->_dictionaries)
+    {
+      if(dictionary)
+      {
+        ret += dictionary->memoryUsage();
+      }
+    }
+    return ret;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicReader<CHAR,TRAITS> & BasicReader<CHAR,TRAITS>::withoutArena()
+  {
+    _rows_per_arena = 0;
+    _allocator      = allocator_type();
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicReader<CHAR,TRAITS> & 
+  BasicReader<CHAR,TRAITS>::withLenientParsing(::std::size_t max_errors)
+  {
+    _lenient = true;
+    _errors  = ParseErrorLog(max_errors);
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicReader<CHAR,TRAITS> & BasicReader<CHAR,TRAITS>::withoutLenientParsing()
+  {
+    _lenient = false;
+    return *this;
+  }
+
   // state automaton
   template<typename CHAR, typename TRAITS>
   inline void BasicReader<CHAR,TRAITS>::flush()
   {
     if( _is_end_of_row ) 
     {
-      _last_buffer         = _buffer;
+      if(_rows_per_arena)
+      {
+        if(_arena_rows == 0)
+        {
+          auto arena = ::std::make_shared<Arena>(_arena_block_size);
+          if(_allocator.arena())
+          {
+            // the rest of the last block is not wasted
+            arena->continueFrom(*_allocator.arena());
+          }
+          _allocator = allocator_type(arena);
+        }
+        _arena_rows = (_arena_rows + 1) % _rows_per_arena;
+        // the working buffer is reused, the row gets an exact copy
+        _last_buffer = ::std::allocate_shared<buffer_type>(_allocator,
+                                                           _buffer->begin(),
+                                                           _buffer->end(),
+                                                           _allocator);
+        _buffer->clear();
+      }
+      else
+      {
+        _last_buffer = _buffer;
+        _buffer      = std::make_shared<buffer_type>();
+      }
       _last_buffer_csv_row = _buffer_csv_row;
-      _last_cells          = _cells;
       _flushed_input_line  = _last_input_line;
-      _buffer              = std::make_shared<buffer_type>();
+      CSV_STATISTICS(_stats.rows++);
+      CSV_STATISTICS(_stats.max_row_width = ::std::max(_stats.max_row_width, 
+                                                       _cells.size()));
+      CSV_STATISTICS(_buffer_capacity = _buffer->capacity());
       _buffer_csv_row      = _csv_row;
       _has_been_flushed    = true;
       _is_end_of_row       = false;
+      _last_cells.swap(_cells);
       _cells.clear();
     }
   }
 
+  /**
+   * Cells of the flushed row are kept as ranges in the buffer,
+   * they are only turned into cell objects when a row is requested.
+   */
+  template<typename CHAR, typename TRAITS>
+  inline void BasicReader<CHAR,TRAITS>::fillRow(row_type & row)
+  {
+    row._shared_spec   = _specs;
+    row._shared_buffer = _last_buffer;
+    row._input_line    = _flushed_input_line;
+    row._row           = _last_buffer_csv_row;
+    // the cells of the iterator's row are reused until the arena changes,
+    // copies of the row are allocated in the same arena
+    if(row._cells.get_allocator() != _allocator)
+    {
+      row._cells = cell_vector_type(typename row_type::allocator_type(_allocator));
+    }
+    else
+    {
+      row._cells.clear();
+    }
+    row._cells.reserve(_last_cells.size());
+    for(std::size_t i = 0; i < _last_cells.size(); i++)
+    {
+      const range_type & range = _last_cells[i];
+      if(range._code == spec_type::npos)
+      {
+        row._cells.push_back(cell_type(_specs,
+                                       _specs->addColumnIfNotExists(i),
+                                       _last_buffer,
+                                       range));
+      }
+      else
+      {
+        // encoded cells refer to the dictionary's storage
+        auto & dictionary = _specs->_dictionaries[i];
+        range_type encoded(range);
+        encoded._begin = dictionary->offset(range._code);
+        encoded._end   = encoded._begin + dictionary->length(range._code);
+        row._cells.push_back(cell_type(_specs,
+                                       _specs->addColumnIfNotExists(i),
+                                       dictionary->buffer(range._code),
+                                       encoded));
+      }
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicReader<CHAR,TRAITS>::cellData(::std::size_t i,
+                                                 const char_type *& begin,
+                                                 const char_type *& end) const
+  {
+    const range_type & range = _last_cells[i];
+    if(range._code == spec_type::npos)
+    {
+      begin = _last_buffer->data() + range._begin;
+      end   = _last_buffer->data() + range._end;
+    }
+    else
+    {
+      auto & dictionary = _specs->_dictionaries[i];
+      begin = dictionary->data(range._code);
+      end   = begin + dictionary->length(range._code);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline bool BasicReader<CHAR,TRAITS>::nextRawRow()
+  {
+    while(consume());
+    if(_has_been_flushed)
+    {
+      _has_been_flushed = false;
+      return true;
+    }
+    return false;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicReader<CHAR,TRAITS>::rawRow() const
+  {
+    return _last_cells.empty() ? 0 : _last_cells.front()._csv_row;
+  }
+
+  /**
+   * Moves the content of a cell in a dictionary column from the 
+   * buffer into the dictionary.
+   */
+  template<typename CHAR, typename TRAITS>
+  inline void BasicReader<CHAR,TRAITS>::encode(range_type & range)
+  {
+    ::std::size_t index = _cells.size();
+    if(index < _specs->_dictionaries.size() && _specs->_dictionaries[index])
+    {
+      const char_type * data = _buffer->data();
+      range._code = _specs->_dictionaries[index]->intern(data + range._begin,
+                                                         data + range._end);
+      _buffer->resize(range._begin);
+      range._end = range._begin;
+    }
+  }
+
   template<typename CHAR, typename TRAITS>
   void BasicReader<CHAR,TRAITS>::addCell()
   {
-    std::size_t n = _cells.empty() ? 0 : _cells.back()._range._end;
-    auto x = _specs->addColumnIfNotExists(_cells.size());
-    _cells.push_back(cell_type(_specs,
-                               _specs->addColumnIfNotExists(_cells.size()),
-                               _buffer, 
-                               range_type(n,
-                                          _buffer->size(),
-                                          _csv_row,
-                                          _csv_column,
-                                          _last_cell_input_line,
-                                          _last_cell_input_column)));
+    std::size_t n = _cells.empty() ? 0 : _cells.back()._end;
+    range_type range(n,
+                     _buffer->size(),
+                     _csv_row,
+                     _csv_column,
+                     _last_cell_input_line,
+                     _last_cell_input_column);
+    CSV_STATISTICS(_stats.cells++);
+    CSV_STATISTICS(_stats.max_cell_length = ::std::max(_stats.max_cell_length,
+                                                       range._end - range._begin));
+    encode(range);
+    _cells.push_back(range);
   }
 
   template<typename CHAR, typename TRAITS>
   void BasicReader<CHAR,TRAITS>::addEmptyCell()
   {
-    std::size_t n = _cells.empty() ? 0 : _cells.back()._range._end;
-    _cells.push_back( cell_type( _specs,
-                                 _specs->addColumnIfNotExists(_cells.size()),
-                                 _buffer, 
-                                 range_type( n,
-                                             n,
-                                             _csv_row,
-                                             _csv_column,
-                                             _last_cell_input_line,
-                                             _last_cell_input_column)));
+    std::size_t n = _cells.empty() ? 0 : _cells.back()._end;
+    range_type range(n,
+                     n,
+                     _csv_row,
+                     _csv_column,
+                     _last_cell_input_line,
+                     _last_cell_input_column);
+    CSV_STATISTICS(_stats.cells++);
+    encode(range);
+    _cells.push_back(range);
   }
 
   template<typename CHAR, typename TRAITS>
@@ -359,6 +637,45 @@ namespace csv
     return ch == EOF;
   }
 
+  /**
+   * Throws a ParseError, or in lenient mode logs the error, drops the 
+   * cells of the current row and skips the rest of the line.
+   */
+  template<typename CHAR, typename TRAITS>
+  void BasicReader<CHAR,TRAITS>::error(ParseErrorCode code, int ch)
+  {
+    if(!_lenient)
+    {
+      throw ParseError(parseErrorMessage(code),
+                       _current_input_line,
+                       _current_input_column,
+                       _csv_row,
+                       _csv_column);
+    }
+    // offset of the offending character or of the end of input
+    _errors.add(ParseErrorRecord{_input_offset - 1,
+                                 _current_input_line,
+                                 _current_input_column,
+                                 _csv_row,
+                                 _csv_column,
+                                 code});
+    _cells.clear();
+    _buffer->clear();
+    _is_end_of_row  = false;
+    _csv_column     = 0;
+    _csv_row++;
+    // the next row starts without a flush
+    _buffer_csv_row = _csv_row;
+    if(isEof(ch))
+    {
+      _state = State::END;
+    }
+    else
+    {
+      _state = State::SKIP_LINE;
+    }
+  }
+
   template<typename CHAR, typename TRAITS>
   void BasicReader<CHAR,TRAITS>::scanStateStart(int ch) 
   {
@@ -399,6 +716,7 @@ namespace csv
       _last_cell_input_line   = _current_input_line;
       _last_cell_input_column = _current_input_column;
       _state = State::QUOTED_COL;
+      CSV_STATISTICS(_stats.quoted_cells++);
     }
     else if( _specs->isComment(ch))
     {
@@ -459,6 +777,7 @@ namespace csv
     {
       flush();
       _state = State::QUOTED_COL;
+      CSV_STATISTICS(_stats.quoted_cells++);
     }
     else 
     {
@@ -519,6 +838,7 @@ namespace csv
       _last_cell_input_line = _current_input_line;
       _last_cell_input_column = _current_input_column;
       _state = State::QUOTED_COL;
+      CSV_STATISTICS(_stats.quoted_cells++);
     }
     else 
     {
@@ -543,7 +863,7 @@ namespace csv
     }
     else 
     {
-      throw std::exception();
+      error(ParseErrorCode::UNTERMINATED_QUOTE, ch);
     }
   }
 
@@ -554,6 +874,7 @@ namespace csv
     {
       _buffer->push_back(_quote);
       _state = State::QUOTED_COL;
+      CSV_STATISTICS(_stats.escaped_quotes++);
     }
     else if(_specs->isSeparator(ch)) 
     {
@@ -601,11 +922,7 @@ namespace csv
     }
     else 
     {
-      throw ParseError("Unexpected character at the end of quoted cell.",
-                       _current_input_line,
-                       _current_input_column,
-                       _csv_row,
-                       _csv_column);
+      error(ParseErrorCode::UNEXPECTED_CHARACTER_AFTER_QUOTE, ch);
     }
   }
 
@@ -642,8 +959,7 @@ namespace csv
     }
     else 
     {
-      // error
-      throw std::exception();
+      error(ParseErrorCode::UNEXPECTED_CHARACTER_AFTER_QUOTE, ch);
     }
   }
 
@@ -764,6 +1080,43 @@ namespace csv
       _state = State::END;
     }
   }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicReader<CHAR,TRAITS>::scanStateSkipLine(int ch)
+  {
+    if(isNewline(ch)) 
+    {
+      _state = State::START;
+    }
+    else if(isEof(ch))
+    {
+      _state = State::END;
+    }
+  }
+#ifdef CSV_ENABLE_STATISTICS
+  template<typename CHAR, typename TRAITS>
+  inline void BasicReader<CHAR,TRAITS>::countStatistics(State previous, int ch)
+  {
+    if(!isEof(ch))
+    {
+      _stats.bytes++;
+    }
+    if(_state == State::COMMENT && previous != State::COMMENT)
+    {
+      _stats.comment_lines++;
+    }
+    if(previous == State::START && isNewline(ch))
+    {
+      _stats.empty_lines++;
+    }
+    if(_buffer->capacity() != _buffer_capacity)
+    {
+      _stats.buffer_reallocations++;
+      _buffer_capacity = _buffer->capacity();
+    }
+  }
+#endif
+
   template<typename CHAR, typename TRAITS>
   bool BasicReader<CHAR,TRAITS>::consume()
   {
@@ -774,12 +1127,16 @@ namespace csv
     }
     if(_ist.good()) 
     {
+      CSV_STATISTICS(State previous = _state);
       int ch = _ist.get();
+      _input_offset++;
       if(ch == '\r') 
       {
         if(_ist.good() && _ist.peek() == '\n') 
         {
           _ist.get();
+          _input_offset++;
+          CSV_STATISTICS(_stats.bytes++);
         }
         ch = '\n';
       }
@@ -821,6 +1178,10 @@ namespace csv
         scanStateComment(ch);          
         break;
 
+      case State::SKIP_LINE:
+        scanStateSkipLine(ch);
+        break;
+
       default:
         // error invalid _state
         // never should end here
@@ -833,6 +1194,7 @@ namespace csv
                          _csv_column);
         break;
       }
+      CSV_STATISTICS(countStatistics(previous, ch));
       if(isNewline(ch)) 
       {
         _current_input_line++;
@@ -845,10 +1207,11 @@ namespace csv
     }
     else 
     {
-      // error
-      std::cout << "error 1" << std::endl;
-      throw std::exception();
-      return false;
+      throw ParseError("Cannot read from input stream.",
+                       _current_input_line,
+                       _current_input_column,
+                       _csv_row,
+                       _csv_column);
     }
     return !_has_been_flushed;
   }
@@ -47,18 +47,20 @@ namespace csv
     typedef typename cell_type::spec_type                    spec_type;
     typedef std::shared_ptr<spec_type>                       shared_spec_type;
     typedef typename cell_type::string_type                  string_type;
-    typedef typename std::vector<cell_type>::value_type      value_type;
-    typedef typename std::vector<cell_type>::size_type       size_type;
-    typedef typename std::vector<cell_type>::difference_type difference_type;
-    typedef typename std::vector<cell_type>::const_reference const_reference;
-    typedef typename std::vector<cell_type>::const_pointer   const_pointer;
-    typedef typename std::vector<cell_type>::const_iterator  const_iterator;
+    typedef ArenaAllocator<cell_type>                        allocator_type;
+    typedef std::vector<cell_type, allocator_type>           cell_vector_type;
+    typedef typename cell_vector_type::value_type            value_type;
+    typedef typename cell_vector_type::size_type             size_type;
+    typedef typename cell_vector_type::difference_type       difference_type;
+    typedef typename cell_vector_type::const_reference       const_reference;
+    typedef typename cell_vector_type::const_pointer         const_pointer;
+    typedef typename cell_vector_type::const_iterator        const_iterator;
     typedef typename 
-    std::vector<cell_type>::const_reverse_iterator    const_reverse_iterator;
+    cell_vector_type::const_reverse_iterator          const_reverse_iterator;
 
     BasicRow();
     BasicRow(const BasicRow<char_type, char_traits> & rhs);
-    BasicRow(const BasicRow<char_type, char_traits> && rhs);
+    BasicRow(BasicRow<char_type, char_traits> && rhs) noexcept;
     BasicRow(const spec_type & spec);
     BasicRow(const shared_spec_type & spec);
 
@@ -72,7 +74,7 @@ namespace csv
     BasicRow(const C & container, const shared_spec_type & spec) ;
 
     BasicRow & operator=(const BasicRow & rhs);
-    BasicRow & operator=(const BasicRow && rhs);
+    BasicRow & operator=(BasicRow && rhs) noexcept;
 
     inline std::size_t size() const               { return _cells.size();    }
     inline const_iterator begin() const           { return _cells.begin();   }
@@ -86,17 +88,25 @@ namespace csv
 
     inline const cell_type & operator[](std::size_t i) const;
     inline const cell_type & operator[](const string_type & name) const ;
+    inline const cell_type & operator[](const ColumnHandle & handle) const;
     inline const_iterator find(const string_type & name) const;
+    inline const_iterator find(const ColumnHandle & handle) const;
 
     inline ::std::size_t inputLine() const        { return _input_line; }
     inline ::std::size_t row() const              { return _row; }
 
+    /**
+     * Heap bytes of the cells and of the buffer of the row. The buffer
+     * is shared by copies of the row, values of dictionary columns are
+     * accounted by the dictionary.
+     */
+    inline ::std::size_t memoryUsage() const;
+
   private:
     friend class BasicReader<char_type, char_traits>;
     typedef typename cell_type::buffer_type            buffer_type;
     typedef typename cell_type::shared_buffer_type     shared_buffer_type;
     typedef typename cell_type::range_type             range_type;
-    typedef typename ::std::vector<cell_type>          cell_vector_type;
     typedef typename spec_type::Column                 column_type;
     typedef typename ::std::shared_ptr<column_type>    shared_column_type;
     shared_spec_type                                   _shared_spec;
@@ -114,6 +124,7 @@ namespace csv
     inline void getLastRowColumnInputColumn(::std::size_t & csv_row,
                                             ::std::size_t & csv_column,
                                             ::std::size_t & input_column) const;
+    inline const cell_type & definedCell(::std::size_t i) const;
   };
 
   //////////////////////////////////////////////////////////////////////
@@ -131,10 +142,10 @@ namespace csv
   {}
 
   template<typename CHAR, typename TRAITS>
-  BasicRow<CHAR,TRAITS>::BasicRow(const BasicRow<char_type, char_traits> && 
-                                  rhs)
-    : _shared_spec(rhs._shared_spec),
-      _shared_buffer(rhs._shared_buffer),
+  BasicRow<CHAR,TRAITS>::BasicRow(BasicRow<char_type, char_traits> && 
+                                  rhs) noexcept
+    : _shared_spec(::std::move(rhs._shared_spec)),
+      _shared_buffer(::std::move(rhs._shared_buffer)),
       _input_line(rhs._input_line),
       _row(rhs._row),
       _cells(::std::move(rhs._cells))
@@ -211,18 +222,32 @@ namespace csv
     _shared_buffer = rhs._shared_buffer;
     _cells         = rhs._cells;
     _input_line    = rhs._input_line;
+    _row           = rhs._row;
     return *this;
   }
 
   template<typename CHAR, typename TRAITS>
   BasicRow<CHAR,TRAITS> & 
-  BasicRow<CHAR,TRAITS>::operator=(const BasicRow<CHAR,TRAITS> && rhs) 
+  BasicRow<CHAR,TRAITS>::operator=(BasicRow<CHAR,TRAITS> && rhs) noexcept
   {
+    _shared_spec   = ::std::move(rhs._shared_spec);
     _shared_buffer = ::std::move(rhs._shared_buffer);
     _cells         = ::std::move(rhs._cells);
     _input_line    = rhs._input_line;
+    _row           = rhs._row;
     return *this;
   }
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicRow<CHAR,TRAITS>::memoryUsage() const
+  {
+    ::std::size_t ret = _cells.capacity() * sizeof(cell_type);
+    if(_shared_buffer)
+    {
+      ret += _shared_buffer->capacity() * sizeof(char_type);
+    }
+    return ret;
+  }
+
   template<typename CHAR, typename TRAITS>
   inline void BasicRow<CHAR,TRAITS>::
   getLastRowColumnInputColumn(::std::size_t & csv_row,
@@ -275,8 +300,21 @@ namespace csv
   const typename BasicRow<CHAR,TRAITS>::cell_type & 
   BasicRow<CHAR,TRAITS>::operator[](const string_type & name) const 
   {
-    auto itr = _shared_spec->_lookup.find(name);
-    if(itr == _shared_spec->_lookup.end())
+    return definedCell(_shared_spec->columnIndex(name));
+  }
+
+  template<typename CHAR, typename TRAITS>
+  const typename BasicRow<CHAR,TRAITS>::cell_type & 
+  BasicRow<CHAR,TRAITS>::operator[](const ColumnHandle & handle) const 
+  {
+    return definedCell(handle.index());
+  }
+
+  template<typename CHAR, typename TRAITS>
+  const typename BasicRow<CHAR,TRAITS>::cell_type & 
+  BasicRow<CHAR,TRAITS>::definedCell(::std::size_t i) const 
+  {
+    if(i == spec_type::npos)
     {
       ::std::size_t         csv_row;
       ::std::size_t         csv_column;
@@ -290,50 +328,44 @@ namespace csv
                              csv_row,
                              csv_column);
     }
+    else if(i >= _cells.size()) 
+    {
+      ::std::size_t         csv_row;
+      ::std::size_t         csv_column;
+      ::std::size_t         input_column;
+      getLastRowColumnInputColumn(csv_row, csv_column, input_column);
+      throw 
+        DefinedCellOutOfRangeError("Named column out of range.",
+                                   i,
+                                   _cells.size(),
+                                   inputLine(),
+                                   input_column,
+                                   csv_row,
+                                   csv_column);
+    }
     else 
     {
-      std::size_t i = itr->second->index();
-      if(i >= _cells.size()) 
-      {
-        ::std::size_t         csv_row;
-        ::std::size_t         csv_column;
-        ::std::size_t         input_column;
-        getLastRowColumnInputColumn(csv_row, csv_column, input_column);
-        throw 
-          DefinedCellOutOfRangeError("Named column out of range.",
-                                     i,
-                                     _cells.size(),
-                                     inputLine(),
-                                     input_column,
-                                     csv_row,
-                                     csv_column);
-      }
-      else 
-      {
-        return _cells[i];
-      }
+      return _cells[i];
     }
   }
 
   template<typename CHAR, typename TRAITS>
   typename BasicRow<CHAR,TRAITS>::const_iterator BasicRow<CHAR,TRAITS>::find(const string_type & name) const
   {
-    auto itr = _shared_spec->_lookup.find(name);
-    if(itr == _shared_spec->_lookup.end())
+    return find(ColumnHandle(_shared_spec->columnIndex(name)));
+  }
+
+  template<typename CHAR, typename TRAITS>
+  typename BasicRow<CHAR,TRAITS>::const_iterator BasicRow<CHAR,TRAITS>::find(const ColumnHandle & handle) const
+  {
+    // an invalid handle is npos and never a valid index
+    if(handle.index() >= _cells.size())
     {
-      //return end();
+      return end();
     }
     else
     {
-      std::size_t i = itr->second->index();
-      if(i >= _cells.size())
-      {
-        //return end();
-      }
-      else
-      {
-        return _cells.begin() + i;
-      }
+      return _cells.begin() + handle.index();
     }
   }
 
@@ -0,0 +1,162 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace csv
+{
+  /**
+   * Small set of characters with a (vectorized for char) search
+   * for the first occurrence of any of its members in a range.
+   */
+  template<typename CHAR>
+  class BasicCharSet
+  {
+  public:
+    typedef CHAR char_type;
+    static const ::std::size_t max_size = 8;
+
+    BasicCharSet();
+
+    inline bool insert(char_type ch);
+    inline bool contains(char_type ch) const;
+    inline ::std::size_t size() const;
+    inline const char_type * find(const char_type * begin,
+                                  const char_type * end) const;
+
+  private:
+    inline const char_type * findScalar(const char_type * begin,
+                                        const char_type * end) const;
+
+    char_type     _chars[max_size];
+    ::std::size_t _size;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////////
+  template<typename CHAR>
+  BasicCharSet<CHAR>::BasicCharSet() : _size(0)
+  {
+  }
+
+  template<typename CHAR>
+  inline bool BasicCharSet<CHAR>::insert(char_type ch)
+  {
+    if(contains(ch))
+    {
+      return true;
+    }
+    if(_size == max_size)
+    {
+      return false;
+    }
+    _chars[_size++] = ch;
+    return true;
+  }
+
+  template<typename CHAR>
+  inline bool BasicCharSet<CHAR>::contains(char_type ch) const
+  {
+    for(::std::size_t i = 0; i < _size; i++)
+    {
+      if(_chars[i] == ch)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template<typename CHAR>
+  inline ::std::size_t BasicCharSet<CHAR>::size() const
+  {
+    return _size;
+  }
+
+  template<typename CHAR>
+  inline const typename BasicCharSet<CHAR>::char_type *
+  BasicCharSet<CHAR>::findScalar(const char_type * begin,
+                                 const char_type * end) const
+  {
+    for(; begin != end; ++begin)
+    {
+      if(contains(*begin))
+      {
+        return begin;
+      }
+    }
+    return end;
+  }
+
+  template<typename CHAR>
+  inline const typename BasicCharSet<CHAR>::char_type *
+  BasicCharSet<CHAR>::find(const char_type * begin,
+                           const char_type * end) const
+  {
+    return findScalar(begin, end);
+  }
+
+  template<>
+  inline const char * BasicCharSet<char>::find(const char * begin,
+                                               const char * end) const
+  {
+#ifdef __SSE2__
+    __m128i needles[max_size];
+    for(::std::size_t i = 0; i < _size; i++)
+    {
+      needles[i] = _mm_set1_epi8(_chars[i]);
+    }
+    while(end - begin >= 16)
+    {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+      __m128i match = _mm_setzero_si128();
+      for(::std::size_t i = 0; i < _size; i++)
+      {
+        match = _mm_or_si128(match, _mm_cmpeq_epi8(block, needles[i]));
+      }
+      int mask = _mm_movemask_epi8(match);
+      if(mask)
+      {
+        return begin + __builtin_ctz(mask);
+      }
+      begin+= 16;
+    }
+#endif
+    return findScalar(begin, end);
+  }
+
+} // namespace csv
@@ -33,9 +33,30 @@ either expressed or implied, of the FreeBSD Project.
 #include <exception>
 #include <sstream>
 #include <typeindex>
+#include <streambuf>
+#include <istream>
+#include <limits>
+#include <type_traits>
+#include "utf8.h"
 
 namespace csv
 {
+  /**
+   * Read only stream buffer over a range of characters, 
+   * used to parse cell content without copying it into a string.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicRangeBuffer : public ::std::basic_streambuf<CHAR, TRAITS>
+  {
+  public:
+    BasicRangeBuffer(const CHAR * begin, const CHAR * end)
+    {
+      this->setg(const_cast<CHAR*>(begin),
+                 const_cast<CHAR*>(begin),
+                 const_cast<CHAR*>(end));
+    }
+  };
+
   class BasicSerializerFailure : public ::std::exception
   {
   public:
@@ -59,6 +80,150 @@ namespace csv
   };
 
 
+  /**
+   * Conversion of plain numbers without a stream.
+   * parse() returns false if the input is not handled by the fast path, 
+   * the caller falls back to the stream based conversion in that case.
+   */
+  template<typename CHAR, typename TARGET, typename ENABLE=void>
+  class BasicFastParser
+  {
+  public:
+    static inline bool parse(const CHAR *, const CHAR *,
+                             const ::std::locale &, TARGET &)
+    {
+      return false;
+    }
+  };
+
+  /**
+   * Integers: [+-]digits surrounded by spaces or tabs.
+   */
+  template<typename CHAR, typename TARGET>
+  class BasicFastParser<CHAR, TARGET,
+                        typename ::std::enable_if<
+                          ::std::is_integral<TARGET>::value &&
+                          !::std::is_same<TARGET, bool>::value &&
+                          !::std::is_same<TARGET, char>::value &&
+                          !::std::is_same<TARGET, signed char>::value &&
+                          !::std::is_same<TARGET, unsigned char>::value &&
+                          !::std::is_same<TARGET, wchar_t>::value &&
+                          !::std::is_same<TARGET, char16_t>::value &&
+                          !::std::is_same<TARGET, char32_t>::value>::type>
+  {
+  public:
+    static inline bool parse(const CHAR * begin, const CHAR * end,
+                             const ::std::locale &, TARGET & value)
+    {
+      typedef typename ::std::make_unsigned<TARGET>::type unsigned_type;
+      while(begin != end && (*begin == ' ' || *begin == '\t')) ++begin;
+      while(begin != end && (end[-1] == ' ' || end[-1] == '\t')) --end;
+      bool negative = false;
+      if(begin != end && (*begin == '-' || *begin == '+'))
+      {
+        negative = (*begin == '-');
+        ++begin;
+      }
+      if(begin == end || (negative && !::std::is_signed<TARGET>::value))
+      {
+        return false;
+      }
+      unsigned_type limit = negative ? 
+        unsigned_type(::std::numeric_limits<TARGET>::max()) + 1u :
+        unsigned_type(::std::numeric_limits<TARGET>::max());
+      unsigned_type result = 0;
+      for(; begin != end; ++begin)
+      {
+        if(*begin < '0' || *begin > '9')
+        {
+          return false;
+        }
+        unsigned_type digit = unsigned_type(*begin - '0');
+        if(result > (limit - digit) / 10u)
+        {
+          return false;
+        }
+        result = result * 10u + digit;
+      }
+      value = negative ? TARGET(unsigned_type(0u) - result) : TARGET(result);
+      return true;
+    }
+  };
+
+  /**
+   * float and double: [+-]digits[.digits] with at most as many significant 
+   * digits as are exact in the mantissa. The value is then the quotient 
+   * of two exact numbers and correctly rounded. 
+   * Exponents, grouping, nan and inf are left to the stream.
+   */
+  template<typename CHAR, typename TARGET>
+  class BasicFastParser<CHAR, TARGET,
+                        typename ::std::enable_if<
+                          ::std::is_same<TARGET, float>::value ||
+                          ::std::is_same<TARGET, double>::value>::type>
+  {
+  public:
+    static inline bool parse(const CHAR * begin, const CHAR * end,
+                             const ::std::locale & locale, TARGET & value)
+    {
+      // largest k with 10^k exact in TARGET
+      static const int max_exponent = 
+        ::std::is_same<TARGET, float>::value ? 10 : 22;
+      static const unsigned long long max_mantissa = 
+        1ull << ::std::numeric_limits<TARGET>::digits;
+      static const TARGET powers[] = 
+        { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 
+          1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+      while(begin != end && (*begin == ' ' || *begin == '\t')) ++begin;
+      while(begin != end && (end[-1] == ' ' || end[-1] == '\t')) --end;
+      bool negative = false;
+      if(begin != end && (*begin == '-' || *begin == '+'))
+      {
+        negative = (*begin == '-');
+        ++begin;
+      }
+      CHAR point = ::std::use_facet< ::std::numpunct<CHAR> >(locale).decimal_point();
+      unsigned long long mantissa = 0;
+      int exponent = 0;
+      bool has_digits = false;
+      bool has_point = false;
+      for(; begin != end; ++begin)
+      {
+        if(*begin >= '0' && *begin <= '9')
+        {
+          mantissa = mantissa * 10u + (unsigned long long)(*begin - '0');
+          if(mantissa > max_mantissa)
+          {
+            return false;
+          }
+          has_digits = true;
+          if(has_point)
+          {
+            exponent++;
+          }
+        }
+        else if(*begin == point && !has_point)
+        {
+          has_point = true;
+        }
+        else
+        {
+          return false;
+        }
+      }
+      if(!has_digits || exponent > max_exponent)
+      {
+        return false;
+      }
+      value = TARGET(mantissa) / powers[exponent];
+      if(negative)
+      {
+        value = -value;
+      }
+      return true;
+    }
+  };
+
   template<typename CHAR, typename TRAITS, typename TARGET>
   class BasicSerializer
   {
@@ -68,16 +233,14 @@ namespace csv
     typedef TARGET                                          return_type;
     typedef std::basic_string<char_type, char_traits>       string_type;
     typedef std::basic_stringstream<char_type, char_traits> stream_type;
+    typedef std::basic_istream<char_type, char_traits>      istream_type;
 
-    static return_type as(stream_type & ss)
+    static bool parse(istream_type & ss, return_type & value)
     {
-      return_type value;
       ss >> value;
       if(ss.fail()) 
       {
-        ::std::type_index ti(typeid(TARGET));
-        throw BasicSerializerFailure(::std::string("Cannot convert cell content ") + ti.name(),
-                                     ti);
+        return false;
       }
       while(!ss.eof())
       {
@@ -85,14 +248,45 @@ namespace csv
         if(ss.eof()) break;
         if(ch != ' ' && ch != '\t') 
         {
-          ::std::type_index ti(typeid(TARGET));
-          throw BasicSerializerFailure(::std::string("Cannot convert cell content ") + ti.name(),
-                                       ti);
+          return false;
         }
       }
+      return true;
+    }
+
+    /**
+     * Converts the range without throwing, returns false on failure.
+     */
+    static bool parse(const char_type * begin, const char_type * end,
+                      const ::std::locale & locale, return_type & value)
+    {
+      if(BasicFastParser<char_type, return_type>::parse(begin, end, locale, value))
+      {
+        return true;
+      }
+      BasicRangeBuffer<char_type, char_traits> buffer(begin, end);
+      istream_type ss(&buffer);
+      ss.imbue(locale);
+      return parse(ss, value);
+    }
+
+    static return_type as(istream_type & ss)
+    {
+      return_type value;
+      if(!parse(ss, value))
+      {
+        throw failure();
+      }
       return value;
     }
 
+    static BasicSerializerFailure failure()
+    {
+      ::std::type_index ti(typeid(TARGET));
+      return BasicSerializerFailure(::std::string("Cannot convert cell content ") + ti.name(),
+                                    ti);
+    }
+
     static return_type as(const string_type & str)
     {
       stream_type ss(str);
@@ -105,6 +299,17 @@ namespace csv
       ss.imbue(locale);
       return as(ss);
     }
+
+    static return_type as(const char_type * begin, const char_type * end,
+                          const ::std::locale & locale)
+    {
+      return_type value;
+      if(!parse(begin, end, locale, value))
+      {
+        throw failure();
+      }
+      return value;
+    }
   };
 
   template<typename CHAR, typename TRAITS>
@@ -116,15 +321,81 @@ namespace csv
     typedef std::basic_string<char_type, char_traits> string_type;
     typedef std::basic_string<CHAR, TRAITS>           return_type;
 
+    static BasicSerializerFailure failure()
+    {
+      ::std::type_index ti(typeid(return_type));
+      return BasicSerializerFailure("Cannot convert cell content", ti);
+    }
+
     static return_type as(const string_type & str)
     {
       return str;
     }
 
-    static return_type as(const string_type & str, const ::std::locale & locale)
+    static return_type as(const string_type & str, const ::std::locale &)
     {
       return str;
     }
+
+    static return_type as(const char_type * begin, const char_type * end,
+                          const ::std::locale &)
+    {
+      return return_type(begin, end);
+    }
+
+    static bool parse(const char_type * begin, const char_type * end,
+                      const ::std::locale &, return_type & value)
+    {
+      value.assign(begin, end);
+      return true;
+    }
   };
 
+  /**
+   * Narrow cells read as ::std::wstring are decoded as UTF-8 in one 
+   * pass, bypassing the codecvt facet of the locale.
+   */
+  template<typename TRAITS>
+  class BasicSerializer<char, TRAITS, ::std::wstring>
+  {
+  public:
+    typedef char                                      char_type;
+    typedef TRAITS                                    char_traits;
+    typedef std::basic_string<char_type, char_traits> string_type;
+    typedef ::std::wstring                            return_type;
+
+    static BasicSerializerFailure failure()
+    {
+      ::std::type_index ti(typeid(return_type));
+      return BasicSerializerFailure("Cannot convert cell content: invalid UTF-8", ti);
+    }
+
+    static return_type as(const string_type & str)
+    {
+      return as(str.data(), str.data() + str.size(), ::std::locale());
+    }
+
+    static return_type as(const string_type & str, const ::std::locale & locale)
+    {
+      return as(str.data(), str.data() + str.size(), locale);
+    }
+
+    static return_type as(const char_type * begin, const char_type * end,
+                          const ::std::locale & locale)
+    {
+      return_type value;
+      if(!parse(begin, end, locale, value))
+      {
+        throw failure();
+      }
+      return value;
+    }
+
+    static bool parse(const char_type * begin, const char_type * end,
+                      const ::std::locale &, return_type & value)
+    {
+      value.clear();
+      return decodeUtf8(begin, end, value);
+    }
+  };
 }
@@ -0,0 +1,835 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <locale>
+#include <memory>
+#include <string>
+#include <vector>
+#include "csv_common.h"
+#include "reader.h"
+#include "writer.h"
+#include "serializer.h"
+#include "thread_pool.h"
+#include "utf8.h"
+
+namespace csv
+{
+  enum class SortKey
+  {
+    LEXICOGRAPHIC,
+    NUMERIC
+  };
+
+  namespace detail
+  {
+    /**
+     * Temporary files removed on destruction.
+     */
+    class TemporaryFiles
+    {
+    public:
+      TemporaryFiles(const ::std::string & directory) : _directory(directory) {}
+      ~TemporaryFiles();
+
+      TemporaryFiles(const TemporaryFiles &) = delete;
+      TemporaryFiles & operator=(const TemporaryFiles &) = delete;
+
+      ::std::string create();
+      void remove(const ::std::string & path);
+
+      static ::std::string defaultDirectory();
+
+    private:
+      ::std::string                _directory;
+      ::std::vector< ::std::string> _paths;
+    };
+
+    // cells of wide runs are stored as UTF-8
+    template<typename TRAITS>
+    inline bool decodeRunCell(const char * begin, const char * end,
+                              ::std::basic_string<char, TRAITS> & out)
+    {
+      out.append(begin, end);
+      return true;
+    }
+
+    template<typename WCHAR, typename TRAITS>
+    inline bool decodeRunCell(const char * begin, const char * end,
+                              ::std::basic_string<WCHAR, TRAITS> & out)
+    {
+      return decodeUtf8(begin, end, out);
+    }
+  }
+
+  /**
+   * External merge sort of CSV input by one or more key columns.
+   *
+   *   csv::Sorter sorter(csv::Specification().withHeader());
+   *   sorter.withKey("date").withKey("amount", csv::SortKey::NUMERIC);
+   *   sorter.sort(ist, ost);
+   *
+   * Rows are buffered up to the memory limit, sorted on a thread pool
+   * and written as runs to temporary files, which are merged at the 
+   * end. Input which fits into memory is sorted without temporary files.
+   * Runs store the cells of each row length prefixed, wide characters 
+   * encoded as UTF-8, so they are not parsed again by the merge.
+   *
+   * The sort is stable. NUMERIC keys order cells which are not numbers 
+   * after all numbers, lexicographically. The header is copied to the 
+   * output if the specification has one. Cells are quoted by the 
+   * writer, i.e. only where needed.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicSorter
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef ::std::basic_string<char_type, char_traits>  string_type;
+    typedef ::std::basic_istream<char_type, char_traits> istream_type;
+    typedef ::std::basic_ostream<char_type, char_traits> ostream_type;
+    typedef BasicReader<char_type, char_traits>          reader_type;
+    typedef BasicWriter<char_type, char_traits>          writer_type;
+    typedef typename reader_type::spec_type              spec_type;
+
+    static const ::std::size_t default_memory_limit = 64u << 20;
+    static const ::std::size_t default_merge_width  = 64;
+
+    BasicSorter(spec_type specs = spec_type());
+
+    BasicSorter & withKey(const string_type & name, 
+                          SortKey type = SortKey::LEXICOGRAPHIC);
+    BasicSorter & withKey(::std::size_t index, 
+                          SortKey type = SortKey::LEXICOGRAPHIC);
+
+    /**
+     * Approximate number of bytes used for buffered rows, shared by 
+     * the runs being read and sorted.
+     */
+    BasicSorter & withMemoryLimit(::std::size_t bytes);
+
+    /**
+     * Maximum number of runs merged at once. More runs are merged in 
+     * several passes.
+     */
+    BasicSorter & withMergeWidth(::std::size_t runs);
+
+    /**
+     * Directory of the temporary files, defaults to TMPDIR.
+     */
+    BasicSorter & withTemporaryDirectory(const ::std::string & directory);
+
+    /**
+     * Sorts the rows of ist into ost. Runs are read on the calling 
+     * thread and sorted and written on the pool. Returns the number of 
+     * rows, the header not included.
+     */
+    ::std::size_t sort(istream_type & ist, ostream_type & ost, ThreadPool & pool);
+    ::std::size_t sort(istream_type & ist, ostream_type & ost, 
+                       ::std::size_t threads = 0);
+
+    /** number of runs written by the last call to sort() */
+    inline ::std::size_t runs() const { return _runs; }
+
+  private:
+    struct Key
+    {
+      string_type   name;
+      ::std::size_t index;
+      SortKey       type;
+    };
+
+    /**
+     * Rows stored back to back. Row r has the cells 
+     * [offsets[rows[r] + i], offsets[rows[r] + i + 1]).
+     */
+    struct Chunk
+    {
+      string_type                   data;
+      ::std::vector< ::std::size_t> offsets;
+      ::std::vector< ::std::size_t> rows;
+      // values of the NUMERIC keys, one block per row
+      ::std::vector<double>         numbers;
+      ::std::vector< ::std::size_t> order;
+
+      Chunk() : rows(1, 0) {}
+
+      inline ::std::size_t size() const { return rows.size() - 1; }
+      inline ::std::size_t cells(::std::size_t r) const 
+      { 
+        return rows[r + 1] - rows[r] - 1; 
+      }
+      inline void cell(::std::size_t r, ::std::size_t i,
+                       const char_type *& begin, 
+                       const char_type *& end) const;
+      inline ::std::size_t memoryUsage() const;
+      inline void clear();
+    };
+
+    struct Cursor
+    {
+      ::std::ifstream file;
+      ::std::string   path;
+      ::std::string   buffer;
+      Chunk           row;
+      ::std::size_t   index;
+    };
+
+    spec_type                     _specs;
+    ::std::vector<Key>            _keys;
+    ::std::size_t                 _memory_limit;
+    ::std::size_t                 _merge_width;
+    ::std::string                 _directory;
+    ::std::size_t                 _runs;
+    ::std::size_t                 _numeric;
+    ::std::locale                 _locale;
+
+    void resolve(const Chunk & header);
+    void parseKeys(Chunk & chunk) const;
+    void sortChunk(Chunk & chunk) const;
+    bool less(const Chunk & a, ::std::size_t ra, 
+              const Chunk & b, ::std::size_t rb) const;
+    template<typename OUTPUT>
+    void merge(const ::std::vector< ::std::string> & runs,
+               ::std::size_t first, ::std::size_t last,
+               OUTPUT output) const;
+    void writeRun(const ::std::string & path, const Chunk & chunk) const;
+    spec_type runSpecification() const;
+
+    static bool readRow(reader_type & reader, Chunk & chunk);
+    static void writeRow(writer_type & writer, 
+                         const Chunk & chunk, ::std::size_t r);
+    static bool readRunRow(Cursor & cursor);
+    static void writeRunRow(::std::ostream & file, ::std::string & buffer,
+                            const Chunk & chunk, ::std::size_t r);
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  inline detail::TemporaryFiles::~TemporaryFiles()
+  {
+    for(auto & path : _paths)
+    {
+      ::std::remove(path.c_str());
+    }
+  }
+
+  inline ::std::string detail::TemporaryFiles::create()
+  {
+    static ::std::atomic< ::std::size_t> counter(0);
+    ::std::string path = _directory + "/csv_sort_" + 
+      ::std::to_string(::std::chrono::steady_clock::now().time_since_epoch().count()) + 
+      "_" + ::std::to_string(reinterpret_cast< ::std::uintptr_t>(this)) +
+      "_" + ::std::to_string(counter++) + ".csv";
+    _paths.push_back(path);
+    return path;
+  }
+
+  inline void detail::TemporaryFiles::remove(const ::std::string & path)
+  {
+    auto itr = ::std::find(_paths.begin(), _paths.end(), path);
+    if(itr != _paths.end())
+    {
+      ::std::remove(path.c_str());
+      _paths.erase(itr);
+    }
+  }
+
+  inline ::std::string detail::TemporaryFiles::defaultDirectory()
+  {
+    for(const char * name : { "TMPDIR", "TMP", "TEMP" })
+    {
+      const char * dir = ::std::getenv(name);
+      if(dir && *dir)
+      {
+        return dir;
+      }
+    }
+    return ".";
+  }
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicSorter<CHAR, TRAITS>::default_memory_limit;
+
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicSorter<CHAR, TRAITS>::default_merge_width;
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicSorter<CHAR, TRAITS>::Chunk::cell(::std::size_t r, 
+                                                     ::std::size_t i,
+                                                     const char_type *& begin,
+                                                     const char_type *& end) const
+  {
+    if(i < cells(r))
+    {
+      begin = data.data() + offsets[rows[r] + i];
+      end   = data.data() + offsets[rows[r] + i + 1];
+    }
+    else
+    {
+      begin = end = data.data();
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicSorter<CHAR, TRAITS>::Chunk::memoryUsage() const
+  {
+    return 
+      data.capacity()    * sizeof(char_type) + 
+      offsets.capacity() * sizeof(::std::size_t) + 
+      rows.capacity()    * sizeof(::std::size_t) * 2 +
+      numbers.capacity() * sizeof(double);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicSorter<CHAR, TRAITS>::Chunk::clear()
+  {
+    data.clear();
+    offsets.clear();
+    rows.resize(1);
+    numbers.clear();
+    order.clear();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicSorter<CHAR, TRAITS>::BasicSorter(spec_type specs)
+    : _specs(specs),
+      _memory_limit(default_memory_limit),
+      _merge_width(default_merge_width),
+      _directory(detail::TemporaryFiles::defaultDirectory()),
+      _runs(0),
+      _numeric(0)
+  {
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicSorter<CHAR, TRAITS> & 
+  BasicSorter<CHAR, TRAITS>::withKey(const string_type & name, SortKey type)
+  {
+    _keys.push_back(Key{name, spec_type::npos, type});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicSorter<CHAR, TRAITS> & 
+  BasicSorter<CHAR, TRAITS>::withKey(::std::size_t index, SortKey type)
+  {
+    _keys.push_back(Key{string_type(), index, type});
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicSorter<CHAR, TRAITS> & 
+  BasicSorter<CHAR, TRAITS>::withMemoryLimit(::std::size_t bytes)
+  {
+    _memory_limit = bytes;
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicSorter<CHAR, TRAITS> & 
+  BasicSorter<CHAR, TRAITS>::withMergeWidth(::std::size_t runs)
+  {
+    _merge_width = runs < 2 ? 2 : runs;
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicSorter<CHAR, TRAITS> & 
+  BasicSorter<CHAR, TRAITS>::withTemporaryDirectory(const ::std::string & directory)
+  {
+    _directory = directory;
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  typename BasicSorter<CHAR, TRAITS>::spec_type 
+  BasicSorter<CHAR, TRAITS>::runSpecification() const
+  {
+    // the header is handled by the sorter
+    spec_type specs(_specs);
+    specs.withoutHeader();
+    return specs;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicSorter<CHAR, TRAITS>::resolve(const Chunk & header)
+  {
+    _numeric = 0;
+    for(auto & key : _keys)
+    {
+      if(key.type == SortKey::NUMERIC)
+      {
+        _numeric++;
+      }
+      if(key.name.empty())
+      {
+        continue;
+      }
+      key.index = _specs.columnIndex(key.name);
+      for(::std::size_t i = 0; header.size() && i < header.cells(0); i++)
+      {
+        const char_type * begin;
+        const char_type * end;
+        header.cell(0, i, begin, end);
+        if(string_type(begin, end) == key.name)
+        {
+          key.index = i;
+          break;
+        }
+      }
+      if(key.index == spec_type::npos)
+      {
+        throw UndefinedColumnError("Undefined sort key column.", 
+                                   header.size() ? header.cells(0) : 0,
+                                   0, 0, 0, 0);
+      }
+    }
+    _locale = _specs.locale();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  bool BasicSorter<CHAR, TRAITS>::readRow(reader_type & reader, Chunk & chunk)
+  {
+    if(!reader.nextRawRow())
+    {
+      return false;
+    }
+    chunk.offsets.push_back(chunk.data.size());
+    for(::std::size_t i = 0; i < reader.rawRowSize(); i++)
+    {
+      const char_type * begin;
+      const char_type * end;
+      reader.rawCell(i, begin, end);
+      chunk.data.insert(chunk.data.end(), begin, end);
+      chunk.offsets.push_back(chunk.data.size());
+    }
+    chunk.rows.push_back(chunk.offsets.size());
+    return true;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicSorter<CHAR, TRAITS>::writeRow(writer_type & writer, 
+                                           const Chunk & chunk, 
+                                           ::std::size_t r)
+  {
+    for(::std::size_t i = 0; i < chunk.cells(r); i++)
+    {
+      const char_type * begin;
+      const char_type * end;
+      chunk.cell(r, i, begin, end);
+      writer.writeCell(begin, end);
+    }
+    writer.endRow();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  bool BasicSorter<CHAR, TRAITS>::readRunRow(Cursor & cursor)
+  {
+    ::std::uint64_t cells;
+    if(!cursor.file.read(reinterpret_cast<char*>(&cells), sizeof(cells)))
+    {
+      if(cursor.file.gcount())
+      {
+        throw TemporaryFileError("Cannot read temporary file " + cursor.path);
+      }
+      return false;
+    }
+    Chunk & chunk = cursor.row;
+    chunk.offsets.push_back(chunk.data.size());
+    for(::std::uint64_t i = 0; i < cells; i++)
+    {
+      ::std::uint64_t size;
+      if(!cursor.file.read(reinterpret_cast<char*>(&size), sizeof(size)))
+      {
+        throw TemporaryFileError("Cannot read temporary file " + cursor.path);
+      }
+      cursor.buffer.resize(size);
+      if(size && !cursor.file.read(&cursor.buffer[0], size))
+      {
+        throw TemporaryFileError("Cannot read temporary file " + cursor.path);
+      }
+      if(!detail::decodeRunCell(cursor.buffer.data(), 
+                                cursor.buffer.data() + size, chunk.data))
+      {
+        throw TemporaryFileError("Cannot decode temporary file " + cursor.path);
+      }
+      chunk.offsets.push_back(chunk.data.size());
+    }
+    chunk.rows.push_back(chunk.offsets.size());
+    return true;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicSorter<CHAR, TRAITS>::writeRunRow(::std::ostream & file,
+                                              ::std::string & buffer,
+                                              const Chunk & chunk, 
+                                              ::std::size_t r)
+  {
+    const ::std::uint64_t cells = chunk.cells(r);
+    buffer.assign(reinterpret_cast<const char*>(&cells), sizeof(cells));
+    for(::std::size_t i = 0; i < chunk.cells(r); i++)
+    {
+      const char_type * begin;
+      const char_type * end;
+      chunk.cell(r, i, begin, end);
+      const ::std::size_t pos = buffer.size();
+      buffer.append(sizeof(::std::uint64_t), '\0');
+      encodeUtf8(begin, end, buffer);
+      const ::std::uint64_t size = buffer.size() - pos - sizeof(::std::uint64_t);
+      buffer.replace(pos, sizeof(size), 
+                     reinterpret_cast<const char*>(&size), sizeof(size));
+    }
+    file.write(buffer.data(), buffer.size());
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicSorter<CHAR, TRAITS>::parseKeys(Chunk & chunk) const
+  {
+    typedef BasicSerializer<char_type, char_traits, double> serializer_type;
+    if(!_numeric)
+    {
+      return;
+    }
+    for(::std::size_t r = chunk.numbers.size() / _numeric; r < chunk.size(); r++)
+    {
+      for(auto & key : _keys)
+      {
+        if(key.type != SortKey::NUMERIC)
+        {
+          continue;
+        }
+        const char_type * begin;
+        const char_type * end;
+        chunk.cell(r, key.index, begin, end);
+        double value;
+        if(begin == end || !serializer_type::parse(begin, end, _locale, value) ||
+           value != value)
+        {
+          value = ::std::numeric_limits<double>::quiet_NaN();
+        }
+        chunk.numbers.push_back(value);
+      }
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  bool BasicSorter<CHAR, TRAITS>::less(const Chunk & a, ::std::size_t ra,
+                                       const Chunk & b, ::std::size_t rb) const
+  {
+    ::std::size_t slot = 0;
+    for(auto & key : _keys)
+    {
+      if(key.type == SortKey::NUMERIC)
+      {
+        const double x = a.numbers[ra * _numeric + slot];
+        const double y = b.numbers[rb * _numeric + slot];
+        slot++;
+        const bool x_nan = (x != x);
+        const bool y_nan = (y != y);
+        if(!x_nan && !y_nan)
+        {
+          if(x != y)
+          {
+            return x < y;
+          }
+          continue;
+        }
+        else if(x_nan != y_nan)
+        {
+          return y_nan;
+        }
+      }
+      const char_type * a_begin;
+      const char_type * a_end;
+      const char_type * b_begin;
+      const char_type * b_end;
+      a.cell(ra, key.index, a_begin, a_end);
+      b.cell(rb, key.index, b_begin, b_end);
+      const ::std::size_t a_size = a_end - a_begin;
+      const ::std::size_t b_size = b_end - b_begin;
+      int cmp = char_traits::compare(a_begin, b_begin, 
+                                     a_size < b_size ? a_size : b_size);
+      if(cmp)
+      {
+        return cmp < 0;
+      }
+      if(a_size != b_size)
+      {
+        return a_size < b_size;
+      }
+    }
+    return false;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicSorter<CHAR, TRAITS>::sortChunk(Chunk & chunk) const
+  {
+    parseKeys(chunk);
+    chunk.order.resize(chunk.size());
+    for(::std::size_t r = 0; r < chunk.order.size(); r++)
+    {
+      chunk.order[r] = r;
+    }
+    ::std::stable_sort(chunk.order.begin(), chunk.order.end(),
+                       [this, &chunk](::std::size_t r1, ::std::size_t r2)
+                       {
+                         return less(chunk, r1, chunk, r2);
+                       });
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicSorter<CHAR, TRAITS>::writeRun(const ::std::string & path,
+                                           const Chunk & chunk) const
+  {
+    ::std::ofstream file(path.c_str(), ::std::ios::out | ::std::ios::binary);
+    if(!file)
+    {
+      throw TemporaryFileError("Cannot create temporary file " + path);
+    }
+    ::std::string buffer;
+    for(auto r : chunk.order)
+    {
+      writeRunRow(file, buffer, chunk, r);
+    }
+    file.close();
+    if(!file)
+    {
+      throw TemporaryFileError("Cannot write temporary file " + path);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename OUTPUT>
+  void BasicSorter<CHAR, TRAITS>::merge(const ::std::vector< ::std::string> & runs,
+                                        ::std::size_t first, 
+                                        ::std::size_t last,
+                                        OUTPUT output) const
+  {
+    ::std::vector< ::std::unique_ptr<Cursor> > cursors;
+    ::std::vector<Cursor*> heap;
+    // smallest row on top, earlier runs first for equal rows
+    auto after = [this](const Cursor * a, const Cursor * b)
+    {
+      if(less(b->row, 0, a->row, 0))
+      {
+        return true;
+      }
+      return !less(a->row, 0, b->row, 0) && a->index > b->index;
+    };
+    for(::std::size_t i = first; i < last; i++)
+    {
+      cursors.emplace_back(new Cursor());
+      Cursor * cursor = cursors.back().get();
+      cursor->index = i;
+      cursor->path  = runs[i];
+      cursor->file.open(runs[i].c_str(), ::std::ios::in | ::std::ios::binary);
+      if(!cursor->file)
+      {
+        throw TemporaryFileError("Cannot open temporary file " + runs[i]);
+      }
+      if(readRunRow(*cursor))
+      {
+        parseKeys(cursor->row);
+        heap.push_back(cursor);
+      }
+    }
+    ::std::make_heap(heap.begin(), heap.end(), after);
+    while(!heap.empty())
+    {
+      ::std::pop_heap(heap.begin(), heap.end(), after);
+      Cursor * cursor = heap.back();
+      output(cursor->row);
+      cursor->row.clear();
+      if(readRunRow(*cursor))
+      {
+        parseKeys(cursor->row);
+        ::std::push_heap(heap.begin(), heap.end(), after);
+      }
+      else
+      {
+        heap.pop_back();
+      }
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicSorter<CHAR, TRAITS>::sort(istream_type & ist, 
+                                                ostream_type & ost,
+                                                ::std::size_t threads)
+  {
+    ThreadPool pool(threads);
+    return sort(ist, ost, pool);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicSorter<CHAR, TRAITS>::sort(istream_type & ist, 
+                                                ostream_type & ost,
+                                                ThreadPool & pool)
+  {
+    reader_type reader(ist, runSpecification());
+    Chunk header;
+    if(_specs.hasHeader())
+    {
+      readRow(reader, header);
+    }
+    resolve(header);
+    _runs = 0;
+
+    // one chunk is read while the others are sorted
+    const ::std::size_t workers     = pool.size() ? pool.size() : 1;
+    const ::std::size_t chunk_limit = _memory_limit / (workers + 1);
+    detail::TemporaryFiles files(_directory);
+    ::std::vector< ::std::string> runs;
+    ::std::deque< ::std::future<void> > pending;
+    auto chunk = ::std::make_shared<Chunk>();
+    ::std::size_t n = 0;
+    auto dispatch = [&]()
+    {
+      while(pending.size() >= workers)
+      {
+        pending.front().get();
+        pending.pop_front();
+      }
+      runs.push_back(files.create());
+      const ::std::string path = runs.back();
+      ::std::shared_ptr<Chunk> run(chunk);
+      pending.push_back(pool.submit([this, run, path]() mutable
+      {
+        sortChunk(*run);
+        writeRun(path, *run);
+        // the task is kept by its future, release the rows now
+        run.reset();
+      }));
+      chunk = ::std::make_shared<Chunk>();
+    };
+    try
+    {
+      while(readRow(reader, *chunk))
+      {
+        n++;
+        if(chunk->memoryUsage() >= chunk_limit)
+        {
+          dispatch();
+        }
+      }
+      if(!runs.empty() && chunk->size())
+      {
+        dispatch();
+      }
+      while(!pending.empty())
+      {
+        pending.front().get();
+        pending.pop_front();
+      }
+    }
+    catch(...)
+    {
+      for(auto & item : pending)
+      {
+        if(item.valid())
+        {
+          item.wait();
+        }
+      }
+      throw;
+    }
+    _runs = runs.size();
+
+    writer_type writer(ost, _specs);
+    if(header.size())
+    {
+      writeRow(writer, header, 0);
+    }
+    if(runs.empty())
+    {
+      // everything fits into memory
+      sortChunk(*chunk);
+      for(auto r : chunk->order)
+      {
+        writeRow(writer, *chunk, r);
+      }
+      writer.flush();
+      return n;
+    }
+    chunk.reset();
+    while(runs.size() > _merge_width)
+    {
+      // merge neighbouring runs, which keeps the sort stable
+      ::std::vector< ::std::string> merged;
+      for(::std::size_t first = 0; first < runs.size(); first+= _merge_width)
+      {
+        const ::std::size_t last = ::std::min(first + _merge_width, runs.size());
+        merged.push_back(files.create());
+        ::std::ofstream file(merged.back().c_str(), 
+                             ::std::ios::out | ::std::ios::binary);
+        if(!file)
+        {
+          throw TemporaryFileError("Cannot create temporary file " + merged.back());
+        }
+        ::std::string buffer;
+        merge(runs, first, last, [&file, &buffer](const Chunk & row)
+        {
+          writeRunRow(file, buffer, row, 0);
+        });
+        file.close();
+        if(!file)
+        {
+          throw TemporaryFileError("Cannot write temporary file " + merged.back());
+        }
+        for(::std::size_t i = first; i < last; i++)
+        {
+          files.remove(runs[i]);
+        }
+      }
+      runs.swap(merged);
+    }
+    merge(runs, 0, runs.size(), [&writer](const Chunk & row)
+    {
+      writeRow(writer, row, 0);
+    });
+    writer.flush();
+    return n;
+  }
+}
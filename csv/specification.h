@@ -30,15 +30,32 @@ either expressed or implied, of the FreeBSD Project.
 ******************************************************************************/
 #pragma once
 #include "csv_common.h"
+#include "dictionary.h"
+#include "flat_hash_map.h"
+#include "statistics.h"
 #include <string>
 #include <vector>
-#include <map>
 #include <memory>
 #include <algorithm>
 #include <locale>
 
 namespace csv
 {
+  /**
+   * Index of a named column, resolved once by 
+   * BasicSpecification::handle() and used for BasicRow::operator[].
+   */
+  class ColumnHandle
+  {
+  public:
+    ColumnHandle() : _index(::std::size_t(-1)) {}
+    explicit ColumnHandle(::std::size_t index) : _index(index) {}
+    inline ::std::size_t index() const { return _index; }
+    inline bool isValid() const        { return _index != ::std::size_t(-1); }
+  private:
+    ::std::size_t _index;
+  };
+
   /************************************************************************
    *                                                                      *
    * CSV specification                                                    *
@@ -51,6 +68,7 @@ namespace csv
     typedef CHAR                                      char_type;
     typedef TRAITS                                    char_traits;
     typedef std::basic_string<char_type, char_traits> string_type;
+    typedef BasicDictionary<char_type, char_traits>   dictionary_type;
 
     BasicSpecification();
 
@@ -78,10 +96,35 @@ namespace csv
     inline BasicSpecification& withoutComment();
     inline bool isComment(char_type ch) const;
 
+    ///////////////////////////////////////////////
+    inline BasicSpecification& withQuote(char_type ch);
+    inline char_type quote() const;
 
     ///////////////////////////////////////////////
     inline BasicSpecification& withColumn(::std::size_t index, 
                                           const string_type & name);
+    inline ::std::size_t columnIndex(const string_type & name) const;
+    inline ColumnHandle handle(const string_type & name) const;
+    /** Name of the column, empty if the column has no name */
+    inline string_type columnName(::std::size_t index) const;
+    /** Number of columns defined so far */
+    inline ::std::size_t numColumns() const;
+
+    ///////////////////////////////////////////////
+    inline BasicSpecification& withDictionary(::std::size_t index);
+    inline BasicSpecification& withDictionary(const string_type & name);
+    inline ::std::shared_ptr<const dictionary_type> 
+    dictionary(::std::size_t index) const;
+    inline ::std::shared_ptr<const dictionary_type> 
+    dictionary(const string_type & name) const;
+
+    /** 
+     * Hash of the settings which affect how input is tokenized and 
+     * named, e.g. to detect stale caches.
+     */
+    ::std::size_t hash() const;
+
+    static const ::std::size_t npos = ::std::size_t(-1);
     
   private:
     class Column
@@ -113,10 +156,14 @@ namespace csv
     friend class BasicCell<char_type,   char_traits>;
     friend class BasicRow<char_type,    char_traits>;
     friend class BasicReader<char_type, char_traits>;
+    friend class BasicWriter<char_type, char_traits>;
     typedef unsigned int                                flags_type;    
     typedef ::std::shared_ptr<Column>                   shared_column_type;
-    typedef ::std::map<string_type, shared_column_type> lookup_type;
+    typedef FlatHashMap<string_type, 
+                        shared_column_type,
+                        StringHash<string_type> >       lookup_type;
     typedef ::std::vector<std::shared_ptr<Column> >     columns_type;
+    typedef ::std::shared_ptr<dictionary_type>          shared_dictionary_type;
 
 
     static const flags_type _use_empty_lines = 1;
@@ -127,6 +174,7 @@ namespace csv
     inline shared_column_type addColumnIfNotExists(::std::size_t column);
     inline shared_column_type addColumnIfNotExists(::std::size_t column,
                                                    string_type   name);
+    void initDictionaries();
 
     lookup_type              _lookup;
     columns_type             _columns;
@@ -134,7 +182,20 @@ namespace csv
     char_type                _default_separator;
     flags_type               _flags;
     char_type                _comment_char;
+    char_type                _quote_char;
     ::std::locale            _locale;
+
+    // requested dictionary columns and the dictionaries of a reader
+    ::std::vector< ::std::size_t>         _dictionary_indices;
+    ::std::vector<string_type>            _dictionary_names;
+    ::std::vector<shared_dictionary_type> _dictionaries;
+
+    // conversion counters of a reader
+    CSV_STATISTICS(::std::shared_ptr<ConversionStatistics> _conversion_statistics;)
+
+  public:
+    CSV_STATISTICS(inline ConversionStatistics * conversionStatistics() const 
+                   { return _conversion_statistics.get(); })
   };
 
   ///////////////////////////////////////////////////////////////////
@@ -146,7 +207,8 @@ namespace csv
   inline BasicSpecification<CHAR, TRAITS>::BasicSpecification() 
     : _default_separator(char_type(',')),
       _flags(0),
-      _comment_char(char_type(0))
+      _comment_char(char_type(0)),
+      _quote_char(char_type('"'))
   {
     _separators.push_back(_default_separator);
   }
@@ -294,6 +356,22 @@ namespace csv
     return ( ch == _comment_char );
   }
 
+  ///////////////////////////////////////////////
+  template<typename CHAR, typename TRAITS>
+  inline BasicSpecification<CHAR, TRAITS>& 
+  BasicSpecification<CHAR, TRAITS>::withQuote(char_type ch)
+  {
+    _quote_char = ch;
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline typename BasicSpecification<CHAR, TRAITS>::char_type 
+  BasicSpecification<CHAR, TRAITS>::quote() const
+  {
+    return _quote_char;
+  }
+
   ///////////////////////////////////////////////
   template<typename CHAR, typename TRAITS>
   inline BasicSpecification<CHAR, TRAITS>& 
@@ -332,6 +410,138 @@ namespace csv
 
 
 
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicSpecification<CHAR, TRAITS>::npos;
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t 
+  BasicSpecification<CHAR, TRAITS>::columnIndex(const string_type & name) const
+  {
+    auto itr = _lookup.find(name);
+    if(itr == _lookup.end())
+    {
+      return npos;
+    }
+    return itr->second->index();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline typename BasicSpecification<CHAR, TRAITS>::string_type
+  BasicSpecification<CHAR, TRAITS>::columnName(::std::size_t index) const
+  {
+    if(index < _columns.size() && _columns[index])
+    {
+      return _columns[index]->name();
+    }
+    return string_type();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::size_t BasicSpecification<CHAR, TRAITS>::numColumns() const
+  {
+    return _columns.size();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  ::std::size_t BasicSpecification<CHAR, TRAITS>::hash() const
+  {
+    string_type key(_separators.begin(), _separators.end());
+    key.push_back(_default_separator);
+    key.push_back(_comment_char);
+    key.push_back(_quote_char);
+    key.push_back(char_type(_flags));
+    key.push_back(::std::use_facet< ::std::numpunct<char_type> >(_locale).decimal_point());
+    for(auto & column : _columns)
+    {
+      key.push_back(char_type(0));
+      if(column)
+      {
+        key.append(column->name());
+      }
+    }
+    return hashChars(key.data(), key.size());
+  }
+
+  /**
+   * Handle of the column name, invalid if the column is not defined.
+   * Columns named in the header are only defined once the reader 
+   * has been constructed: reader.specification().handle(name)
+   */
+  template<typename CHAR, typename TRAITS>
+  inline ColumnHandle
+  BasicSpecification<CHAR, TRAITS>::handle(const string_type & name) const
+  {
+    return ColumnHandle(columnIndex(name));
+  }
+
+  /**
+   * Cells of the column are interned in a dictionary shared by all rows,
+   * see BasicCell::code().
+   */
+  template<typename CHAR, typename TRAITS>
+  inline BasicSpecification<CHAR, TRAITS>& 
+  BasicSpecification<CHAR, TRAITS>::withDictionary(::std::size_t index)
+  {
+    _dictionary_indices.push_back(index);
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline BasicSpecification<CHAR, TRAITS>& 
+  BasicSpecification<CHAR, TRAITS>::withDictionary(const string_type & name)
+  {
+    _dictionary_names.push_back(name);
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::shared_ptr<const typename BasicSpecification<CHAR, TRAITS>::dictionary_type>
+  BasicSpecification<CHAR, TRAITS>::dictionary(::std::size_t index) const
+  {
+    if(index < _dictionaries.size())
+    {
+      return _dictionaries[index];
+    }
+    return ::std::shared_ptr<const dictionary_type>();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline ::std::shared_ptr<const typename BasicSpecification<CHAR, TRAITS>::dictionary_type>
+  BasicSpecification<CHAR, TRAITS>::dictionary(const string_type & name) const
+  {
+    return dictionary(columnIndex(name));
+  }
+
+  /**
+   * Creates the dictionaries of the requested columns, 
+   * called by the reader once the header has been read.
+   */
+  template<typename CHAR, typename TRAITS>
+  void BasicSpecification<CHAR, TRAITS>::initDictionaries()
+  {
+    _dictionaries.clear();
+    ::std::vector< ::std::size_t> indices(_dictionary_indices);
+    for(auto & name : _dictionary_names)
+    {
+      ::std::size_t index = columnIndex(name);
+      if(index != npos)
+      {
+        indices.push_back(index);
+      }
+    }
+    for(auto index : indices)
+    {
+      if(_dictionaries.size() < index + 1)
+      {
+        _dictionaries.resize(index + 1);
+      }
+      if(!_dictionaries[index])
+      {
+        _dictionaries[index] = ::std::make_shared<dictionary_type>();
+      }
+    }
+  }
+
   template<typename CHAR, typename TRAITS>
   BasicSpecification<CHAR, TRAITS>::Column::Column(::std::size_t index, 
                                                    const string_type & name)
@@ -0,0 +1,236 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <locale>
+#include <memory>
+#include <vector>
+#include <string>
+#include <initializer_list>
+#include <algorithm>
+#include <stdexcept>
+#include "csv_common.h"
+#include "serializer.h"
+#include "statistics.h"
+
+/**
+ * Shorthand for csv::StaticMember<CLASS, decltype(CLASS::NAME), &CLASS::NAME>
+ */
+#define CSV_STATIC_MEMBER(CLASS, NAME) \
+  ::csv::StaticMember<CLASS, decltype(CLASS::NAME), &CLASS::NAME>
+
+namespace csv
+{
+
+/**
+ * Compile time descriptor of a data member.
+ */
+template<typename OBJECT, typename MEMBER, MEMBER OBJECT::*POINTER>
+class StaticMember
+{
+public:
+  typedef OBJECT object_type;
+  typedef MEMBER member_type;
+
+  static inline member_type & bind(object_type & obj)
+  {
+    return obj.*POINTER;
+  }
+
+  static inline const member_type & bind(const object_type & obj)
+  {
+    return obj.*POINTER;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  static inline void parse(object_type & obj,
+                           const CHAR * begin,
+                           const CHAR * end,
+                           const ::std::locale & locale)
+  {
+    typedef BasicSerializer<CHAR, TRAITS, member_type> serializer_type;
+    obj.*POINTER = serializer_type::as(begin, end, locale);
+  }
+};
+
+/**
+ * Builder declared as a compile time list of StaticMember types.
+ * Rows are mapped without virtual calls, the conversion of each member
+ * is inlined.
+ *
+ *   typedef csv::StaticBuilder<Planet,
+ *                              CSV_STATIC_MEMBER(Planet, name),
+ *                              CSV_STATIC_MEMBER(Planet, mass)> PlanetBuilder;
+ *   PlanetBuilder builder({"Name", "Mass"});
+ *   csv::ObjectReader<Planet, PlanetBuilder> reader(builder, ist, spec);
+ */
+template<typename OBJECT, typename CHAR, typename TRAITS, typename... MEMBERS>
+class BasicStaticBuilder
+{
+public:
+  typedef OBJECT                                           object_type;
+  typedef CHAR                                             char_type;
+  typedef TRAITS                                           char_traits;
+  typedef std::basic_string<char_type, char_traits>        string_type;
+  typedef BasicStaticBuilder<object_type, char_type, 
+                             char_traits, MEMBERS...>      self_type;
+
+  static const std::size_t size = sizeof...(MEMBERS);
+
+  BasicStaticBuilder(std::initializer_list<string_type> names)
+    : _names(names)
+  {
+    if(_names.size() != size)
+    {
+      throw std::invalid_argument("Number of names does not match "
+                                  "the number of members.");
+    }
+  }
+
+  inline object_type build() const
+  {
+    return object_type();
+  }
+
+  inline const std::vector<string_type> & getFieldNames() const
+  {
+    return _names;
+  }
+
+  template<typename ROW>
+  class Mapping
+  {
+  public:
+    typedef ROW                                 row_type;
+    typedef typename row_type::cell_type        cell_type;
+    typedef typename row_type::spec_type        spec_type;
+
+    Mapping(const std::shared_ptr<self_type> & builder,
+            const spec_type & spec)
+      : _locale(spec.locale()), _min_row_size(0)
+    {
+      CSV_STATISTICS(_statistics = spec.conversionStatistics());
+      for(std::size_t i = 0; i < size; i++)
+      {
+        _columns[i] = spec.columnIndex(builder->_names[i]);
+        if(_columns[i] != spec_type::npos)
+        {
+          _min_row_size = std::max(_min_row_size, _columns[i] + 1);
+        }
+      }
+    }
+
+    inline bool covers(const row_type & row) const
+    {
+      return row.size() >= _min_row_size;
+    }
+
+    inline void map(object_type & obj, const row_type & row) const
+    {
+      Mapper<0, MEMBERS...>::map(obj, row, *this);
+    }
+
+  private:
+    template<std::size_t I, typename... Ms>
+    struct Mapper
+    {
+      static inline void map(object_type &, const row_type &, const Mapping &)
+      {
+      }
+    };
+
+    template<std::size_t I, typename M, typename... Ms>
+    struct Mapper<I, M, Ms...>
+    {
+      static inline void map(object_type & obj,
+                             const row_type & row,
+                             const Mapping & mapping)
+      {
+        if(mapping._columns[I] < row.size())
+        {
+          const cell_type & cell(*(row.begin() + mapping._columns[I]));
+          CSV_STATISTICS(StatisticsTimer timer(mapping._statistics));
+          try
+          {
+            M::template parse<char_type, char_traits>(obj,
+                                                      cell.data(),
+                                                      cell.data() + cell.size(),
+                                                      mapping._locale);
+          }
+          catch(const BasicSerializerFailure & failure)
+          {
+            throw ConversionError(::std::string(failure.what()),
+                                  failure.getType(),
+                                  cell.inputLine(),
+                                  cell.inputColumn(),
+                                  cell.row(),
+                                  cell.column());
+          }
+        }
+        Mapper<I + 1, Ms...>::map(obj, row, mapping);
+      }
+    };
+
+    std::size_t _columns[size == 0 ? 1 : size];
+    std::locale _locale;
+    std::size_t _min_row_size;
+    CSV_STATISTICS(ConversionStatistics * _statistics;)
+  };
+
+private:
+  std::vector<string_type> _names;
+};
+
+template<typename OBJECT, typename CHAR, typename TRAITS, typename... MEMBERS>
+const std::size_t BasicStaticBuilder<OBJECT, CHAR, TRAITS, MEMBERS...>::size;
+
+template<typename CLS, typename... MEMBERS>
+class StaticBuilder : public BasicStaticBuilder<CLS, char, char_traits, MEMBERS...>
+{
+public:
+  typedef BasicStaticBuilder<CLS, char, char_traits, MEMBERS...> parent_type;
+  typedef typename parent_type::string_type                      string_type;
+
+  StaticBuilder(std::initializer_list<string_type> names)
+    : parent_type(names) {}
+};
+
+template<typename CLS, typename... MEMBERS>
+class WStaticBuilder : public BasicStaticBuilder<CLS, wchar_t, wchar_traits, MEMBERS...>
+{
+public:
+  typedef BasicStaticBuilder<CLS, wchar_t, wchar_traits, MEMBERS...> parent_type;
+  typedef typename parent_type::string_type                          string_type;
+
+  WStaticBuilder(std::initializer_list<string_type> names)
+    : parent_type(names) {}
+};
+
+}
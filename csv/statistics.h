@@ -0,0 +1,158 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+/**
+ * Reader statistics are only collected if CSV_ENABLE_STATISTICS is 
+ * defined before any header of the library is included. Otherwise 
+ * the counting code is not compiled and stats() returns zeros.
+ */
+#ifdef CSV_ENABLE_STATISTICS
+#define CSV_STATISTICS(statement) statement
+#else
+#define CSV_STATISTICS(statement)
+#endif
+
+namespace csv
+{
+  /**
+   * Snapshot of the counters of a reader, see BasicReader::stats()
+   */
+  struct ReaderStatistics
+  {
+    /** characters read from the input stream (bytes for char) */
+    ::std::size_t              bytes;
+    /** rows including the header */
+    ::std::size_t              rows;
+    ::std::size_t              cells;
+    ::std::size_t              quoted_cells;
+    ::std::size_t              escaped_quotes;
+    /** comment lines and comments at the end of a row */
+    ::std::size_t              comment_lines;
+    ::std::size_t              empty_lines;
+    ::std::size_t              max_row_width;
+    ::std::size_t              max_cell_length;
+    /** allocations and reallocations of row buffers */
+    ::std::size_t              buffer_reallocations;
+    /** time spent in the tokenizer */
+    ::std::chrono::nanoseconds tokenize_time;
+    /** cell conversions and time spent in them */
+    ::std::size_t              conversions;
+    ::std::chrono::nanoseconds conversion_time;
+
+    static inline bool enabled()
+    {
+#ifdef CSV_ENABLE_STATISTICS
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    ReaderStatistics()
+      : bytes(0), rows(0), cells(0), quoted_cells(0), escaped_quotes(0),
+        comment_lines(0), empty_lines(0), max_row_width(0), 
+        max_cell_length(0), buffer_reallocations(0), 
+        tokenize_time(0), conversions(0), conversion_time(0)
+    {}
+  };
+
+  /**
+   * Conversion counters shared by a reader and its cells. 
+   * Conversions may run on several threads (readParallel).
+   */
+  class ConversionStatistics
+  {
+  public:
+    ConversionStatistics() : _conversions(0), _nanoseconds(0) {}
+
+    inline void add(::std::chrono::nanoseconds time)
+    {
+      _conversions.fetch_add(1, ::std::memory_order_relaxed);
+      _nanoseconds.fetch_add(::std::uint64_t(time.count()), 
+                             ::std::memory_order_relaxed);
+    }
+
+    inline ::std::size_t conversions() const
+    {
+      return _conversions.load(::std::memory_order_relaxed);
+    }
+
+    inline ::std::chrono::nanoseconds time() const
+    {
+      return ::std::chrono::nanoseconds(_nanoseconds.load(::std::memory_order_relaxed));
+    }
+
+  private:
+    ::std::atomic< ::std::size_t>   _conversions;
+    ::std::atomic< ::std::uint64_t> _nanoseconds;
+  };
+
+  /**
+   * Adds the time between construction and destruction to a duration 
+   * or to conversion statistics; does nothing for null pointers.
+   */
+  class StatisticsTimer
+  {
+  public:
+    typedef ::std::chrono::steady_clock clock_type;
+
+    StatisticsTimer(::std::chrono::nanoseconds * duration)
+      : _duration(duration), _conversions(nullptr), _start(clock_type::now())
+    {}
+
+    StatisticsTimer(ConversionStatistics * conversions)
+      : _duration(nullptr), _conversions(conversions), _start(clock_type::now())
+    {}
+
+    ~StatisticsTimer()
+    {
+      auto time = ::std::chrono::duration_cast< ::std::chrono::nanoseconds>(clock_type::now() - _start);
+      if(_duration)
+      {
+        *_duration += time;
+      }
+      if(_conversions)
+      {
+        _conversions->add(time);
+      }
+    }
+
+  private:
+    ::std::chrono::nanoseconds * _duration;
+    ConversionStatistics       * _conversions;
+    clock_type::time_point       _start;
+  };
+}
@@ -0,0 +1,210 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <utility>
+
+namespace csv
+{
+  /**
+   * Fixed size pool of worker threads executing tasks in FIFO order.
+   */
+  class ThreadPool
+  {
+  public:
+    ThreadPool(::std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    inline ::std::size_t size() const;
+
+    /**
+     * Queues a task. Exceptions thrown by the task are rethrown
+     * by future::get().
+     */
+    template<typename F>
+    ::std::future<void> submit(F task);
+
+  private:
+    void run();
+
+    ::std::vector< ::std::thread >            _threads;
+    ::std::deque< ::std::function<void()> >   _tasks;
+    ::std::mutex                              _mutex;
+    ::std::condition_variable                 _cond;
+    bool                                      _stop;
+  };
+
+  /**
+   * Ordered batch pipeline. fill(BATCH&) fills a new batch on the 
+   * calling thread and returns false if there was nothing left to add,
+   * process(BATCH&) runs on the pool and consume(BATCH&) is called on 
+   * the calling thread in the order the batches were filled. At most 
+   * 2 * pool.size() batches are in flight.
+   * An exception of process is rethrown after all preceding batches 
+   * have been consumed, no task is running when this function returns.
+   */
+  template<typename BATCH, typename FILL, typename PROCESS, typename CONSUME>
+  void processOrdered(ThreadPool & pool, FILL fill, PROCESS process, CONSUME consume);
+
+  ///////////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////////
+  inline ThreadPool::ThreadPool(::std::size_t threads) : _stop(false)
+  {
+    if(threads == 0)
+    {
+      threads = ::std::thread::hardware_concurrency();
+    }
+    if(threads == 0)
+    {
+      threads = 1;
+    }
+    for(::std::size_t i = 0; i < threads; i++)
+    {
+      _threads.push_back(::std::thread(&ThreadPool::run, this));
+    }
+  }
+
+  inline ThreadPool::~ThreadPool()
+  {
+    {
+      ::std::lock_guard< ::std::mutex > lock(_mutex);
+      _stop = true;
+    }
+    _cond.notify_all();
+    for(auto & thread : _threads)
+    {
+      thread.join();
+    }
+  }
+
+  inline ::std::size_t ThreadPool::size() const
+  {
+    return _threads.size();
+  }
+
+  template<typename F>
+  inline ::std::future<void> ThreadPool::submit(F task)
+  {
+    auto packaged = ::std::make_shared< ::std::packaged_task<void()> >(task);
+    ::std::future<void> ret = packaged->get_future();
+    {
+      ::std::lock_guard< ::std::mutex > lock(_mutex);
+      _tasks.push_back([packaged]() { (*packaged)(); });
+    }
+    _cond.notify_one();
+    return ret;
+  }
+
+  inline void ThreadPool::run()
+  {
+    while(true)
+    {
+      ::std::function<void()> task;
+      {
+        ::std::unique_lock< ::std::mutex > lock(_mutex);
+        _cond.wait(lock, [this]{ return _stop || !_tasks.empty(); });
+        if(_tasks.empty())
+        {
+          // stopped and all queued tasks done
+          return;
+        }
+        task = ::std::move(_tasks.front());
+        _tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  template<typename BATCH, typename FILL, typename PROCESS, typename CONSUME>
+  void processOrdered(ThreadPool & pool, FILL fill, PROCESS process, CONSUME consume)
+  {
+    typedef ::std::pair< ::std::shared_ptr<BATCH>,
+                         ::std::future<void> > pending_type;
+    // the tasks are finished before process goes out of scope
+    const PROCESS * work = &process;
+    ::std::deque<pending_type> pending;
+    auto emit = [&]()
+    {
+      pending.front().second.get();
+      ::std::shared_ptr<BATCH> batch = pending.front().first;
+      pending.pop_front();
+      consume(*batch);
+    };
+    try
+    {
+      while(true)
+      {
+        auto batch = ::std::make_shared<BATCH>();
+        if(!fill(*batch))
+        {
+          break;
+        }
+        pending.push_back(pending_type(batch, pool.submit([batch, work]()
+        {
+          (*work)(*batch);
+        })));
+        if(pending.size() > 2 * pool.size())
+        {
+          emit();
+        }
+      }
+      while(!pending.empty())
+      {
+        emit();
+      }
+    }
+    catch(...)
+    {
+      for(auto & item : pending)
+      {
+        if(item.second.valid())
+        {
+          item.second.wait();
+        }
+      }
+      throw;
+    }
+  }
+
+} // namespace csv
@@ -0,0 +1,301 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <tuple>
+#include <locale>
+#include <typeinfo>
+#include "csv_common.h"
+#include "serializer.h"
+#include "reader.h"
+
+namespace csv
+{
+  /**
+   * Reader for rows with a fixed number of columns of known types.
+   * Cells are converted straight from the tokenizer's buffer, no row or
+   * cell objects are created.
+   *
+   *   csv::TypedReader<int64_t, double, std::string> reader(ist);
+   *   std::tuple<int64_t, double, std::string> values;
+   *   while(reader.read(values)) { ... }
+   */
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  class BasicTypedReader : protected BasicReader<CHAR, TRAITS>
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef BasicReader<char_type, char_traits>          reader_type;
+    typedef typename reader_type::istream_type           istream_type;
+    typedef typename reader_type::spec_type              spec_type;
+    typedef ::std::tuple<TYPES...>                       tuple_type;
+
+    static const ::std::size_t size = sizeof...(TYPES);
+
+    /**
+     * Input iterator over the converted rows.
+     */
+    class iterator : public ::std::iterator<::std::input_iterator_tag,
+                                            tuple_type>
+    {
+      friend class BasicTypedReader<char_type, char_traits, TYPES...>;
+      BasicTypedReader * _reader;
+      tuple_type         _values;
+
+      iterator(BasicTypedReader * reader) : _reader(reader)
+      {
+        ++*this;
+      }
+
+    public:
+      iterator() : _reader(0) {}
+
+      inline const tuple_type & operator*() const  { return _values;  }
+      inline const tuple_type * operator->() const { return &_values; }
+
+      inline iterator& operator++()
+      {
+        if(_reader && !_reader->read(_values))
+        {
+          _reader = 0;
+        }
+        return *this;
+      }
+
+      inline iterator operator++(int)
+      {
+        iterator tmp = *this;
+        ++*this;
+        return tmp;
+      }
+
+      inline bool operator==(const iterator & rhs) const
+      {
+        return _reader == rhs._reader;
+      }
+
+      inline bool operator!=(const iterator & rhs) const
+      {
+        return _reader != rhs._reader;
+      }
+    };
+
+    BasicTypedReader(istream_type & ist, spec_type specs = spec_type());
+
+    inline iterator begin() { return iterator(this); }
+    inline iterator end()   { return iterator();     }
+
+    using reader_type::specification;
+    using reader_type::stats;
+    using reader_type::isLenient;
+    using reader_type::errors;
+
+    /** Skips malformed rows, see BasicReader::withLenientParsing() */
+    inline BasicTypedReader & withLenientParsing(::std::size_t max_errors = 1000)
+    {
+      reader_type::withLenientParsing(max_errors);
+      return *this;
+    }
+
+    /**
+     * Reads the next row into values. Returns false at the end of input.
+     * Throws CellOutOfRangeError if the row does not have exactly one 
+     * cell per type and ConversionError if a cell cannot be converted.
+     */
+    bool read(tuple_type & values);
+
+    /**
+     * Reads the next row into the members of obj, one member per type:
+     *
+     *   reader.read(trade, &Trade::id, &Trade::price, &Trade::symbol);
+     */
+    template<typename OBJECT>
+    bool read(OBJECT & obj, TYPES OBJECT::*... members);
+
+  private:
+    typedef typename reader_type::range_type             range_type;
+    ::std::locale                                        _locale;
+
+    inline bool next();
+    inline void checkSize() const;
+
+    template<typename T>
+    inline void convert(::std::size_t i, T & value) const;
+
+    template< ::std::size_t I>
+    inline typename ::std::enable_if<I == size>::type 
+    convertTuple(tuple_type &) const {}
+
+    template< ::std::size_t I>
+    inline typename ::std::enable_if<(I < size)>::type 
+    convertTuple(tuple_type & values) const
+    {
+      convert(I, ::std::get<I>(values));
+      convertTuple<I + 1>(values);
+    }
+  };
+
+  template<typename... TYPES>
+  class TypedReader : public BasicTypedReader<char, char_traits, TYPES...>
+  {
+  public:
+    typedef BasicTypedReader<char, char_traits, TYPES...> parent_type;
+    typedef typename parent_type::istream_type            istream_type;
+    typedef typename parent_type::spec_type               spec_type;
+
+    TypedReader(istream_type & ist, spec_type specs = spec_type())
+      : parent_type(ist, specs) {}
+  };
+
+  template<typename... TYPES>
+  class WTypedReader : public BasicTypedReader<wchar_t, wchar_traits, TYPES...>
+  {
+  public:
+    typedef BasicTypedReader<wchar_t, wchar_traits, TYPES...> parent_type;
+    typedef typename parent_type::istream_type                istream_type;
+    typedef typename parent_type::spec_type                   spec_type;
+
+    WTypedReader(istream_type & ist, spec_type specs = spec_type())
+      : parent_type(ist, specs) {}
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  const ::std::size_t BasicTypedReader<CHAR, TRAITS, TYPES...>::size;
+
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  BasicTypedReader<CHAR, TRAITS, TYPES...>::BasicTypedReader(istream_type & ist,
+                                                             spec_type specs)
+    : reader_type(ist, specs), _locale(this->_specs->locale())
+  {
+  }
+
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  bool BasicTypedReader<CHAR, TRAITS, TYPES...>::read(tuple_type & values)
+  {
+    if(!next())
+    {
+      return false;
+    }
+    convertTuple<0>(values);
+    return true;
+  }
+
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  template<typename OBJECT>
+  bool BasicTypedReader<CHAR, TRAITS, TYPES...>::read(OBJECT & obj,
+                                                      TYPES OBJECT::*... members)
+  {
+    if(!next())
+    {
+      return false;
+    }
+    ::std::size_t i = 0;
+    // braced initializers are evaluated from left to right
+    int expand[] = { 0, (convert(i++, obj.*members), 0)... };
+    (void)expand;
+    return true;
+  }
+
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  inline bool BasicTypedReader<CHAR, TRAITS, TYPES...>::next()
+  {
+    while(this->consume());
+    if(this->_has_been_flushed)
+    {
+      this->_has_been_flushed = false;
+      checkSize();
+      return true;
+    }
+    return false;
+  }
+
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  inline void BasicTypedReader<CHAR, TRAITS, TYPES...>::checkSize() const
+  {
+    const ::std::size_t n = this->_last_cells.size();
+    if(n < size)
+    {
+      // same positions as BasicRow::operator[] for the first missing cell
+      const range_type last = n ? this->_last_cells.back() : range_type(0, 0);
+      throw CellOutOfRangeError("Cell index " + ::std::to_string(n) + 
+                                " out of range [0," + 
+                                ::std::to_string(n) + ")",
+                                n,
+                                n,
+                                this->_flushed_input_line,
+                                last._input_column,
+                                last._csv_row,
+                                last._csv_column);
+    }
+    else if(n > size)
+    {
+      const range_type & extra = this->_last_cells[size];
+      throw CellOutOfRangeError("Row has " + ::std::to_string(n) + 
+                                " cells, expected " + 
+                                ::std::to_string(size),
+                                size,
+                                n,
+                                this->_flushed_input_line,
+                                extra._input_column,
+                                extra._csv_row,
+                                extra._csv_column);
+    }
+  }
+
+  template<typename CHAR, typename TRAITS, typename... TYPES>
+  template<typename T>
+  inline void BasicTypedReader<CHAR, TRAITS, TYPES...>::convert(::std::size_t i,
+                                                                T & value) const
+  {
+    typedef BasicSerializer<char_type, char_traits, T> serializer_type;
+    const range_type & range = this->_last_cells[i];
+    const char_type * begin;
+    const char_type * end;
+    this->cellData(i, begin, end);
+    CSV_STATISTICS(StatisticsTimer timer(this->_specs->conversionStatistics()));
+    if(!serializer_type::parse(begin, end, _locale, value))
+    {
+      ::std::type_index ti(typeid(T));
+      throw ConversionError(::std::string("Cannot convert cell content ") + 
+                            ti.name(),
+                            ti,
+                            range._input_line,
+                            range._input_column,
+                            range._csv_row,
+                            range._csv_column);
+    }
+  }
+}
@@ -0,0 +1,263 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace csv
+{
+  /**
+   * Appends the UTF-8 range [begin, end) decoded to out. Code points 
+   * above 0xFFFF are stored as surrogate pairs if the character type 
+   * of out has 16 bits. Returns false on malformed input (overlong 
+   * forms, surrogates, truncated sequences, code points > 0x10FFFF), 
+   * the content of out is undefined in this case.
+   * Runs of ASCII are widened 16 bytes at a time if SSE2 is available.
+   */
+  template<typename WCHAR, typename WTRAITS>
+  inline bool decodeUtf8(const char * begin, const char * end,
+                         ::std::basic_string<WCHAR, WTRAITS> & out);
+
+  /**
+   * Appends the characters [begin, end) encoded as UTF-8 to out. 
+   * Surrogate pairs are combined, unpaired surrogates and invalid code 
+   * points are replaced by U+FFFD. Narrow characters are copied.
+   */
+  template<typename WCHAR, typename STRING>
+  inline void encodeUtf8(const WCHAR * begin, const WCHAR * end, STRING & out);
+
+  ///////////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////////
+  namespace detail
+  {
+    /**
+     * Returns the number of leading ASCII bytes of the 16 bytes at src.
+     * If all 16 are ASCII, they are widened to dst.
+     */
+    template<typename WCHAR>
+    inline ::std::size_t widenAscii16(const unsigned char * src, WCHAR * dst)
+    {
+#ifdef __SSE2__
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+      int mask = _mm_movemask_epi8(block);
+      if(mask)
+      {
+        return __builtin_ctz(mask);
+      }
+      if(sizeof(WCHAR) == 2 || sizeof(WCHAR) == 4)
+      {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo   = _mm_unpacklo_epi8(block, zero);
+        __m128i hi   = _mm_unpackhi_epi8(block, zero);
+        __m128i * p  = reinterpret_cast<__m128i*>(dst);
+        if(sizeof(WCHAR) == 2)
+        {
+          _mm_storeu_si128(p,     lo);
+          _mm_storeu_si128(p + 1, hi);
+        }
+        else
+        {
+          _mm_storeu_si128(p,     _mm_unpacklo_epi16(lo, zero));
+          _mm_storeu_si128(p + 1, _mm_unpackhi_epi16(lo, zero));
+          _mm_storeu_si128(p + 2, _mm_unpacklo_epi16(hi, zero));
+          _mm_storeu_si128(p + 3, _mm_unpackhi_epi16(hi, zero));
+        }
+        return 16;
+      }
+#endif
+      for(::std::size_t i = 0; i < 16; i++)
+      {
+        if(src[i] & 0x80)
+        {
+          return i;
+        }
+      }
+      for(::std::size_t i = 0; i < 16; i++)
+      {
+        dst[i] = WCHAR(src[i]);
+      }
+      return 16;
+    }
+
+    /**
+     * Decodes one multi-byte sequence starting at p, returns the number 
+     * of bytes consumed or 0 if the sequence is malformed.
+     */
+    inline ::std::size_t decodeUtf8Sequence(const unsigned char * p, 
+                                            const unsigned char * end,
+                                            ::std::uint32_t & cp)
+    {
+      unsigned char lead = *p;
+      ::std::size_t n;
+      ::std::uint32_t min;
+      if(lead >= 0xC2 && lead <= 0xDF)
+      {
+        n = 2; min = 0x80; cp = lead & 0x1F;
+      }
+      else if(lead >= 0xE0 && lead <= 0xEF)
+      {
+        n = 3; min = 0x800; cp = lead & 0x0F;
+      }
+      else if(lead >= 0xF0 && lead <= 0xF4)
+      {
+        n = 4; min = 0x10000; cp = lead & 0x07;
+      }
+      else
+      {
+        return 0;
+      }
+      if(::std::size_t(end - p) < n)
+      {
+        return 0;
+      }
+      for(::std::size_t i = 1; i < n; i++)
+      {
+        if((p[i] & 0xC0) != 0x80)
+        {
+          return 0;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+      }
+      if(cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+      {
+        return 0;
+      }
+      return n;
+    }
+  } // namespace detail
+
+  template<typename WCHAR, typename WTRAITS>
+  inline bool decodeUtf8(const char * begin, const char * end,
+                         ::std::basic_string<WCHAR, WTRAITS> & out)
+  {
+    const unsigned char * p = reinterpret_cast<const unsigned char*>(begin);
+    const unsigned char * e = reinterpret_cast<const unsigned char*>(end);
+    // every byte yields at most one character, 4 byte sequences
+    // at most 2 surrogates
+    ::std::size_t pos = out.size();
+    out.resize(pos + (e - p));
+    WCHAR * dst = &out[0];
+    while(p != e)
+    {
+      if(e - p >= 16)
+      {
+        ::std::size_t n = detail::widenAscii16(p, dst + pos);
+        if(n == 16)
+        {
+          p   += 16;
+          pos += 16;
+          continue;
+        }
+        for(; n; n--)
+        {
+          dst[pos++] = WCHAR(*p++);
+        }
+      }
+      if(*p < 0x80)
+      {
+        dst[pos++] = WCHAR(*p++);
+      }
+      else
+      {
+        ::std::uint32_t cp;
+        ::std::size_t n = detail::decodeUtf8Sequence(p, e, cp);
+        if(!n)
+        {
+          return false;
+        }
+        p += n;
+        if(sizeof(WCHAR) == 2 && cp > 0xFFFF)
+        {
+          cp -= 0x10000;
+          dst[pos++] = WCHAR(0xD800 + (cp >> 10));
+          dst[pos++] = WCHAR(0xDC00 + (cp & 0x3FF));
+        }
+        else
+        {
+          dst[pos++] = WCHAR(cp);
+        }
+      }
+    }
+    out.resize(pos);
+    return true;
+  }
+
+  template<typename WCHAR, typename STRING>
+  inline void encodeUtf8(const WCHAR * begin, const WCHAR * end, STRING & out)
+  {
+    if(sizeof(WCHAR) == 1)
+    {
+      out.insert(out.end(), begin, end);
+      return;
+    }
+    while(begin != end)
+    {
+      ::std::uint32_t cp = ::std::uint32_t(*begin++);
+      if(cp < 0x80)
+      {
+        out.push_back(char(cp));
+        continue;
+      }
+      if(cp >= 0xD800 && cp < 0xDC00 && begin != end &&
+         ::std::uint32_t(*begin) >= 0xDC00 && ::std::uint32_t(*begin) < 0xE000)
+      {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (::std::uint32_t(*begin++) - 0xDC00);
+      }
+      else if((cp >= 0xD800 && cp < 0xE000) || cp > 0x10FFFF)
+      {
+        cp = 0xFFFD;
+      }
+      if(cp < 0x800)
+      {
+        out.push_back(char(0xC0 | (cp >> 6)));
+      }
+      else if(cp < 0x10000)
+      {
+        out.push_back(char(0xE0 | (cp >> 12)));
+        out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+      }
+      else
+      {
+        out.push_back(char(0xF0 | (cp >> 18)));
+        out.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+      }
+      out.push_back(char(0x80 | (cp & 0x3F)));
+    }
+  }
+} // namespace csv
@@ -0,0 +1,337 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <istream>
+#include <streambuf>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <exception>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "csv_common.h"
+
+namespace csv
+{
+  /**
+   * Stream buffer that passes a source stream through in blocks and 
+   * checks each block for well-formed UTF-8 before it is handed to the
+   * reader. A leading byte order mark is removed.
+   *
+   * Bytes before a malformed sequence are delivered, reading the 
+   * malformed sequence throws a ParseError with its input line and 
+   * column (0-based, lines end with LF or CR LF, columns count bytes).
+   * The row and column of the CSV table are not known to the buffer 
+   * and are 0.
+   */
+  class Utf8InputBuffer : public ::std::streambuf
+  {
+  public:
+    static const ::std::size_t default_block_size = 1u << 16;
+
+    Utf8InputBuffer(::std::istream & source,
+                    ::std::size_t    block_size = default_block_size);
+
+    Utf8InputBuffer(const Utf8InputBuffer &) = delete;
+    Utf8InputBuffer & operator=(const Utf8InputBuffer &) = delete;
+
+    /** true if the input started with a byte order mark */
+    inline bool hasBom() const;
+
+    /**
+     * Returns the length of the well-formed prefix of [begin, end).
+     * incomplete is set if the range ends within a multi-byte sequence
+     * that may be completed by the following bytes.
+     */
+    static ::std::size_t validate(const char * begin, const char * end,
+                                  bool & incomplete);
+
+  protected:
+    int_type underflow() override;
+
+  private:
+    void countLines(const char * begin, const char * end);
+
+    ::std::istream &     _source;
+    ::std::vector<char>  _block;
+    // bytes of an incomplete sequence at the end of the previous block
+    ::std::size_t        _carry;
+    bool                 _started;
+    bool                 _has_bom;
+    ::std::size_t        _line;
+    ::std::size_t        _column;
+    // the previous block ended with CR
+    bool                 _after_cr;
+    ::std::exception_ptr _error;
+  };
+
+  /**
+   * Input stream over a Utf8InputBuffer, can be passed directly to
+   * BasicReader. Malformed UTF-8 is rethrown as ParseError.
+   */
+  class Utf8InputStream : public ::std::istream
+  {
+  public:
+    Utf8InputStream(::std::istream & source,
+                    ::std::size_t    block_size = 
+                      Utf8InputBuffer::default_block_size);
+
+    inline bool hasBom() const;
+
+  private:
+    Utf8InputBuffer _buffer;
+  };
+
+  ///////////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////////
+  inline Utf8InputBuffer::Utf8InputBuffer(::std::istream & source,
+                                          ::std::size_t block_size)
+    : _source(source),
+      _block(block_size < 16 ? 16 : block_size),
+      _carry(0),
+      _started(false),
+      _has_bom(false),
+      _line(0),
+      _column(0),
+      _after_cr(false)
+  {
+    setg(_block.data(), _block.data(), _block.data());
+  }
+
+  inline bool Utf8InputBuffer::hasBom() const
+  {
+    return _has_bom;
+  }
+
+  inline ::std::size_t Utf8InputBuffer::validate(const char * begin, 
+                                                 const char * end,
+                                                 bool & incomplete)
+  {
+    const unsigned char * p = reinterpret_cast<const unsigned char*>(begin);
+    const unsigned char * e = reinterpret_cast<const unsigned char*>(end);
+    incomplete = false;
+    while(p != e)
+    {
+#ifdef __SSE2__
+      while(e - p >= 32)
+      {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+        if(_mm_movemask_epi8(_mm_or_si128(a, b)))
+        {
+          break;
+        }
+        p+= 32;
+      }
+#endif
+      while(p != e && *p < 0x80)
+      {
+        ++p;
+      }
+      if(p == e)
+      {
+        break;
+      }
+      unsigned char lead = *p;
+      ::std::size_t n;
+      // valid range of the second byte
+      unsigned char lo = 0x80;
+      unsigned char hi = 0xBF;
+      if(lead >= 0xC2 && lead <= 0xDF)
+      {
+        n = 2;
+      }
+      else if(lead >= 0xE0 && lead <= 0xEF)
+      {
+        n  = 3;
+        lo = lead == 0xE0 ? 0xA0 : 0x80;   // overlong
+        hi = lead == 0xED ? 0x9F : 0xBF;   // surrogates
+      }
+      else if(lead >= 0xF0 && lead <= 0xF4)
+      {
+        n  = 4;
+        lo = lead == 0xF0 ? 0x90 : 0x80;   // overlong
+        hi = lead == 0xF4 ? 0x8F : 0xBF;   // > 0x10FFFF
+      }
+      else
+      {
+        break;
+      }
+      ::std::size_t avail = ::std::size_t(e - p);
+      ::std::size_t i = 1;
+      if(avail > 1 && (p[1] < lo || p[1] > hi))
+      {
+        break;
+      }
+      for(i = 2; i < n && i < avail; i++)
+      {
+        if((p[i] & 0xC0) != 0x80)
+        {
+          break;
+        }
+      }
+      if(i < n && i < avail)
+      {
+        break;
+      }
+      if(avail < n)
+      {
+        incomplete = true;
+        break;
+      }
+      p+= n;
+    }
+    return reinterpret_cast<const char*>(p) - begin;
+  }
+
+  inline void Utf8InputBuffer::countLines(const char * begin, const char * end)
+  {
+    auto find = [end](const char * from, char ch) -> const char *
+    {
+      const void * found = ::std::memchr(from, ch, end - from);
+      return found ? static_cast<const char*>(found) : end;
+    };
+    const char * last = nullptr;
+    const char * p = begin;
+    // LF of a CR LF split between two blocks
+    if(_after_cr && p < end && *p == '\n')
+    {
+      last = ++p;
+    }
+    const char * lf = find(p, '\n');
+    const char * cr = find(p, '\r');
+    while(lf != end || cr != end)
+    {
+      _line++;
+      if(cr < lf)
+      {
+        // lone CR and CR LF are one line break, as in BasicReader
+        last = cr + 1;
+        if(lf != end && last == lf)
+        {
+          last++;
+          lf = find(last, '\n');
+        }
+        cr = find(last, '\r');
+      }
+      else
+      {
+        last = lf + 1;
+        lf = find(last, '\n');
+      }
+    }
+    if(begin != end)
+    {
+      _after_cr = end[-1] == '\r';
+    }
+    _column = last ? ::std::size_t(end - last) : _column + (end - begin);
+  }
+
+  inline Utf8InputBuffer::int_type Utf8InputBuffer::underflow()
+  {
+    if(gptr() < egptr())
+    {
+      return traits_type::to_int_type(*gptr());
+    }
+    if(_error)
+    {
+      ::std::rethrow_exception(_error);
+    }
+    char * data = _block.data();
+    // the incomplete sequence was left at the end of the get area
+    if(_carry)
+    {
+      ::std::memmove(data, egptr(), _carry);
+    }
+    ::std::size_t size = _carry;
+    if(_source.good())
+    {
+      _source.read(data + size, _block.size() - size);
+      size+= static_cast< ::std::size_t>(_source.gcount());
+    }
+    bool at_end = size < _block.size();
+    char * begin = data;
+    if(!_started)
+    {
+      _started = true;
+      if(size >= 3 && ::std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+      {
+        _has_bom = true;
+        begin+= 3;
+      }
+    }
+    bool incomplete;
+    ::std::size_t valid = validate(begin, data + size, incomplete);
+    char * end = begin + valid;
+    _carry = data + size - end;
+    if(_carry && !(incomplete && !at_end))
+    {
+      countLines(begin, end);
+      _error = ::std::make_exception_ptr(
+        ParseError("Malformed UTF-8 input", _line, _column, 0, 0));
+      _carry = 0;
+    }
+    else
+    {
+      countLines(begin, end);
+    }
+    setg(begin, begin, end);
+    if(begin == end)
+    {
+      if(_error)
+      {
+        ::std::rethrow_exception(_error);
+      }
+      return traits_type::eof();
+    }
+    return traits_type::to_int_type(*gptr());
+  }
+
+  // Utf8InputStream
+  inline Utf8InputStream::Utf8InputStream(::std::istream & source,
+                                          ::std::size_t block_size)
+    : ::std::istream(nullptr),
+      _buffer(source, block_size)
+  {
+    rdbuf(&_buffer);
+    exceptions(::std::ios::badbit);
+  }
+
+  inline bool Utf8InputStream::hasBom() const
+  {
+    return _buffer.hasBom();
+  }
+
+} // namespace csv
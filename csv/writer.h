@@ -0,0 +1,322 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+#pragma once
+#include <ostream>
+#include <vector>
+#include <string>
+#include <memory>
+#include <iterator>
+#include "csv_common.h"
+#include "specification.h"
+#include "cell.h"
+#include "row.h"
+#include "scan.h"
+
+namespace csv
+{
+  /**
+   * Writes CSV rows into an internal buffer which is flushed to the
+   * output stream with one write call per block.
+   *
+   * Cells are only quoted if needed, i.e. if they contain a separator, 
+   * the quote or comment character, a line break or leading / 
+   * trailing white spaces.
+   */
+  template<typename CHAR, typename TRAITS>
+  class BasicWriter
+  {
+  public:
+    typedef CHAR                                         char_type;
+    typedef TRAITS                                       char_traits;
+    typedef ::std::basic_string<char_type,  char_traits> string_type;
+    typedef ::std::basic_ostream<char_type, char_traits> ostream_type;
+    typedef BasicRow<char_type, char_traits>             row_type;
+    typedef BasicCell<char_type, char_traits>            cell_type;
+    typedef typename row_type::spec_type                 spec_type;
+
+    static const ::std::size_t default_block_size = 1u << 16;
+
+    BasicWriter(ostream_type & ost, 
+                spec_type      specs      = spec_type(),
+                ::std::size_t  block_size = default_block_size);
+    ~BasicWriter();
+
+    BasicWriter(const BasicWriter &) = delete;
+    BasicWriter & operator=(const BasicWriter &) = delete;
+
+    inline BasicWriter & writeCell(const char_type * begin, 
+                                   const char_type * end);
+    inline BasicWriter & writeCell(const char_type * str);
+    inline BasicWriter & writeCell(const string_type & str);
+    inline BasicWriter & writeCell(const cell_type & cell);
+    inline BasicWriter & endRow();
+
+    template<typename C>
+    BasicWriter & writeRow(const C & container);
+
+    BasicWriter & writeRow(const row_type & row);
+
+    void flush();
+
+    inline ::std::size_t row() const { return _row; }
+
+  protected:
+    inline bool needsQuotes(const char_type * begin, 
+                            const char_type * end) const;
+    inline void append(const char_type * begin, const char_type * end);
+    inline void appendQuoted(const char_type * begin, const char_type * end);
+    inline void writeBlock();
+
+    ostream_type                                & _ost;
+    spec_type                                     _specs;
+    BasicCharSet<char_type>                       _special;
+    // special characters which did not fit into _special
+    string_type                                   _overflow;
+    char_type                                     _separator;
+    char_type                                     _quote;
+    ::std::vector<char_type>                      _buffer;
+    ::std::size_t                                 _block_size;
+    ::std::size_t                                 _row;
+    ::std::size_t                                 _column;
+    bool                                          _last_cell_empty;
+  };
+
+  ///////////////////////////////////////////////////////////////
+  //
+  // Implementation
+  //
+  ///////////////////////////////////////////////////////////////
+  template<typename CHAR, typename TRAITS>
+  const ::std::size_t BasicWriter<CHAR,TRAITS>::default_block_size;
+
+  template<typename CHAR, typename TRAITS>
+  BasicWriter<CHAR,TRAITS>::BasicWriter(ostream_type & ost,
+                                        spec_type      specs,
+                                        ::std::size_t  block_size)
+    : _ost(ost),
+      _specs(specs),
+      _separator(specs.defaultSeparator()),
+      _quote(specs.quote()),
+      _block_size(block_size),
+      _row(0),
+      _column(0),
+      _last_cell_empty(false)
+  {
+    string_type special;
+    special.push_back(char_type('\n'));
+    special.push_back(char_type('\r'));
+    special.push_back(_quote);
+    if(_specs._comment_char != char_type(0))
+    {
+      special.push_back(_specs._comment_char);
+    }
+    special.append(_specs._separators.begin(), _specs._separators.end());
+    for(auto ch : special)
+    {
+      if(!_special.insert(ch))
+      {
+        _overflow.push_back(ch);
+      }
+    }
+    _buffer.reserve(_block_size + _block_size / 8);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicWriter<CHAR,TRAITS>::~BasicWriter()
+  {
+    try
+    {
+      flush();
+    }
+    catch(...)
+    {
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline bool BasicWriter<CHAR,TRAITS>::needsQuotes(const char_type * begin,
+                                                    const char_type * end) const
+  {
+    if(begin == end)
+    {
+      return false;
+    }
+    // the reader strips white spaces around unquoted cells
+    if(*begin == ' ' || *begin == '\t' || end[-1] == ' ' || end[-1] == '\t')
+    {
+      return true;
+    }
+    if(_special.find(begin, end) != end)
+    {
+      return true;
+    }
+    for(; !_overflow.empty() && begin != end; ++begin)
+    {
+      if(_overflow.find(*begin) != string_type::npos)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicWriter<CHAR,TRAITS>::append(const char_type * begin,
+                                               const char_type * end)
+  {
+    _buffer.insert(_buffer.end(), begin, end);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicWriter<CHAR,TRAITS>::appendQuoted(const char_type * begin,
+                                                     const char_type * end)
+  {
+    _buffer.push_back(_quote);
+    while(true)
+    {
+      const char_type * pos = char_traits::find(begin, end - begin, _quote);
+      if(!pos)
+      {
+        append(begin, end);
+        break;
+      }
+      append(begin, pos + 1);
+      _buffer.push_back(_quote);
+      begin = pos + 1;
+    }
+    _buffer.push_back(_quote);
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline BasicWriter<CHAR,TRAITS> & 
+  BasicWriter<CHAR,TRAITS>::writeCell(const char_type * begin,
+                                      const char_type * end)
+  {
+    if(_column)
+    {
+      _buffer.push_back(_separator);
+    }
+    _last_cell_empty = (begin == end);
+    if(needsQuotes(begin, end))
+    {
+      appendQuoted(begin, end);
+    }
+    else
+    {
+      append(begin, end);
+    }
+    _column++;
+    if(_buffer.size() >= _block_size)
+    {
+      writeBlock();
+    }
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline BasicWriter<CHAR,TRAITS> & 
+  BasicWriter<CHAR,TRAITS>::writeCell(const char_type * str)
+  {
+    return writeCell(str, str + char_traits::length(str));
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline BasicWriter<CHAR,TRAITS> & 
+  BasicWriter<CHAR,TRAITS>::writeCell(const string_type & str)
+  {
+    return writeCell(str.data(), str.data() + str.size());
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline BasicWriter<CHAR,TRAITS> & 
+  BasicWriter<CHAR,TRAITS>::writeCell(const cell_type & cell)
+  {
+    return writeCell(cell.data(), cell.data() + cell.size());
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline BasicWriter<CHAR,TRAITS> & BasicWriter<CHAR,TRAITS>::endRow()
+  {
+    if(_column == 1 && _last_cell_empty)
+    {
+      // a single empty cell would be read as an empty line
+      _buffer.push_back(_quote);
+      _buffer.push_back(_quote);
+    }
+    _buffer.push_back(char_type('\n'));
+    _column = 0;
+    _row++;
+    if(_buffer.size() >= _block_size)
+    {
+      writeBlock();
+    }
+    return *this;
+  }
+
+  template<typename CHAR, typename TRAITS>
+  template<typename C>
+  BasicWriter<CHAR,TRAITS> & BasicWriter<CHAR,TRAITS>::writeRow(const C & container)
+  {
+    for(auto itr = ::std::begin(container); itr != ::std::end(container); ++itr)
+    {
+      writeCell(*itr);
+    }
+    return endRow();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  BasicWriter<CHAR,TRAITS> & BasicWriter<CHAR,TRAITS>::writeRow(const row_type & row)
+  {
+    for(auto & cell : row)
+    {
+      writeCell(cell);
+    }
+    return endRow();
+  }
+
+  template<typename CHAR, typename TRAITS>
+  inline void BasicWriter<CHAR,TRAITS>::writeBlock()
+  {
+    if(!_buffer.empty())
+    {
+      _ost.write(_buffer.data(), _buffer.size());
+      _buffer.clear();
+    }
+  }
+
+  template<typename CHAR, typename TRAITS>
+  void BasicWriter<CHAR,TRAITS>::flush()
+  {
+    writeBlock();
+    _ost.flush();
+  }
+
+} // namespace csv
@@ -32,6 +32,7 @@ either expressed or implied, of the FreeBSD Project.
 #include <string>
 #include <sstream>
 #include <vector>
+#include <cmath>
 
 #include "csv/specification.h"
 #include "csv/reader.h"
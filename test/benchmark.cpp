@@ -1,170 +1,654 @@
-#include <sstream>
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+/**
+ * Benchmarks of the reader on generated data sets.
+ *
+ *   benchmark [--mb N] [--repeat N] [--filter TEXT] [--json FILE]
+ *
+ * Each data set of about N MB (default 16) is generated in memory and
+ * read with every applicable scenario; the best of --repeat runs is
+ * reported as MB/s and rows/s.
+ * Unless built with CSV_BENCHMARK_WITHOUT_ALLOCATION_TRACKING, the
+ * global operator new and delete are replaced to count allocations and
+ * allocated bytes per row and the peak of the bytes retained during a
+ * run. The retain_* scenarios keep all rows or objects and report the
+ * bytes accounted by memoryUsage() of reader and rows as well.
+ * --json writes the results as a JSON array for comparing runs.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <new>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 #include "csv/reader.h"
+#include "csv/object_reader.h"
+#include "csv/typed_reader.h"
+#include "csv/utf8_input.h"
 
-class BenchmarkInputBuffer : public std::streambuf
+//////////////////////////////////////////////////////////////////////
+//
+// allocation tracking
+//
+//////////////////////////////////////////////////////////////////////
+struct AllocationCounters
+{
+  std::atomic<std::size_t> allocations;
+  std::atomic<std::size_t> bytes;
+  std::atomic<std::size_t> retained;
+  std::atomic<std::size_t> peak;
+};
+
+static AllocationCounters allocation_counters;
+
+struct AllocationSnapshot
+{
+  std::size_t allocations;
+  std::size_t bytes;
+  std::size_t retained;
+
+  /** Starts a measurement, the peak is reset to the retained bytes */
+  static AllocationSnapshot start()
+  {
+    AllocationSnapshot ret{allocation_counters.allocations.load(),
+                           allocation_counters.bytes.load(),
+                           allocation_counters.retained.load()};
+    allocation_counters.peak.store(ret.retained);
+    return ret;
+  }
+
+  std::size_t peakSinceStart() const
+  {
+    std::size_t peak = allocation_counters.peak.load();
+    return peak > retained ? peak - retained : 0;
+  }
+};
+
+#ifndef CSV_BENCHMARK_WITHOUT_ALLOCATION_TRACKING
+// the size of each allocation is stored in front of the block
+static const std::size_t allocation_header = 16;
+
+void * operator new(std::size_t size)
+{
+  char * p = static_cast<char*>(std::malloc(size + allocation_header));
+  if(!p)
+  {
+    throw std::bad_alloc();
+  }
+  *reinterpret_cast<std::size_t*>(p) = size;
+  allocation_counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  allocation_counters.bytes.fetch_add(size, std::memory_order_relaxed);
+  std::size_t retained = 
+    allocation_counters.retained.fetch_add(size, std::memory_order_relaxed) + size;
+  std::size_t peak = allocation_counters.peak.load(std::memory_order_relaxed);
+  while(retained > peak &&
+        !allocation_counters.peak.compare_exchange_weak(peak, retained,
+                                                        std::memory_order_relaxed))
+  {
+  }
+  return p + allocation_header;
+}
+
+void operator delete(void * ptr) noexcept
+{
+  if(ptr)
+  {
+    char * p = static_cast<char*>(ptr) - allocation_header;
+    allocation_counters.retained.fetch_sub(*reinterpret_cast<std::size_t*>(p),
+                                           std::memory_order_relaxed);
+    std::free(p);
+  }
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////
+//
+// data sets
+//
+//////////////////////////////////////////////////////////////////////
+class Random
 {
 public:
-  BenchmarkInputBuffer(std::size_t n_rows, std::size_t n_cols)
+  Random(std::uint64_t seed) : _state(seed ? seed : 1) {}
+
+  // xorshift64*
+  inline std::uint64_t next()
   {
-    std::stringstream ost;
-    for(std::size_t i = 0; i < n_cols; i++) 
-      {
-        ost << "  " << i << " ";
-      }
-    _buffer  = ost.str();
-    _current = _buffer.begin();
-    _n_rows  = n_rows;
-    _row     = 1;
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    return _state * 2685821657736338717ull;
+  }
+
+  inline std::size_t below(std::size_t n)
+  {
+    return std::size_t(next() % n);
   }
 
 private:
-  std::string                 _buffer;
-  std::string::const_iterator _current;
-  std::size_t                 _n_rows;
-  std::size_t                 _row;
+  std::uint64_t _state;
+};
 
-  int_type underflow() override 
+struct Dataset
+{
+  std::string         name;
+  std::string         data;
+  std::size_t         rows;
+  // one of i(nt), d(ouble), s(tring) per column
+  std::string         types;
+  std::vector<std::string> names;
+  csv::Specification  spec;
+};
+
+static std::string word(Random & rnd, std::size_t min_len, std::size_t max_len)
+{
+  std::size_t n = min_len + rnd.below(max_len - min_len + 1);
+  std::string ret(n, ' ');
+  for(std::size_t i = 0; i < n; i++)
   {
-    if (_current == _buffer.end())
-      {
-        if(_row < _n_rows) 
-          {
-            return traits_type::to_int_type('\n');
-          }
-        else 
-          {
-            return traits_type::eof();
-          }
-      }
-    else 
-      {
-        return traits_type::to_int_type(*_current);
-      }
+    ret[i] = char('a' + rnd.below(26));
   }
+  return ret;
+}
 
-  int_type uflow() override 
+static std::string quoted(const std::string & str)
+{
+  std::string ret("\"");
+  for(auto ch : str)
   {
-    if (_current == _buffer.end())
-      {
-        if(_row < _n_rows) 
-          {
-            _row++;
-            _current = _buffer.begin();
-            return traits_type::to_int_type('\n');
-          }
-        else 
-          {
-            return traits_type::eof();
-          }
-      }
-    else 
-      {
-        return traits_type::to_int_type(*_current++);
-      }
+    if(ch == '"')
+    {
+      ret.push_back('"');
+    }
+    ret.push_back(ch);
   }
+  ret.push_back('"');
+  return ret;
+}
 
-  int_type pbackfail(int_type ch)
+/**
+ * Generates rows with the row function until the data set has
+ * about bytes bytes.
+ */
+static Dataset generate(const std::string & name,
+                        const std::string & types,
+                        std::size_t bytes,
+                        const std::function<void(Random &, std::ostream &)> & row,
+                        csv::Specification spec = csv::Specification())
+{
+  Dataset ds;
+  ds.name  = name;
+  ds.types = types;
+  ds.rows  = 0;
+  std::ostringstream ost;
+  for(std::size_t i = 0; i < types.size(); i++)
   {
-    throw std::logic_error("pbackfail not expected to be called");
+    ds.names.push_back("c" + std::to_string(i));
+    ost << (i ? "," : "") << ds.names.back();
   }
-  
-  std::streamsize showmanyc()
+  ost << "\n";
+  Random rnd(0x5eed + name.size());
+  while(std::size_t(ost.tellp()) < bytes)
   {
-    return _buffer.size() * _n_rows;
+    row(rnd, ost);
+    ds.rows++;
   }
+  ds.data = ost.str();
+  ds.spec = spec.withHeader();
+  return ds;
+}
+
+static std::vector<Dataset> generateDatasets(std::size_t bytes)
+{
+  std::vector<Dataset> ret;
+  ret.push_back(generate("narrow_numeric", "iidd", bytes,
+                         [](Random & rnd, std::ostream & ost)
+                         {
+                           ost << rnd.below(1000000) << ","
+                               << int(rnd.below(2000)) - 1000 << ","
+                               << rnd.below(100000) / 100.0 << ","
+                               << rnd.below(1000000) / 1000.0 << "\n";
+                         }));
+  std::string wide;
+  for(int i = 0; i < 40; i++)
+  {
+    wide.push_back("ids"[i % 3]);
+  }
+  ret.push_back(generate("wide_mixed", wide, bytes,
+                         [](Random & rnd, std::ostream & ost)
+                         {
+                           for(int i = 0; i < 40; i++)
+                           {
+                             ost << (i ? "," : "");
+                             switch(i % 3)
+                             {
+                             case 0: ost << rnd.below(100000); break;
+                             case 1: ost << rnd.below(100000) / 7.0; break;
+                             default: ost << word(rnd, 2, 12); break;
+                             }
+                           }
+                           ost << "\n";
+                         }));
+  ret.push_back(generate("quoted", "ssssssss", bytes,
+                         [](Random & rnd, std::ostream & ost)
+                         {
+                           for(int i = 0; i < 8; i++)
+                           {
+                             ost << (i ? "," : "")
+                                 << quoted(word(rnd, 1, 8) + ", \"" +
+                                           word(rnd, 1, 8) + "\"");
+                           }
+                           ost << "\n";
+                         }));
+  ret.push_back(generate("multiline", "isis", bytes,
+                         [](Random & rnd, std::ostream & ost)
+                         {
+                           ost << rnd.below(100000) << ","
+                               << quoted(word(rnd, 5, 30) + "\n" + word(rnd, 5, 30)) << ","
+                               << rnd.below(100000) << ","
+                               << quoted(word(rnd, 5, 30) + "\n" + word(rnd, 5, 30) +
+                                         "\n" + word(rnd, 5, 30)) << "\n";
+                         }));
+  ret.push_back(generate("comments", "iiiiii", bytes,
+                         [](Random & rnd, std::ostream & ost)
+                         {
+                           ost << "# " << word(rnd, 10, 60) << "\n";
+                           for(int i = 0; i < 6; i++)
+                           {
+                             ost << (i ? "," : "") << rnd.below(100000);
+                           }
+                           ost << " # " << word(rnd, 5, 20) << "\n";
+                         },
+                         csv::Specification().withComment('#')));
+  ret.push_back(generate("long_cells", "isi", bytes,
+                         [](Random & rnd, std::ostream & ost)
+                         {
+                           ost << rnd.below(100000) << ","
+                               << word(rnd, 2000, 8000) << ","
+                               << rnd.below(100000) << "\n";
+                         }));
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// scenarios
+//
+//////////////////////////////////////////////////////////////////////
+struct Input
+{
+  csv::BasicRangeBuffer<char, std::char_traits<char> > buffer;
+  std::istream                                          ist;
+
+  Input(const Dataset & ds)
+    : buffer(ds.data.data(), ds.data.data() + ds.data.size()),
+      ist(&buffer)
+  {}
+};
+
+struct Scenario
+{
+  std::string name;
+  // false if the scenario does not apply to the data set
+  std::function<bool(const Dataset &)> applies;
+  // returns a checksum to keep the work from being optimized away,
+  // sets accounted to the bytes reported by memoryUsage()
+  std::function<std::size_t(const Dataset &, std::size_t & accounted)> run;
 };
 
+static bool hasType(const Dataset & ds, char type)
+{
+  return ds.types.find(type) != std::string::npos;
+}
 
-std::size_t readFromIstream(std::size_t nrows, std::size_t ncols) 
+template<typename T>
+static std::size_t convertColumns(const Dataset & ds, char type)
 {
-  BenchmarkInputBuffer buffer(nrows,ncols);
+  Input input(ds);
+  csv::Reader reader(input.ist, ds.spec);
+  std::size_t sum = 0;
+  for(auto & row : reader)
   {
-    std::istream ist(&buffer);
-    int a;
-    int hash = 0;
-    std::size_t counter = 0;
-    while(ist >> a)
+    for(std::size_t i = 0; i < ds.types.size(); i++)
+    {
+      if(ds.types[i] == type)
       {
-        hash+=a;
-        counter++;
+        sum += std::size_t(row[i].as<T>() != T());
       }
-    return counter;
+    }
   }
+  return sum;
 }
 
-std::size_t readFromCsvReader(std::size_t nrows, std::size_t ncols) 
-{
-  BenchmarkInputBuffer buffer(nrows,ncols);
-  {
-    std::istream ist(&buffer);
-    csv::Reader reader(ist,
-                       csv::Specification()
-                       .withSeparator(' ')
-                       .withSeparator(' ')
-                       .withoutHeader());
-    
-    int a;
-    int hash = 0;
-    std::size_t counter = 0;
-    std::size_t row_counter = 0;
-    for(auto row : reader) 
-      {
-        for(auto cell : row) 
-          {
-            a = cell.as<int>();
-            hash+= a;
-            counter++;
-          }
-        row_counter++;
-      }
-    return counter;
-  }
+struct Narrow
+{
+  int    a;
+  int    b;
+  double c;
+  double d;
+  Narrow() : a(0), b(0), c(0), d(0) {}
+};
+
+static csv::Builder<Narrow> narrowBuilder()
+{
+  csv::Builder<Narrow> builder;
+  builder
+    .member<int>(&Narrow::a, "c0", 0)
+    .member<int>(&Narrow::b, "c1", 0)
+    .member<double>(&Narrow::c, "c2", 0.0)
+    .member<double>(&Narrow::d, "c3", 0.0);
+  return builder;
 }
 
+static std::size_t retainRows(const Dataset & ds, bool arena, std::size_t & accounted)
+{
+  Input input(ds);
+  csv::Reader reader(input.ist, ds.spec);
+  if(arena)
+  {
+    reader.withArena();
+  }
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  accounted = reader.memoryUsage() + rows.capacity() * sizeof(csv::Row);
+  for(auto & row : rows)
+  {
+    accounted += row.memoryUsage();
+  }
+  return rows.size();
+}
 
-int main(int argc, const char ** argv)
+static std::vector<Scenario> scenarios()
 {
-  bool ok = true;
-  std::function<std::size_t(std::size_t, std::size_t)> exe;
-  std::size_t nrows = 0;
-  std::size_t ncols = 0;
-  if(argc < 4) 
-    {
-      ok = false;
-    }
-  else 
-    {
-      if(argv[1] == std::string("std")) 
+  std::vector<Scenario> ret;
+  ret.push_back(Scenario{
+      "tokenize",
+      [](const Dataset &) { return true; },
+      [](const Dataset & ds, std::size_t &)
+      {
+        Input input(ds);
+        csv::Reader reader(input.ist, ds.spec);
+        std::size_t cells = 0;
+        for(auto & row : reader)
         {
-          exe = readFromIstream;
+          cells += row.size();
         }
-      else if(argv[1] == std::string("csv"))
+        return cells;
+      }});
+  ret.push_back(Scenario{
+      "tokenize_utf8",
+      [](const Dataset &) { return true; },
+      [](const Dataset & ds, std::size_t &)
+      {
+        Input input(ds);
+        csv::Utf8InputStream ist(input.ist);
+        csv::Reader reader(ist, ds.spec);
+        std::size_t cells = 0;
+        for(auto & row : reader)
         {
-          exe = readFromCsvReader;
+          cells += row.size();
         }
-      else
+        return cells;
+      }});
+  ret.push_back(Scenario{
+      "as_int",
+      [](const Dataset & ds) { return hasType(ds, 'i'); },
+      [](const Dataset & ds, std::size_t &) { return convertColumns<int>(ds, 'i'); }});
+  ret.push_back(Scenario{
+      "as_double",
+      [](const Dataset & ds) { return hasType(ds, 'd'); },
+      [](const Dataset & ds, std::size_t &) { return convertColumns<double>(ds, 'd'); }});
+  ret.push_back(Scenario{
+      "as_string",
+      [](const Dataset & ds) { return hasType(ds, 's'); },
+      [](const Dataset & ds, std::size_t &) { return convertColumns<std::string>(ds, 's'); }});
+  ret.push_back(Scenario{
+      "as_wstring",
+      [](const Dataset & ds) { return hasType(ds, 's'); },
+      [](const Dataset & ds, std::size_t &) { return convertColumns<std::wstring>(ds, 's'); }});
+  ret.push_back(Scenario{
+      "by_name",
+      [](const Dataset &) { return true; },
+      [](const Dataset & ds, std::size_t &)
+      {
+        Input input(ds);
+        csv::Reader reader(input.ist, ds.spec);
+        std::size_t size = 0;
+        for(auto & row : reader)
         {
-          ok = false;
+          for(auto & name : ds.names)
+          {
+            size += row[name].size();
+          }
         }
-      try 
+        return size;
+      }});
+  ret.push_back(Scenario{
+      "object_reader",
+      [](const Dataset & ds) { return ds.name == "narrow_numeric"; },
+      [](const Dataset & ds, std::size_t &)
+      {
+        Input input(ds);
+        csv::ObjectReader<Narrow> reader(narrowBuilder(), input.ist, ds.spec);
+        std::size_t sum = 0;
+        for(auto & obj : reader)
         {
-          nrows = std::stoi(argv[2]);
-          ncols = std::stoi(argv[3]);
+          sum += std::size_t(obj.a);
         }
-      catch(std::exception ex)
+        return sum;
+      }});
+  ret.push_back(Scenario{
+      "typed_reader",
+      [](const Dataset & ds) { return ds.name == "narrow_numeric"; },
+      [](const Dataset & ds, std::size_t &)
+      {
+        Input input(ds);
+        csv::TypedReader<int, int, double, double> reader(input.ist, ds.spec);
+        std::tuple<int, int, double, double> values;
+        std::size_t sum = 0;
+        while(reader.read(values))
         {
-          std::cerr << ex.what() << std::endl;
-          ok = false;
+          sum += std::size_t(std::get<0>(values));
         }
+        return sum;
+      }});
+  ret.push_back(Scenario{
+      "retain_rows",
+      [](const Dataset &) { return true; },
+      [](const Dataset & ds, std::size_t & accounted)
+      {
+        return retainRows(ds, false, accounted);
+      }});
+  ret.push_back(Scenario{
+      "retain_rows_arena",
+      [](const Dataset &) { return true; },
+      [](const Dataset & ds, std::size_t & accounted)
+      {
+        return retainRows(ds, true, accounted);
+      }});
+  ret.push_back(Scenario{
+      "retain_objects",
+      [](const Dataset & ds) { return ds.name == "narrow_numeric"; },
+      [](const Dataset & ds, std::size_t & accounted)
+      {
+        Input input(ds);
+        csv::ObjectReader<Narrow> reader(narrowBuilder(), input.ist, ds.spec);
+        std::vector<Narrow> objects;
+        reader.readInto(objects);
+        accounted = reader.memoryUsage() + objects.capacity() * sizeof(Narrow);
+        return objects.size();
+      }});
+  return ret;
+}
+
+//////////////////////////////////////////////////////////////////////
+//
+// main
+//
+//////////////////////////////////////////////////////////////////////
+struct Result
+{
+  std::string dataset;
+  std::string scenario;
+  std::size_t bytes;
+  std::size_t rows;
+  double      seconds;
+  std::size_t allocations;
+  std::size_t allocated_bytes;
+  std::size_t peak_bytes;
+  std::size_t accounted_bytes;
+  std::size_t checksum;
+
+  double mbPerSecond() const       { return bytes / seconds / 1e6; }
+  double rowsPerSecond() const     { return rows / seconds; }
+  double allocationsPerRow() const { return double(allocations) / rows; }
+  double bytesPerRow() const       { return double(allocated_bytes) / rows; }
+  double peakBytesPerRow() const   { return double(peak_bytes) / rows; }
+};
+
+static void writeJson(std::ostream & ost, const std::vector<Result> & results)
+{
+  ost << "[\n";
+  for(std::size_t i = 0; i < results.size(); i++)
+  {
+    const Result & r = results[i];
+    ost << "  {\"dataset\": \"" << r.dataset << "\", "
+        << "\"scenario\": \"" << r.scenario << "\", "
+        << "\"bytes\": " << r.bytes << ", "
+        << "\"rows\": " << r.rows << ", "
+        << "\"seconds\": " << r.seconds << ", "
+        << "\"mb_per_s\": " << r.mbPerSecond() << ", "
+        << "\"rows_per_s\": " << r.rowsPerSecond() << ", "
+        << "\"allocations_per_row\": " << r.allocationsPerRow() << ", "
+        << "\"bytes_per_row\": " << r.bytesPerRow() << ", "
+        << "\"peak_bytes\": " << r.peak_bytes << ", "
+        << "\"peak_bytes_per_row\": " << r.peakBytesPerRow() << ", "
+        << "\"accounted_bytes\": " << r.accounted_bytes << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  ost << "]\n";
+}
+
+int main(int argc, const char ** argv)
+{
+  std::size_t mb     = 16;
+  std::size_t repeat = 3;
+  std::string filter;
+  std::string json;
+  for(int i = 1; i < argc; i++)
+  {
+    std::string arg(argv[i]);
+    if(i + 1 < argc && arg == "--mb")
+    {
+      mb = std::stoul(argv[++i]);
+    }
+    else if(i + 1 < argc && arg == "--repeat")
+    {
+      repeat = std::stoul(argv[++i]);
+    }
+    else if(i + 1 < argc && arg == "--filter")
+    {
+      filter = argv[++i];
+    }
+    else if(i + 1 < argc && arg == "--json")
+    {
+      json = argv[++i];
     }
-  if(!ok) 
+    else
     {
-      std::cerr << "run test as " << argv[0] << " std|csv nrows ncols" << std::endl;
+      std::cerr << "run as " << argv[0]
+                << " [--mb N] [--repeat N] [--filter TEXT] [--json FILE]"
+                << std::endl;
       return 8;
     }
-  std::size_t n = exe(nrows, ncols);
-  std::cout << n << " values read with method " << argv[1] << std::endl;
+  }
+  std::vector<Result> results;
+  std::cout << std::left << std::setw(16) << "dataset"
+            << std::setw(19) << "scenario"
+            << std::right << std::setw(10) << "MB/s"
+            << std::setw(14) << "rows/s"
+            << std::setw(12) << "allocs/row"
+            << std::setw(12) << "bytes/row"
+            << std::setw(12) << "peak MB"
+            << std::setw(14) << "accounted MB" << std::endl;
+  for(auto & ds : generateDatasets(mb * 1000000))
+  {
+    for(auto & scenario : scenarios())
+    {
+      std::string label = ds.name + "/" + scenario.name;
+      if(!scenario.applies(ds) || label.find(filter) == std::string::npos)
+      {
+        continue;
+      }
+      Result result{ds.name, scenario.name, ds.data.size(), ds.rows, 
+                    0.0, 0, 0, 0, 0, 0};
+      for(std::size_t r = 0; r < (repeat ? repeat : 1); r++)
+      {
+        AllocationSnapshot snapshot = AllocationSnapshot::start();
+        auto start = std::chrono::steady_clock::now();
+        result.checksum = scenario.run(ds, result.accounted_bytes);
+        std::chrono::duration<double> seconds =
+          std::chrono::steady_clock::now() - start;
+        if(r == 0 || seconds.count() < result.seconds)
+        {
+          result.seconds = seconds.count();
+        }
+        result.allocations     = allocation_counters.allocations.load() - snapshot.allocations;
+        result.allocated_bytes = allocation_counters.bytes.load() - snapshot.bytes;
+        result.peak_bytes      = snapshot.peakSinceStart();
+      }
+      results.push_back(result);
+      std::cout << std::left << std::setw(16) << ds.name
+                << std::setw(19) << scenario.name
+                << std::right << std::fixed << std::setprecision(1)
+                << std::setw(10) << result.mbPerSecond()
+                << std::setw(14) << std::setprecision(0) << result.rowsPerSecond()
+                << std::setw(12) << std::setprecision(2) << result.allocationsPerRow()
+                << std::setw(12) << std::setprecision(1) << result.bytesPerRow()
+                << std::setw(12) << result.peak_bytes / 1e6
+                << std::setw(14) << result.accounted_bytes / 1e6
+                << std::endl;
+    }
+  }
+  if(!json.empty())
+  {
+    std::ofstream ost(json.c_str());
+    writeJson(ost, results);
+  }
   return 0;
 }
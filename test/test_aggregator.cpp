@@ -0,0 +1,217 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/aggregator.h>
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace
+{
+  std::string trades(std::size_t rows)
+  {
+    static const char * currencies[] = { "EUR", "USD", "CHF", "GBP" };
+    std::stringstream ss;
+    ss << "id,currency,amount" << std::endl;
+    for(std::size_t i = 0; i < rows; i++)
+    {
+      ss << i << "," << currencies[i % 4] << "," << (i % 10) << std::endl;
+    }
+    return ss.str();
+  }
+}
+
+TEST_CASE("AggregateByKeyColumn", "[csv_aggregator]")
+{
+  std::stringstream ss;
+  ss << "currency,amount,desk"   << std::endl;
+  ss << "EUR,1.5,a"              << std::endl;
+  ss << "USD,2,b"                << std::endl;
+  ss << "EUR,,a"                 << std::endl;
+  ss << "EUR,3.5,b"              << std::endl;
+  ss << "\"U,SD\",n/a,b"         << std::endl;
+  ss << "USD"                    << std::endl;
+  csv::Reader reader(ss, csv::Specification().withHeader());
+  csv::Aggregator agg;
+  agg.withKey("currency")
+    .withCount()
+    .with(csv::Aggregate::SUM,  "amount")
+    .with(csv::Aggregate::MIN,  "amount")
+    .with(csv::Aggregate::MAX,  1)
+    .with(csv::Aggregate::MEAN, "amount");
+  agg.aggregate(reader);
+  REQUIRE(agg.size() == 3u);
+  REQUIRE(agg.keySize() == 1u);
+  REQUIRE(agg.aggregateSize() == 5u);
+  REQUIRE(agg.key(0, 0) == "EUR");
+  REQUIRE(agg.count(0) == 3u);
+  REQUIRE(agg.value(0, 0) == 3.0);
+  REQUIRE(agg.value(0, 1) == 5.0);
+  REQUIRE(agg.value(0, 2) == 1.5);
+  REQUIRE(agg.value(0, 3) == 3.5);
+  REQUIRE(agg.value(0, 4) == 2.5);
+  REQUIRE(agg.key(1, 0) == "USD");
+  REQUIRE(agg.count(1) == 2u);
+  REQUIRE(agg.value(1, 1) == 2.0);
+  REQUIRE(agg.value(1, 4) == 2.0);
+  // no parseable amount in the group
+  REQUIRE(agg.key(2, 0) == "U,SD");
+  REQUIRE(agg.count(2) == 1u);
+  REQUIRE(agg.value(2, 1) == 0.0);
+  REQUIRE(std::isnan(agg.value(2, 2)));
+  REQUIRE(std::isnan(agg.value(2, 4)));
+}
+
+TEST_CASE("AggregateByCompositeKey", "[csv_aggregator]")
+{
+  std::stringstream ss;
+  ss << "ab,c,1" << std::endl;
+  ss << "a,bc,2" << std::endl;
+  ss << "ab,c,3" << std::endl;
+  ss << ",,4"    << std::endl;
+  csv::Reader reader(ss);
+  csv::Aggregator agg;
+  agg.withKey(0).withKey(1).with(csv::Aggregate::SUM, 2);
+  agg.aggregate(reader);
+  REQUIRE(agg.size() == 3u);
+  REQUIRE(agg.key(0, 0) == "ab");
+  REQUIRE(agg.key(0, 1) == "c");
+  REQUIRE(agg.value(0, 0) == 4.0);
+  REQUIRE(agg.key(1, 0) == "a");
+  REQUIRE(agg.key(1, 1) == "bc");
+  REQUIRE(agg.value(1, 0) == 2.0);
+  REQUIRE(agg.key(2, 0) == "");
+  REQUIRE(agg.key(2, 1) == "");
+  REQUIRE(agg.value(2, 0) == 4.0);
+}
+
+TEST_CASE("CountColumnSkipsEmptyCells", "[csv_aggregator]")
+{
+  std::stringstream ss;
+  ss << "desk,amount,note" << std::endl;
+  ss << "a,1,x"            << std::endl;
+  ss << "a,,"              << std::endl;
+  ss << "a,n/a,y"          << std::endl;
+  ss << "b,,"              << std::endl;
+  ss << "b"                << std::endl;
+  csv::Reader reader(ss, csv::Specification().withHeader());
+  csv::Aggregator agg;
+  agg.withKey("desk")
+    .withCount()
+    .with(csv::Aggregate::COUNT, "amount")
+    .with(csv::Aggregate::COUNT, 2);
+  csv::Aggregator parallel(agg);
+  std::stringstream copy(ss.str());
+  agg.aggregate(reader);
+  REQUIRE(agg.size() == 2u);
+  REQUIRE(agg.value(0, 0) == 3.0);
+  // non-empty cells, numbers or not
+  REQUIRE(agg.value(0, 1) == 2.0);
+  REQUIRE(agg.value(0, 2) == 2.0);
+  REQUIRE(agg.value(1, 0) == 2.0);
+  REQUIRE(agg.value(1, 1) == 0.0);
+  REQUIRE(agg.value(1, 2) == 0.0);
+  csv::Reader reader2(copy, csv::Specification().withHeader());
+  parallel.aggregate(reader2, 2, 1);
+  for(std::size_t i = 0; i < parallel.size(); i++)
+  {
+    std::size_t j = parallel.key(i, 0) == "a" ? 0 : 1;
+    for(std::size_t k = 0; k < 3; k++)
+    {
+      REQUIRE(parallel.value(i, k) == agg.value(j, k));
+    }
+  }
+}
+
+TEST_CASE("AggregateUndefinedColumnThrows", "[csv_aggregator]")
+{
+  std::stringstream ss;
+  ss << "currency,amount" << std::endl;
+  ss << "EUR,1" << std::endl;
+  csv::Reader reader(ss, csv::Specification().withHeader());
+  csv::Aggregator agg;
+  agg.withKey("desk").withCount();
+  REQUIRE_THROWS_AS(agg.aggregate(reader), csv::UndefinedColumnError);
+}
+
+TEST_CASE("AggregateInParallelMatchesSequential", "[csv_aggregator]")
+{
+  const std::string input = trades(10007);
+  std::stringstream ss1(input);
+  std::stringstream ss2(input);
+  csv::Reader reader1(ss1, csv::Specification().withHeader());
+  csv::Reader reader2(ss2, csv::Specification().withHeader());
+  csv::Aggregator sequential;
+  sequential.withKey("currency")
+    .withCount()
+    .with(csv::Aggregate::SUM, "amount")
+    .with(csv::Aggregate::MAX, "amount");
+  csv::Aggregator parallel(sequential);
+  sequential.aggregate(reader1);
+  parallel.aggregate(reader2, 3, 100);
+  REQUIRE(parallel.size() == 4u);
+  std::map<std::string, std::size_t> groups;
+  for(std::size_t i = 0; i < sequential.size(); i++)
+  {
+    groups[sequential.key(i, 0)] = i;
+  }
+  for(std::size_t i = 0; i < parallel.size(); i++)
+  {
+    std::size_t j = groups.at(parallel.key(i, 0));
+    REQUIRE(parallel.count(i) == sequential.count(j));
+    REQUIRE(parallel.value(i, 1) == sequential.value(j, 1));
+    REQUIRE(parallel.value(i, 2) == sequential.value(j, 2));
+  }
+}
+
+TEST_CASE("MergeAggregators", "[csv_aggregator]")
+{
+  std::stringstream ss1("EUR,1\nUSD,2\n");
+  std::stringstream ss2("CHF,3\nEUR,4\n");
+  csv::Reader reader1(ss1);
+  csv::Reader reader2(ss2);
+  csv::Aggregator agg1;
+  agg1.withKey(0).with(csv::Aggregate::MIN, 1);
+  csv::Aggregator agg2(agg1);
+  agg1.aggregate(reader1);
+  agg2.aggregate(reader2);
+  agg1.merge(agg2);
+  REQUIRE(agg1.size() == 3u);
+  REQUIRE(agg1.key(0, 0) == "EUR");
+  REQUIRE(agg1.count(0) == 2u);
+  REQUIRE(agg1.value(0, 0) == 1.0);
+  REQUIRE(agg1.key(2, 0) == "CHF");
+  REQUIRE(agg1.value(2, 0) == 3.0);
+  agg1.clear();
+  REQUIRE(agg1.size() == 0u);
+}
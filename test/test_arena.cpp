@@ -0,0 +1,127 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/arena.h>
+#include <csv/reader.h>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+
+TEST_CASE("ArenaAllocatesAlignedFromBlocks", "[csv_arena]")
+{
+  csv::Arena arena(256);
+  char * a = static_cast<char*>(arena.allocate(3, 1));
+  double * b = static_cast<double*>(arena.allocate(sizeof(double), alignof(double)));
+  REQUIRE(reinterpret_cast<std::uintptr_t>(b) % alignof(double) == 0u);
+  REQUIRE(reinterpret_cast<char*>(b) > a);
+  REQUIRE(arena.capacity() == 256u);
+  arena.allocate(1000, 8);
+  REQUIRE(arena.capacity() == 1256u);
+  // oversized blocks do not replace the current block
+  void * c = arena.allocate(8, 8);
+  REQUIRE(static_cast<char*>(c) < a + 256);
+  REQUIRE(arena.used() == 3u + sizeof(double) + 1000u + 8u);
+}
+
+TEST_CASE("ArenaAllocatorInContainers", "[csv_arena]")
+{
+  auto arena = std::make_shared<csv::Arena>(1024);
+  csv::ArenaAllocator<int> alloc(arena);
+  {
+    std::vector<int, csv::ArenaAllocator<int> > v(alloc);
+    for(int i = 0; i < 100; i++)
+    {
+      v.push_back(i);
+    }
+    auto copy = v;
+    REQUIRE(copy.get_allocator() == alloc);
+    REQUIRE(copy[99] == 99);
+    REQUIRE(arena.use_count() > 2);
+  }
+  // only held by alloc
+  REQUIRE(arena.use_count() == 2);
+  REQUIRE(csv::ArenaAllocator<int>() != alloc);
+  std::vector<int, csv::ArenaAllocator<int> > heap;
+  heap.push_back(1);
+  REQUIRE(heap.get_allocator() == csv::ArenaAllocator<int>());
+}
+
+TEST_CASE("ReaderWithArenaKeepsRows", "[csv_arena]")
+{
+  std::stringstream input;
+  for(int i = 0; i < 1000; i++)
+  {
+    input << i << ",\"name " << i << "\"," << std::string(i % 50, 'x') << "\n";
+  }
+  std::stringstream ss1(input.str());
+  std::stringstream ss2(input.str());
+  std::vector<csv::Row> expected;
+  std::vector<csv::Row> rows;
+  {
+    csv::Reader plain(ss1);
+    expected.assign(plain.begin(), plain.end());
+    csv::Reader reader(ss2);
+    reader.withArena(64, 4096);
+    rows.assign(reader.begin(), reader.end());
+  }
+  REQUIRE(rows.size() == 1000u);
+  REQUIRE(expected.size() == 1000u);
+  for(std::size_t i = 0; i < rows.size(); i++)
+  {
+    REQUIRE(rows[i].size() == expected[i].size());
+    REQUIRE(rows[i].inputLine() == expected[i].inputLine());
+    for(std::size_t j = 0; j < rows[i].size(); j++)
+    {
+      REQUIRE(rows[i][j].as<std::string>() == expected[i][j].as<std::string>());
+      REQUIRE(rows[i][j].inputColumn() == expected[i][j].inputColumn());
+    }
+  }
+}
+
+TEST_CASE("ArenaContinuesFromPreviousBlock", "[csv_arena]")
+{
+  auto previous = std::make_shared<csv::Arena>(256);
+  char * a = static_cast<char*>(previous->allocate(16, 1));
+  csv::Arena arena(256);
+  arena.continueFrom(*previous);
+  char * b = static_cast<char*>(arena.allocate(16, 1));
+  REQUIRE(b == a + 16);
+  REQUIRE(arena.capacity() == 0u);
+  // the previous arena starts a new block
+  char * c = static_cast<char*>(previous->allocate(16, 1));
+  REQUIRE((c < a || c >= a + 256));
+  REQUIRE(previous->capacity() == 512u);
+  // the shared block outlives the previous arena
+  previous.reset();
+  b[15] = 'x';
+  REQUIRE(b[15] == 'x');
+}
@@ -0,0 +1,320 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/arrow_writer.h>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  template<typename T>
+  T readAt(const std::string & data, std::size_t pos)
+  {
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    return value;
+  }
+
+  void checkFile(const std::string & data)
+  {
+    REQUIRE(data.size() > 24u);
+    REQUIRE(data.compare(0, 8, std::string("ARROW1\0\0", 8)) == 0);
+    REQUIRE(data.compare(data.size() - 6, 6, "ARROW1") == 0);
+    // schema message follows the magic
+    REQUIRE(readAt<std::uint32_t>(data, 8) == 0xFFFFFFFFu);
+    REQUIRE(readAt<std::int32_t>(data, 12) % 8 == 0);
+    // footer is preceded by the end of stream marker
+    const std::int32_t footer = readAt<std::int32_t>(data, data.size() - 10);
+    REQUIRE(footer > 0);
+    const std::size_t footer_pos = data.size() - 10 - footer;
+    REQUIRE(footer_pos % 8 == 0);
+    REQUIRE(readAt<std::uint32_t>(data, footer_pos - 8) == 0xFFFFFFFFu);
+    REQUIRE(readAt<std::uint32_t>(data, footer_pos - 4) == 0u);
+  }
+
+  /**
+   * Read side of a flatbuffers table, independent of the builder in
+   * arrow_writer.h.
+   */
+  struct Table
+  {
+    const std::string & data;
+    std::size_t         pos;
+
+    std::size_t field(std::uint16_t id) const
+    {
+      const std::size_t vtable = pos - readAt<std::int32_t>(data, pos);
+      const std::uint16_t vtable_size = readAt<std::uint16_t>(data, vtable);
+      if(4u + 2u * id >= vtable_size)
+      {
+        return 0;
+      }
+      const std::uint16_t offset = readAt<std::uint16_t>(data, vtable + 4 + 2 * id);
+      return offset ? pos + offset : 0;
+    }
+
+    template<typename T>
+    T scalar(std::uint16_t id, T value = T()) const
+    {
+      const std::size_t at = field(id);
+      return at ? readAt<T>(data, at) : value;
+    }
+
+    /** position of the referenced table, vector or string */
+    std::size_t offset(std::uint16_t id) const
+    {
+      const std::size_t at = field(id);
+      REQUIRE(at != 0u);
+      return at + readAt<std::uint32_t>(data, at);
+    }
+
+    Table table(std::uint16_t id) const
+    {
+      return Table{ data, offset(id) };
+    }
+
+    std::size_t length(std::uint16_t id) const
+    {
+      return readAt<std::uint32_t>(data, offset(id));
+    }
+
+    std::string string(std::uint16_t id) const
+    {
+      const std::size_t at = offset(id);
+      return data.substr(at + 4, readAt<std::uint32_t>(data, at));
+    }
+
+    /** element i of a vector of tables */
+    Table element(std::uint16_t id, std::size_t i) const
+    {
+      const std::size_t at = offset(id) + 4 + 4 * i;
+      return Table{ data, at + readAt<std::uint32_t>(data, at) };
+    }
+
+    /** element i of a vector of structs of the given size */
+    std::size_t structAt(std::uint16_t id, std::size_t i, std::size_t size) const
+    {
+      return offset(id) + 4 + size * i;
+    }
+  };
+
+  Table root(const std::string & data, std::size_t pos)
+  {
+    return Table{ data, pos + readAt<std::uint32_t>(data, pos) };
+  }
+}
+
+TEST_CASE("WriteArrowTypedColumns", "[csv_arrow_writer]")
+{
+  std::stringstream ist("id,price,symbol,active\n"
+                        "1,1.5,ABC,true\n"
+                        "2,,\"D,E\",0\n"
+                        ",3.25,,\n");
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::stringstream ost;
+  csv::ArrowWriter writer(ost, 2);
+  writer.withColumn("id", csv::ArrowType::INT64)
+        .withColumn("price", csv::ArrowType::DOUBLE)
+        .withColumn("symbol", csv::ArrowType::UTF8)
+        .withColumn(3, csv::ArrowType::BOOLEAN);
+  REQUIRE(writer.write(reader) == 3u);
+  REQUIRE(writer.batches() == 2u);
+  const std::string data = ost.str();
+  checkFile(data);
+
+  // Footer { version, schema, dictionaries, recordBatches }
+  const std::int32_t footer_size = readAt<std::int32_t>(data, data.size() - 10);
+  Table footer = root(data, data.size() - 10 - footer_size);
+  REQUIRE(footer.scalar<std::int16_t>(0) == 4);
+  // Schema { endianness, fields }, Field { name, nullable, type_type, type,
+  // dictionary, children }
+  Table schema = footer.table(1);
+  REQUIRE(schema.length(1) == 4u);
+  const char * names[] = { "id", "price", "symbol", "active" };
+  const std::uint8_t types[] = { 2, 3, 5, 6 };
+  for(std::size_t i = 0; i < 4; i++)
+  {
+    Table field = schema.element(1, i);
+    REQUIRE(field.string(0) == names[i]);
+    REQUIRE(field.scalar<std::uint8_t>(1) == 1u);
+    REQUIRE(field.scalar<std::uint8_t>(2) == types[i]);
+    REQUIRE(field.length(5) == 0u);
+  }
+  Table int_type = schema.element(1, 0).table(3);
+  REQUIRE(int_type.scalar<std::int32_t>(0) == 64);
+  REQUIRE(int_type.scalar<std::uint8_t>(1) == 1u);
+  REQUIRE(schema.element(1, 1).table(3).scalar<std::int16_t>(0) == 2);
+
+  // Block { offset, metaDataLength, bodyLength }
+  REQUIRE(footer.length(3) == 2u);
+  const std::int64_t row_counts[] = { 2, 1 };
+  for(std::size_t b = 0; b < 2; b++)
+  {
+    const std::size_t block = footer.structAt(3, b, 24);
+    const std::int64_t offset          = readAt<std::int64_t>(data, block);
+    const std::int32_t metadata_length = readAt<std::int32_t>(data, block + 8);
+    const std::int64_t body_length     = readAt<std::int64_t>(data, block + 16);
+    REQUIRE(offset % 8 == 0);
+    REQUIRE(readAt<std::uint32_t>(data, offset) == 0xFFFFFFFFu);
+    REQUIRE(readAt<std::int32_t>(data, offset + 4) + 8 == metadata_length);
+    // Message { version, header_type, header, bodyLength }
+    Table message = root(data, offset + 8);
+    REQUIRE(message.scalar<std::int16_t>(0) == 4);
+    REQUIRE(message.scalar<std::uint8_t>(1) == 3u);
+    REQUIRE(message.scalar<std::int64_t>(3) == body_length);
+    // RecordBatch { length, nodes, buffers }
+    Table batch = message.table(2);
+    REQUIRE(batch.scalar<std::int64_t>(0) == row_counts[b]);
+    REQUIRE(batch.length(1) == 4u);
+    for(std::size_t i = 0; i < 4; i++)
+    {
+      REQUIRE(readAt<std::int64_t>(data, batch.structAt(1, i, 16)) == row_counts[b]);
+    }
+    // validity and values, plus offsets for the utf8 column
+    REQUIRE(batch.length(2) == 9u);
+    std::vector<std::pair<std::int64_t, std::int64_t> > buffers;
+    for(std::size_t i = 0; i < 9; i++)
+    {
+      const std::size_t at = batch.structAt(2, i, 16);
+      buffers.push_back(std::make_pair(readAt<std::int64_t>(data, at),
+                                       readAt<std::int64_t>(data, at + 8)));
+      REQUIRE(buffers.back().first % 8 == 0);
+      REQUIRE(buffers.back().first + buffers.back().second <= body_length);
+    }
+    const std::size_t body = offset + metadata_length;
+    auto buffer = [&](std::size_t i) { return body + buffers[i].first; };
+    if(b == 0)
+    {
+      // id: 1, 2
+      REQUIRE(readAt<std::uint8_t>(data, buffer(0)) == 3u);
+      REQUIRE(readAt<std::int64_t>(data, buffer(1)) == 1);
+      REQUIRE(readAt<std::int64_t>(data, buffer(1) + 8) == 2);
+      // price: 1.5, null
+      REQUIRE(readAt<std::uint8_t>(data, buffer(2)) == 1u);
+      REQUIRE(readAt<double>(data, buffer(3)) == 1.5);
+      REQUIRE(readAt<std::int64_t>(data, batch.structAt(1, 1, 16) + 8) == 1);
+      // symbol: "ABC", "D,E"
+      REQUIRE(readAt<std::int32_t>(data, buffer(5) + 8) == 6);
+      REQUIRE(data.substr(buffer(6), 6) == "ABCD,E");
+      // active: true, false
+      REQUIRE(readAt<std::uint8_t>(data, buffer(8)) == 1u);
+    }
+    else
+    {
+      // id is null, price 3.25
+      REQUIRE(readAt<std::uint8_t>(data, buffer(0)) == 0u);
+      REQUIRE(readAt<double>(data, buffer(3)) == 3.25);
+    }
+  }
+}
+
+TEST_CASE("WriteArrowDefaultsToUtf8", "[csv_arrow_writer]")
+{
+  std::wstringstream ist(L"Käse,3\n");
+  csv::WReader reader(ist);
+  std::stringstream ost;
+  csv::WArrowWriter writer(ost);
+  REQUIRE(writer.write(reader) == 1u);
+  REQUIRE(writer.batches() == 1u);
+  const std::string data = ost.str();
+  checkFile(data);
+  REQUIRE(data.find("K\xc3\xa4se") != std::string::npos);
+}
+
+TEST_CASE("WriteArrowEmptyInput", "[csv_arrow_writer]")
+{
+  std::stringstream ist("id\n");
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::stringstream ost;
+  csv::ArrowWriter writer(ost);
+  writer.withColumn("id", csv::ArrowType::INT64);
+  REQUIRE(writer.write(reader) == 0u);
+  REQUIRE(writer.batches() == 0u);
+  checkFile(ost.str());
+}
+
+TEST_CASE("WriteArrowConversionError", "[csv_arrow_writer]")
+{
+  std::stringstream ist("id,flag\n1,true\n2,maybe\n");
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::stringstream ost;
+  csv::ArrowWriter writer(ost);
+  writer.withColumn("id", csv::ArrowType::INT64)
+        .withColumn("flag", csv::ArrowType::BOOLEAN);
+  bool caught = false;
+  try
+  {
+    writer.write(reader);
+  }
+  catch(const csv::ConversionError & ex)
+  {
+    REQUIRE(ex.typeIndex() == std::type_index(typeid(bool)));
+    REQUIRE(ex.row() == 2u);
+    REQUIRE(ex.column() == 1u);
+    caught = true;
+  }
+  REQUIRE(caught);
+  {
+    // a reused writer writes the same file as a fresh one
+    const char * csv = "id,flag\n3,false\n4,\n";
+    std::stringstream ist_reused(csv);
+    csv::Reader reader_reused(ist_reused, csv::Specification().withHeader());
+    std::stringstream ost_reused;
+    csv::ArrowWriter reused(ost_reused);
+    reused.withColumn("id", csv::ArrowType::INT64)
+          .withColumn("flag", csv::ArrowType::BOOLEAN);
+    std::stringstream ist_bad("id,flag\n1,true\n2,maybe\n");
+    csv::Reader reader_bad(ist_bad, csv::Specification().withHeader());
+    REQUIRE_THROWS_AS(reused.write(reader_bad), csv::ConversionError);
+    ost_reused.str("");
+    REQUIRE(reused.write(reader_reused) == 2u);
+
+    std::stringstream ist_fresh(csv);
+    csv::Reader reader_fresh(ist_fresh, csv::Specification().withHeader());
+    std::stringstream ost_fresh;
+    csv::ArrowWriter fresh(ost_fresh);
+    fresh.withColumn("id", csv::ArrowType::INT64)
+         .withColumn("flag", csv::ArrowType::BOOLEAN);
+    REQUIRE(fresh.write(reader_fresh) == 2u);
+    REQUIRE(ost_reused.str() == ost_fresh.str());
+    checkFile(ost_reused.str());
+  }
+  std::stringstream ist2("id\n1\n");
+  csv::Reader reader2(ist2, csv::Specification().withHeader());
+  csv::ArrowWriter writer2(ost);
+  writer2.withColumn("missing", csv::ArrowType::INT64);
+  REQUIRE_THROWS_AS(writer2.write(reader2), csv::UndefinedColumnError);
+}
@@ -113,6 +113,25 @@ TEST_CASE("ConvertFromStringWithLocale", "[csv_cell]")
                      csv::ConversionError);
 }
 
+TEST_CASE("TryConvertFromString", "[csv_cell]")
+{
+  int i = 0;
+  double d = 0;
+  std::string s;
+  REQUIRE(cell_t("123   ").tryAs(i));
+  REQUIRE(i == 123);
+  REQUIRE(cell_t("  12.3  ").tryAs(d));
+  REQUIRE(d == 12.3);
+  REQUIRE(cell_t(" abc ").tryAs(s));
+  REQUIRE(s == " abc ");
+  REQUIRE_FALSE(cell_t("").tryAs(i));
+  REQUIRE_FALSE(cell_t("N/A").tryAs(i));
+  REQUIRE_FALSE(cell_t("12ff").tryAs(i));
+  REQUIRE_FALSE(cell_t("N/A").tryAs(d));
+  auto error = cell_t("N/A").conversionError<int>();
+  REQUIRE(error.typeIndex() == std::type_index(typeid(int)));
+}
+
 
 TEST_CASE("ConvertFromWString", "[csv_cell]")
 {
@@ -0,0 +1,307 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/columnar_cache.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const char * source_path = "test_columnar_cache.csv";
+  const char * cache_path  = "test_columnar_cache.csv.cache";
+
+  void writeSource(const std::string & content)
+  {
+    std::ofstream ost(source_path, std::ios::out | std::ios::binary);
+    ost << content;
+  }
+
+  template<typename T>
+  void requireSameConversion(const csv::ColumnarCache & cache, 
+                             const csv::Row & row,
+                             std::size_t i,
+                             std::size_t column)
+  {
+    INFO("row " << i << " column " << column << " type " << typeid(T).name());
+    T cached   = T();
+    T expected = T();
+    bool ok = cache.tryAs(i, column, cached);
+    REQUIRE(ok == row[column].tryAs(expected));
+    if(ok)
+    {
+      REQUIRE(cached == expected);
+    }
+  }
+
+  void overwrite(std::uint64_t pos, std::uint64_t value)
+  {
+    std::fstream file(cache_path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(pos);
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  std::uint64_t readAt(std::uint64_t pos)
+  {
+    std::uint64_t value = 0;
+    std::ifstream file(cache_path, std::ios::in | std::ios::binary);
+    file.seekg(pos);
+    file.read(reinterpret_cast<char *>(&value), sizeof(value));
+    return value;
+  }
+}
+
+TEST_CASE("ColumnarCacheTypesAndValues", "[csv_columnar_cache]")
+{
+  writeSource("id,name,price,code\n"
+              "1,apple,1.5,007\n"
+              "2,\"b,anana\",-2,8\n"
+              "3,apple,,9\n"
+              "-4\n");
+  std::remove(cache_path);
+  csv::ColumnarCache cache;
+  cache.open(source_path, cache_path, csv::Specification().withHeader(), 2);
+  REQUIRE(cache.rebuilt());
+  REQUIRE(cache.size() == 4u);
+  REQUIRE(cache.numColumns() == 4u);
+  REQUIRE(cache.columnName(1) == "name");
+  REQUIRE(cache.columnIndex("price") == 2u);
+  REQUIRE(cache.columnIndex("xxx") == csv::Specification::npos);
+  REQUIRE(cache.type(0) == csv::ColumnType::INT64);
+  REQUIRE(cache.type(1) == csv::ColumnType::STRING);
+  REQUIRE(cache.type(2) == csv::ColumnType::DOUBLE);
+  // leading zeros would be lost as a number
+  REQUIRE(cache.type(3) == csv::ColumnType::STRING);
+
+  REQUIRE(cache.row(0)["id"].as<int>() == 1);
+  REQUIRE(cache.row(0)["id"].as<double>() == 1.0);
+  REQUIRE(cache.row(0)["id"].as<std::string>() == "1");
+  REQUIRE(cache.row(1)["name"].as<std::string>() == "b,anana");
+  REQUIRE(cache.row(1)["price"].as<double>() == -2.0);
+  REQUIRE(cache.row(1)["price"].as<std::string>() == "-2");
+  REQUIRE(cache.row(0)["price"].as<std::string>() == "1.5");
+  REQUIRE(cache.row(0)["code"].as<std::string>() == "007");
+  REQUIRE(cache.row(0)["code"].as<int>() == 7);
+  REQUIRE(cache.row(2)["price"].isNull());
+  REQUIRE(cache.row(2)["price"].as<std::string>() == "");
+  REQUIRE_THROWS_AS(cache.row(2)["price"].as<double>(), csv::ConversionError);
+  REQUIRE_THROWS_AS(cache.row(0)["price"].as<int>(), csv::ConversionError);
+  double value = 0;
+  REQUIRE_FALSE(cache.row(1)["name"].tryAs(value));
+  REQUIRE(cache.row(3).size() == 1u);
+  REQUIRE(cache.row(3)[0].as<long>() == -4);
+  REQUIRE_THROWS_AS(cache.row(3)[1], csv::CellOutOfRangeError);
+  REQUIRE_THROWS_AS(cache.row(3)["name"], csv::DefinedCellOutOfRangeError);
+  REQUIRE_THROWS_AS(cache.row(0)["xxx"], csv::UndefinedColumnError);
+  const char * begin;
+  const char * end;
+  cache.cellData(2, 1, begin, end);
+  REQUIRE(std::string(begin, end) == "apple");
+}
+
+TEST_CASE("ColumnarCacheIsRebuiltWhenStale", "[csv_columnar_cache]")
+{
+  writeSource("a,b\n1,x\n");
+  std::remove(cache_path);
+  {
+    csv::ColumnarCache cache;
+    cache.open(source_path, cache_path);
+    REQUIRE(cache.rebuilt());
+    REQUIRE(cache.size() == 2u);
+  }
+  {
+    csv::ColumnarCache cache;
+    cache.open(source_path, cache_path);
+    REQUIRE_FALSE(cache.rebuilt());
+    REQUIRE(cache.row(1)[1].as<std::string>() == "x");
+  }
+  {
+    // other specification
+    csv::ColumnarCache cache;
+    cache.open(source_path, cache_path, csv::Specification().withHeader());
+    REQUIRE(cache.rebuilt());
+    REQUIRE(cache.size() == 1u);
+  }
+  writeSource("a,b\n1,x\n2,y\n");
+  {
+    csv::ColumnarCache cache;
+    cache.open(source_path, cache_path, csv::Specification().withHeader());
+    REQUIRE(cache.rebuilt());
+    REQUIRE(cache.size() == 2u);
+    REQUIRE(cache.row(1)["b"].as<std::string>() == "y");
+  }
+  std::remove(source_path);
+  std::remove(cache_path);
+}
+
+TEST_CASE("ColumnarCacheIntegersThatAreNoDoubles", "[csv_columnar_cache]")
+{
+  // 12345678901234567 is not exact as a double
+  writeSource("12345678901234567\n1000000\n1.5\n");
+  std::remove(cache_path);
+  std::stringstream ss("12345678901234567\n1000000\n1.5\n");
+  csv::Reader reader(ss);
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  csv::ColumnarCache cache;
+  cache.open(source_path, cache_path);
+  REQUIRE(cache.type(0) == csv::ColumnType::STRING);
+  REQUIRE(cache.row(0)[0].as<std::string>() == "12345678901234567");
+  REQUIRE(cache.row(0)[0].as<long long>() == rows[0][0].as<long long>());
+  REQUIRE(cache.row(2)[0].as<std::string>() == "1.5");
+  std::remove(source_path);
+  std::remove(cache_path);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("ColumnarCacheIsRebuiltWithinTheSameSecond", "[csv_columnar_cache]")
+{
+  // same size and second, only the nanoseconds differ
+  struct timespec times[2];
+  times[0].tv_sec  = times[1].tv_sec  = 1000000000;
+  times[0].tv_nsec = times[1].tv_nsec = 100;
+  writeSource("a\n1\n");
+  REQUIRE(::utimensat(AT_FDCWD, source_path, times, 0) == 0);
+  std::remove(cache_path);
+  {
+    csv::ColumnarCache cache;
+    cache.open(source_path, cache_path);
+    REQUIRE(cache.rebuilt());
+  }
+  writeSource("a\n2\n");
+  times[0].tv_nsec = times[1].tv_nsec = 200;
+  REQUIRE(::utimensat(AT_FDCWD, source_path, times, 0) == 0);
+  {
+    csv::ColumnarCache cache;
+    cache.open(source_path, cache_path);
+    REQUIRE(cache.rebuilt());
+    REQUIRE(cache.row(1)[0].as<std::string>() == "2");
+  }
+  std::remove(source_path);
+  std::remove(cache_path);
+}
+#endif
+
+TEST_CASE("ColumnarCacheManyRowGroups", "[csv_columnar_cache]")
+{
+  std::string content("n,x,s\n");
+  for(int i = 0; i < 1000; i++)
+  {
+    content+= std::to_string(i) + "," + (i % 3 ? std::to_string(i * 0.25) : "") + 
+      ",s" + std::to_string(i % 7) + "\n";
+  }
+  writeSource(content);
+  std::remove(cache_path);
+  csv::ColumnarCache cache;
+  cache.open(source_path, cache_path, csv::Specification().withHeader(), 64);
+  REQUIRE(cache.size() == 1000u);
+  for(std::size_t i = 0; i < cache.size(); i++)
+  {
+    auto row = cache.row(i);
+    REQUIRE(row["n"].as<std::size_t>() == i);
+    REQUIRE(row["x"].isNull() == (i % 3 == 0));
+    REQUIRE(row["s"].as<std::string>() == "s" + std::to_string(i % 7));
+  }
+  std::remove(source_path);
+  std::remove(cache_path);
+}
+
+TEST_CASE("ColumnarCacheConvertsLikeTheReader", "[csv_columnar_cache]")
+{
+  const std::string content("i,x\n0,0.1\n1,2.5\n5,-0.3\n-1,1e+300\n300,3\n"
+                            "9007199254740993,0.3333333333333333\n");
+  writeSource(content);
+  std::remove(cache_path);
+  csv::ColumnarCache cache;
+  cache.open(source_path, cache_path, csv::Specification().withHeader());
+  REQUIRE(cache.type(0) == csv::ColumnType::INT64);
+  REQUIRE(cache.type(1) == csv::ColumnType::DOUBLE);
+  std::stringstream ist(content);
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == cache.size());
+  for(std::size_t i = 0; i < rows.size(); i++)
+  {
+    for(std::size_t c = 0; c < 2; c++)
+    {
+      requireSameConversion<char>(cache, rows[i], i, c);
+      requireSameConversion<unsigned char>(cache, rows[i], i, c);
+      requireSameConversion<bool>(cache, rows[i], i, c);
+      requireSameConversion<short>(cache, rows[i], i, c);
+      requireSameConversion<unsigned>(cache, rows[i], i, c);
+      requireSameConversion<std::int64_t>(cache, rows[i], i, c);
+      requireSameConversion<float>(cache, rows[i], i, c);
+      requireSameConversion<double>(cache, rows[i], i, c);
+      requireSameConversion<long double>(cache, rows[i], i, c);
+    }
+  }
+  std::remove(source_path);
+  std::remove(cache_path);
+}
+
+TEST_CASE("ColumnarCacheRebuildsCorruptFile", "[csv_columnar_cache]")
+{
+  writeSource("id,name\n1,a\n2,b\n3,c\n");
+  std::remove(cache_path);
+  csv::ColumnarCache cache;
+  cache.open(source_path, cache_path, csv::Specification().withHeader(), 2);
+  REQUIRE(cache.rebuilt());
+  // FileHeader: magic, 9 counters, directory at byte 80
+  const std::uint64_t directory = readAt(80);
+  // first column entry: type, name, name_length, dictionary_size, 
+  // dictionary_offsets at byte 32
+  const std::uint64_t positions[] = {
+    80, 
+    directory + 32 + 48,
+    // first chunk of the first row group, after the row sizes
+    directory + 2 * 48 + 8 
+  };
+  for(auto pos : positions)
+  {
+    overwrite(pos, std::uint64_t(1) << 40);
+    csv::ColumnarCache corrupt;
+    corrupt.open(source_path, cache_path, csv::Specification().withHeader(), 2);
+    REQUIRE(corrupt.rebuilt());
+    REQUIRE(corrupt.row(2)["name"].as<std::string>() == "c");
+  }
+  std::remove(source_path);
+  std::remove(cache_path);
+}
+
+TEST_CASE("ColumnarCacheMissingSourceThrows", "[csv_columnar_cache]")
+{
+  csv::ColumnarCache cache;
+  REQUIRE_THROWS_AS(cache.open("does_not_exist.csv", cache_path), csv::CacheError);
+}
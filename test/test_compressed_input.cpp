@@ -0,0 +1,162 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/reader.h>
+#include <csv/compressed_input.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <zlib.h>
+
+static std::string gzipCompress(const std::string & input)
+{
+  z_stream zs;
+  std::memset(&zs, 0, sizeof(zs));
+  deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+               Z_DEFAULT_STRATEGY);
+  std::vector<char> out(deflateBound(&zs, input.size()) + 32);
+  zs.next_in   = (Bytef*)input.data();
+  zs.avail_in  = input.size();
+  zs.next_out  = (Bytef*)out.data();
+  zs.avail_out = out.size();
+  deflate(&zs, Z_FINISH);
+  std::string ret(out.data(), out.size() - zs.avail_out);
+  deflateEnd(&zs);
+  return ret;
+}
+
+static std::string readAll(std::istream & ist)
+{
+  std::string ret;
+  char ch;
+  while(ist.get(ch))
+  {
+    ret.push_back(ch);
+  }
+  return ret;
+}
+
+TEST_CASE("ReadGzipCompressedCsv", "[csv_compressed_input]")
+{
+  std::stringstream ss(gzipCompress("a,b,c\n1,\"x\ny\",3\n4,5,6\n"));
+  csv::CompressedInputStream ist(ss, csv::Compression::AUTO, 4);
+  REQUIRE(ist.compression() == csv::Compression::GZIP);
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 2u);
+  REQUIRE(rows[0]["a"].as<int>() == 1);
+  REQUIRE(rows[0]["b"].as<std::string>() == "x\ny");
+  REQUIRE(rows[1]["c"].as<int>() == 6);
+}
+
+TEST_CASE("ReadLargeGzipCompressedInputAcrossBlocks", "[csv_compressed_input]")
+{
+  std::string plain;
+  for(int i = 0; i < 20000; i++)
+  {
+    plain+= std::to_string(i) + "," + std::to_string(i * 2) + "\n";
+  }
+  std::stringstream ss(gzipCompress(plain));
+  csv::CompressedInputStream ist(ss, csv::Compression::GZIP, 1000);
+  csv::Reader reader(ist);
+  int i = 0;
+  for(auto row : reader)
+  {
+    REQUIRE(row[0].as<int>() == i);
+    REQUIRE(row[1].as<int>() == i * 2);
+    i++;
+  }
+  REQUIRE(i == 20000);
+}
+
+TEST_CASE("ReadConcatenatedGzipMembers", "[csv_compressed_input]")
+{
+  std::stringstream ss(gzipCompress("1,2\n") + gzipCompress("3,4\n"));
+  csv::CompressedInputStream ist(ss);
+  REQUIRE(readAll(ist) == "1,2\n3,4\n");
+}
+
+TEST_CASE("ReadUncompressedInputWithAutoDetection", "[csv_compressed_input]")
+{
+  std::stringstream ss("1,2\n3,4\n");
+  csv::CompressedInputStream ist(ss);
+  REQUIRE(ist.compression() == csv::Compression::NONE);
+  REQUIRE(readAll(ist) == "1,2\n3,4\n");
+}
+
+TEST_CASE("ReadEmptyCompressedInput", "[csv_compressed_input]")
+{
+  std::stringstream empty;
+  csv::CompressedInputStream ist1(empty);
+  REQUIRE(readAll(ist1) == "");
+
+  std::stringstream ss(gzipCompress(""));
+  csv::CompressedInputStream ist2(ss);
+  csv::Reader reader(ist2);
+  REQUIRE(reader.begin() == reader.end());
+}
+
+TEST_CASE("ReadTruncatedGzipInputThrows", "[csv_compressed_input]")
+{
+  std::string data = gzipCompress("a,b,c\n1,2,3\n");
+  std::stringstream ss(data.substr(0, data.size() - 6));
+  csv::CompressedInputStream ist(ss);
+  REQUIRE_THROWS_AS(readAll(ist), csv::DecompressionError);
+}
+
+TEST_CASE("ReadBlocksPrecedingADecompressionError", "[csv_compressed_input]")
+{
+  std::string plain;
+  for(int i = 0; i < 2000; i++)
+  {
+    plain+= std::to_string(i) + "\n";
+  }
+  std::string data = gzipCompress(plain);
+  std::stringstream ss(data.substr(0, data.size() - 6));
+  std::size_t block_size = plain.size() / 2 + 100;
+  // the source is complete before the reader starts, the first block
+  // is delivered whether or not the second one has already failed
+  csv::CompressedInputStream ist(ss, csv::Compression::GZIP, block_size);
+  std::string received;
+  char ch;
+  REQUIRE_THROWS_AS([&]{ while(ist.get(ch)) received.push_back(ch); }(),
+                    csv::DecompressionError);
+  REQUIRE(received.size() >= block_size);
+  REQUIRE(plain.compare(0, received.size(), received) == 0);
+}
+
+TEST_CASE("OpenMissingCompressedFileThrows", "[csv_compressed_input]")
+{
+  REQUIRE_THROWS_AS(csv::CompressedInputStream("/nonexistent/file.csv.gz"),
+                    csv::DecompressionError);
+}
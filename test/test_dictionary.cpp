@@ -0,0 +1,124 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/dictionary.h>
+#include <csv/reader.h>
+#include <csv/typed_reader.h>
+#include <sstream>
+#include <vector>
+
+TEST_CASE("DictionaryInternsValuesOnce", "[csv_dictionary]")
+{
+  csv::Dictionary dictionary(8);
+  std::string a("EUR");
+  std::string b("USD");
+  std::string c("a value longer than one chunk");
+  REQUIRE(dictionary.intern(a.data(), a.data() + a.size()) == 0u);
+  REQUIRE(dictionary.intern(b.data(), b.data() + b.size()) == 1u);
+  REQUIRE(dictionary.intern(a.data(), a.data() + a.size()) == 0u);
+  REQUIRE(dictionary.intern(c.data(), c.data() + c.size()) == 2u);
+  REQUIRE(dictionary.intern(b.data(), b.data()) == 3u);
+  REQUIRE(dictionary.size() == 4u);
+  REQUIRE(dictionary.value(0) == "EUR");
+  REQUIRE(dictionary.value(1) == "USD");
+  REQUIRE(dictionary.value(2) == c);
+  REQUIRE(dictionary.value(3) == "");
+  REQUIRE(dictionary.code("USD") == 1u);
+  REQUIRE(dictionary.code("CHF") == csv::Dictionary::npos);
+  REQUIRE(dictionary.code(b.data(), b.data() + b.size()) == 1u);
+  const char * eur = dictionary.data(0);
+  for(int i = 0; i < 1000; i++)
+  {
+    std::string value = std::to_string(i);
+    REQUIRE(dictionary.intern(value.data(), value.data() + value.size()) == 
+            std::size_t(i) + 4u);
+  }
+  // values are never moved
+  REQUIRE(dictionary.data(0) == eur);
+  REQUIRE(dictionary.value(999 + 4) == "999");
+}
+
+TEST_CASE("ReaderEncodesDictionaryColumns", "[csv_dictionary]")
+{
+  std::stringstream ss("id,currency,status\n"
+                       "1,EUR,open\n"
+                       "2, USD ,closed\n"
+                       "3,EUR,\n"
+                       "4,\"USD\",open\n");
+  std::vector<csv::Row> rows;
+  std::shared_ptr<const csv::Dictionary> currencies;
+  {
+    csv::Reader reader(ss, csv::Specification()
+                       .withHeader()
+                       .withDictionary("currency")
+                       .withDictionary(2));
+    rows.assign(reader.begin(), reader.end());
+    currencies = reader.specification().dictionary("currency");
+    REQUIRE(reader.specification().dictionary("id") == nullptr);
+    REQUIRE(reader.specification().dictionary(2)->size() == 3u);
+  }
+  REQUIRE(rows.size() == 4u);
+  REQUIRE(currencies->size() == 2u);
+  REQUIRE_FALSE(rows[0][0].isEncoded());
+  REQUIRE(rows[0][1].isEncoded());
+  REQUIRE(rows[0][1].code() == 0u);
+  REQUIRE(rows[1][1].code() == 1u);
+  REQUIRE(rows[2][1].code() == 0u);
+  REQUIRE(rows[3][1].code() == 1u);
+  REQUIRE(rows[1][1].as<std::string>() == "USD");
+  REQUIRE(rows[3]["currency"].as<std::string>() == "USD");
+  REQUIRE(rows[2]["status"].as<std::string>() == "");
+  REQUIRE(rows[3]["status"].code() == rows[0]["status"].code());
+  REQUIRE(rows[1][2].inputColumn() == 8u);
+  REQUIRE(rows[3][0].as<int>() == 4);
+}
+
+TEST_CASE("TypedReaderWithDictionaryColumns", "[csv_dictionary]")
+{
+  std::stringstream ss("1,EUR\n2,USD\n3,EUR\n");
+  csv::TypedReader<int, std::string> reader(ss, csv::Specification().withDictionary(1));
+  std::vector<std::tuple<int, std::string> > rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 3u);
+  REQUIRE(std::get<1>(rows[0]) == "EUR");
+  REQUIRE(std::get<1>(rows[1]) == "USD");
+  REQUIRE(std::get<1>(rows[2]) == "EUR");
+  REQUIRE(reader.specification().dictionary(1)->size() == 2u);
+}
+
+TEST_CASE("DictionaryMemoryUsage", "[csv_dictionary]")
+{
+  csv::Dictionary dictionary(16);
+  std::size_t empty = dictionary.memoryUsage();
+  std::string value(100, 'x');
+  dictionary.intern(value.data(), value.data() + value.size());
+  REQUIRE(dictionary.memoryUsage() >= empty + 100);
+}
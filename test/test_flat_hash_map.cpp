@@ -0,0 +1,64 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/flat_hash_map.h>
+#include <string>
+
+TEST_CASE("FlatHashMapInsertAndFind", "[csv_flat_hash_map]")
+{
+  csv::FlatHashMap<std::string, int> map;
+  REQUIRE(map.find("a") == map.end());
+  auto res = map.insert(std::make_pair(std::string("a"), 1));
+  REQUIRE(res.second);
+  REQUIRE(res.first->second == 1);
+  res = map.insert(std::make_pair(std::string("a"), 2));
+  REQUIRE_FALSE(res.second);
+  REQUIRE(res.first->second == 1);
+  for(int i = 0; i < 1000; i++)
+  {
+    map[std::to_string(i)] = i;
+  }
+  REQUIRE(map.size() == 1001u);
+  for(int i = 0; i < 1000; i++)
+  {
+    auto itr = map.find(std::to_string(i));
+    REQUIRE(itr != map.end());
+    REQUIRE(itr->second == i);
+  }
+  REQUIRE(map.find("1000") == map.end());
+  // insertion order
+  REQUIRE(map.begin()->first == "a");
+  REQUIRE((map.begin() + 1)->first == "0");
+  map.clear();
+  REQUIRE(map.empty());
+  REQUIRE(map.find("a") == map.end());
+}
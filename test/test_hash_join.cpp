@@ -0,0 +1,156 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/hash_join.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const char * customers = 
+    "id,name,segment\n"
+    "1,Alice,retail\n"
+    "2,\"Bob, Jr.\",corporate\n"
+    "3,Carol,retail\n"
+    "2,Bob,private\n";
+
+  const char * orders = 
+    "order,customer_id,amount\n"
+    "100,2,10.5\n"
+    "101,4,3\n"
+    "102,1,7\n";
+}
+
+TEST_CASE("InnerHashJoin", "[csv_hash_join]")
+{
+  std::stringstream build_input(customers);
+  std::stringstream probe_input(orders);
+  csv::Reader build(build_input, csv::Specification().withHeader());
+  csv::Reader probe(probe_input, csv::Specification().withHeader());
+  csv::HashJoin join;
+  join.withKey("id", "customer_id").withColumn("name");
+  join.build(build);
+  REQUIRE(join.size() == 4u);
+  REQUIRE(join.numProjectedColumns() == 1u);
+  std::vector<std::vector<std::string> > rows;
+  REQUIRE(join.probe(probe, [&rows](const csv::HashJoin::JoinedRow & row)
+  {
+    REQUIRE(row.matched());
+    rows.push_back(std::vector<std::string>());
+    for(std::size_t i = 0; i < row.size(); i++)
+    {
+      rows.back().push_back(row[i]);
+    }
+  }) == 3u);
+  REQUIRE(rows.size() == 3u);
+  REQUIRE(rows[0] == std::vector<std::string>({"100", "2", "10.5", "Bob, Jr."}));
+  REQUIRE(rows[1] == std::vector<std::string>({"100", "2", "10.5", "Bob"}));
+  REQUIRE(rows[2] == std::vector<std::string>({"102", "1", "7", "Alice"}));
+}
+
+TEST_CASE("LeftHashJoinToWriter", "[csv_hash_join]")
+{
+  std::stringstream build_input(customers);
+  std::stringstream probe_input(orders);
+  std::stringstream output;
+  csv::Reader build(build_input, csv::Specification().withHeader());
+  csv::Reader probe(probe_input, csv::Specification().withHeader());
+  csv::HashJoin join;
+  join.withKey(0, 1).withLeftJoin();
+  REQUIRE(join.isLeftJoin());
+  join.build(build);
+  REQUIRE(join.numProjectedColumns() == 2u);
+  REQUIRE(join.memoryUsage() > 0u);
+  {
+    csv::Writer writer(output);
+    REQUIRE(join.probe(probe, writer) == 4u);
+  }
+  REQUIRE(output.str() == 
+          "order,customer_id,amount,name,segment\n"
+          "100,2,10.5,\"Bob, Jr.\",corporate\n"
+          "100,2,10.5,Bob,private\n"
+          "101,4,3,,\n"
+          "102,1,7,Alice,retail\n");
+}
+
+TEST_CASE("HashJoinOnCompositeKey", "[csv_hash_join]")
+{
+  std::stringstream build_input("ab,c,x\na,bc,y\n");
+  std::stringstream probe_input("a,bc\nab,c\nabc,\n");
+  csv::Reader build(build_input);
+  csv::Reader probe(probe_input);
+  csv::HashJoin join;
+  join.withKey(0, 0).withKey(1, 1).withColumn(2);
+  join.build(build);
+  std::vector<std::string> values;
+  join.probe(probe, [&values](const csv::HashJoin::JoinedRow & row)
+  {
+    values.push_back(row[2]);
+  });
+  REQUIRE(values == std::vector<std::string>({"y", "x"}));
+}
+
+TEST_CASE("HashJoinPadsShortProbeRows", "[csv_hash_join]")
+{
+  std::stringstream build_input("id,name\n1,Alice\n,Nobody\n");
+  std::stringstream probe_input("customer_id,order,amount\n"
+                                "1,100\n"
+                                "1\n"
+                                ",102,5\n");
+  std::stringstream output;
+  csv::Reader build(build_input, csv::Specification().withHeader());
+  csv::Reader probe(probe_input, csv::Specification().withHeader());
+  csv::HashJoin join;
+  join.withKey("id", "customer_id").withLeftJoin();
+  join.build(build);
+  // the row with an empty key is not loaded
+  REQUIRE(join.size() == 1u);
+  {
+    csv::Writer writer(output);
+    REQUIRE(join.probe(probe, writer) == 3u);
+  }
+  REQUIRE(output.str() == 
+          "customer_id,order,amount,name\n"
+          "1,100,,Alice\n"
+          "1,,,Alice\n"
+          ",102,5,\n");
+}
+
+TEST_CASE("HashJoinUndefinedColumnThrows", "[csv_hash_join]")
+{
+  std::stringstream build_input(customers);
+  csv::Reader build(build_input, csv::Specification().withHeader());
+  csv::HashJoin join;
+  join.withKey("customer", "customer_id");
+  REQUIRE_THROWS_AS(join.build(build), csv::UndefinedColumnError);
+}
@@ -0,0 +1,163 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/jsonl_writer.h>
+#include <sstream>
+#include <string>
+
+TEST_CASE("EscapeJson", "[csv_jsonl_writer]")
+{
+  std::string in("plain text which is longer than sixteen bytes \"quoted\" "
+                 "back\\slash\ttab\nnewline\x01\x1f caf\xc3\xa9");
+  std::string out;
+  csv::detail::escapeJson(in.data(), in.data() + in.size(), out);
+  REQUIRE(out == "plain text which is longer than sixteen bytes \\\"quoted\\\" "
+                 "back\\\\slash\\ttab\\nnewline\\u0001\\u001f caf\xc3\xa9");
+  REQUIRE(csv::detail::isJsonNumber("-0.5e+10", "-0.5e+10" + 8));
+  REQUIRE(csv::detail::isJsonNumber("120", "120" + 3));
+  REQUIRE_FALSE(csv::detail::isJsonNumber("012", "012" + 3));
+  REQUIRE_FALSE(csv::detail::isJsonNumber("1.", "1." + 2));
+  REQUIRE_FALSE(csv::detail::isJsonNumber("+1", "+1" + 2));
+  REQUIRE_FALSE(csv::detail::isJsonNumber("", "" + 0));
+}
+
+TEST_CASE("WriteJsonLines", "[csv_jsonl_writer]")
+{
+  std::stringstream ist("symbol,price,\"say \"\"hi\"\"\"\n"
+                        "ABC,1.5,\"a\nb\"\n"
+                        "DEF,,x\n"
+                        "GHI,+2.50,y,extra\n");
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::stringstream ost;
+  csv::JsonlWriter writer(ost);
+  writer.withNumber("price");
+  REQUIRE(writer.write(reader) == 3u);
+  REQUIRE(ost.str() == 
+          "{\"symbol\":\"ABC\",\"price\":1.5,\"say \\\"hi\\\"\":\"a\\nb\"}\n"
+          "{\"symbol\":\"DEF\",\"price\":null,\"say \\\"hi\\\"\":\"x\"}\n"
+          "{\"symbol\":\"GHI\",\"price\":2.5,\"say \\\"hi\\\"\":\"y\",\"3\":\"extra\"}\n");
+}
+
+TEST_CASE("WriteJsonLinesWide", "[csv_jsonl_writer]")
+{
+  std::wstringstream ist(L"0,Käse\n");
+  csv::WReader reader(ist);
+  std::stringstream ost;
+  csv::WJsonlWriter writer(ost);
+  writer.withNumber(0);
+  REQUIRE(writer.write(reader) == 1u);
+  REQUIRE(ost.str() == "{\"0\":0,\"1\":\"K\xc3\xa4se\"}\n");
+}
+
+TEST_CASE("WriteJsonLinesParallel", "[csv_jsonl_writer]")
+{
+  std::string csv("id,name\n");
+  for(int i = 0; i < 1000; i++)
+  {
+    csv+= std::to_string(i) + ",\"n\"\"" + std::to_string(i) + "\"\n";
+  }
+  std::stringstream ist1(csv);
+  csv::Reader reader1(ist1, csv::Specification().withHeader());
+  std::stringstream ost1;
+  csv::JsonlWriter writer1(ost1);
+  writer1.withNumber("id");
+  REQUIRE(writer1.write(reader1) == 1000u);
+
+  std::stringstream ist2(csv);
+  csv::Reader reader2(ist2, csv::Specification().withHeader());
+  std::stringstream ost2;
+  csv::JsonlWriter writer2(ost2, 256);
+  writer2.withNumber("id");
+  REQUIRE(writer2.write(reader2, 4, 7) == 1000u);
+  REQUIRE(ost1.str() == ost2.str());
+}
+
+TEST_CASE("WriteJsonLinesKeepsRowsBeforeConversionError", "[csv_jsonl_writer]")
+{
+  const char * csv = "a,b\n1,x\n2,y\nz,w\n";
+  const char * expected = "{\"a\":1,\"b\":\"x\"}\n{\"a\":2,\"b\":\"y\"}\n";
+  for(int parallel = 0; parallel < 2; parallel++)
+  {
+    INFO("parallel " << parallel);
+    std::stringstream ist(csv);
+    csv::Reader reader(ist, csv::Specification().withHeader());
+    std::stringstream ost;
+    csv::JsonlWriter writer(ost);
+    writer.withNumber("a");
+    if(parallel)
+    {
+      REQUIRE_THROWS_AS(writer.write(reader, 2, 1), csv::ConversionError);
+    }
+    else
+    {
+      REQUIRE_THROWS_AS(writer.write(reader), csv::ConversionError);
+    }
+    REQUIRE(ost.str() == expected);
+    std::stringstream ist2("a,b\n7,k\n");
+    csv::Reader reader2(ist2, csv::Specification().withHeader());
+    REQUIRE(writer.write(reader2) == 1u);
+    REQUIRE(ost.str() == std::string(expected) + "{\"a\":7,\"b\":\"k\"}\n");
+  }
+}
+
+TEST_CASE("WriteJsonLinesConversionError", "[csv_jsonl_writer]")
+{
+  std::stringstream ist("id\n1\nx\n");
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::stringstream ost;
+  csv::JsonlWriter writer(ost);
+  writer.withNumber("id");
+  bool caught = false;
+  try
+  {
+    writer.write(reader, 2, 1);
+  }
+  catch(const csv::ConversionError & ex)
+  {
+    REQUIRE(ex.typeIndex() == std::type_index(typeid(double)));
+    REQUIRE(ex.row() == 2u);
+    REQUIRE(ex.column() == 0u);
+    caught = true;
+  }
+  REQUIRE(caught);
+  REQUIRE(ost.str() == "{\"id\":1}\n");
+  // nothing of the failed row is left for the next write
+  std::stringstream ist3("id\n7\n");
+  csv::Reader reader3(ist3, csv::Specification().withHeader());
+  REQUIRE(writer.write(reader3) == 1u);
+  REQUIRE(ost.str() == "{\"id\":1}\n{\"id\":7}\n");
+  std::stringstream ist2("id\n1\n");
+  csv::Reader reader2(ist2, csv::Specification().withHeader());
+  csv::JsonlWriter writer2(ost);
+  writer2.withNumber("missing");
+  REQUIRE_THROWS_AS(writer2.write(reader2), csv::UndefinedColumnError);
+}
@@ -0,0 +1,249 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/object_reader.h>
+#include <sstream>
+#include <vector>
+
+struct Item
+{
+  int         id;
+  std::string name;
+  double      weight;
+  Item() : id(-1), weight(-1.0) {}
+};
+
+static csv::Builder<Item> itemBuilder()
+{
+  csv::Builder<Item> builder;
+  builder
+    .member<int>(&Item::id, "id", 0)
+    .member<std::string>(&Item::name, "name", "")
+    .member<double>(&Item::weight, "weight", 0.0);
+  return builder;
+}
+
+TEST_CASE("MapColumnsByHeaderInAnyOrder", "[csv_object_reader]")
+{
+  std::stringstream ss("weight,unused,id,name\n"
+                       "1.5,x,1,apple\n"
+                       "2.5,y,2,\"pear, green\"\n");
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  std::vector<Item> items(reader.begin(), reader.end());
+  REQUIRE(items.size() == 2u);
+  REQUIRE(items[0].id == 1);
+  REQUIRE(items[0].name == "apple");
+  REQUIRE(items[0].weight == 1.5);
+  REQUIRE(items[1].id == 2);
+  REQUIRE(items[1].name == "pear, green");
+  REQUIRE(items[1].weight == 2.5);
+}
+
+TEST_CASE("MapSingleRowByName", "[csv_object_reader]")
+{
+  std::stringstream ss("name,id\n"
+                       "apple,1\n");
+  csv::Reader reader(ss, csv::Specification().withHeader());
+  auto itr = reader.begin();
+  Item item;
+  csv::ObjectReader<Item>::map(item, itemBuilder(), *itr);
+  REQUIRE(item.id == 1);
+  REQUIRE(item.name == "apple");
+  REQUIRE(item.weight == -1.0);
+}
+
+TEST_CASE("MapColumnsMissingInHeaderOrRow", "[csv_object_reader]")
+{
+  std::stringstream ss("name,id\n"
+                       "apple,1\n"
+                       "pear\n");
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  std::vector<Item> items(reader.begin(), reader.end());
+  REQUIRE(items.size() == 2u);
+  REQUIRE(items[0].id == 1);
+  REQUIRE(items[0].weight == -1.0);
+  REQUIRE(items[1].name == "pear");
+  REQUIRE(items[1].id == -1);
+}
+
+TEST_CASE("MapColumnsDefinedInSpecification", "[csv_object_reader]")
+{
+  std::stringstream ss("3,plum,0.5\n");
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification()
+                                 .withColumn(0, "id")
+                                 .withColumn(1, "name")
+                                 .withColumn(2, "weight"));
+  std::vector<Item> items(reader.begin(), reader.end());
+  REQUIRE(items.size() == 1u);
+  REQUIRE(items[0].id == 3);
+  REQUIRE(items[0].name == "plum");
+  REQUIRE(items[0].weight == 0.5);
+}
+
+TEST_CASE("MapConversionErrorHasCellPosition", "[csv_object_reader]")
+{
+  std::stringstream ss("id,name\n"
+                       "1,a\n"
+                       "x,b\n");
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  auto itr = reader.begin();
+  REQUIRE(itr->id == 1);
+  try
+  {
+    ++itr;
+    FAIL("ConversionError expected");
+  }
+  catch(const csv::ConversionError & err)
+  {
+    REQUIRE(err.inputLine() == 2u);
+    REQUIRE(err.row() == 2u);
+    REQUIRE(err.column() == 0u);
+  }
+}
+
+TEST_CASE("IterateWithObjectReuse", "[csv_object_reader]")
+{
+  std::stringstream ss("id,name,weight\n"
+                       "1,apple,1.5\n"
+                       "2,pear\n"
+                       "3,plum,0.5\n");
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  reader.withObjectReuse();
+  REQUIRE(reader.isReusingObjects());
+  auto itr = reader.begin();
+  const Item * first = &*itr;
+  REQUIRE(itr->id == 1);
+  REQUIRE(itr->weight == 1.5);
+  ++itr;
+  REQUIRE(&*itr == first);
+  REQUIRE(itr->id == 2);
+  REQUIRE(itr->name == "pear");
+  REQUIRE(itr->weight == -1.0);
+  ++itr;
+  REQUIRE(&*itr == first);
+  REQUIRE(itr->id == 3);
+  REQUIRE(itr->weight == 0.5);
+  ++itr;
+  REQUIRE(itr == reader.end());
+}
+
+TEST_CASE("ReadIntoVectorInBatches", "[csv_object_reader]")
+{
+  std::stringstream ss("id,name,weight\n"
+                       "1,a,0.5\n"
+                       "2,b,1.5\n"
+                       "3,c\n"
+                       "4,d,3.5\n"
+                       "5,e,4.5\n");
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  std::vector<Item> items;
+  REQUIRE(reader.readInto(items, 2) == 2u);
+  REQUIRE(items.size() == 2u);
+  REQUIRE(reader.readInto(items, 2) == 2u);
+  REQUIRE(reader.readInto(items) == 1u);
+  REQUIRE(reader.readInto(items) == 0u);
+  REQUIRE(items.size() == 5u);
+  for(int i = 0; i < 5; i++)
+  {
+    REQUIRE(items[i].id == i + 1);
+  }
+  REQUIRE(items[2].weight == -1.0);
+  REQUIRE(items[4].name == "e");
+}
+
+TEST_CASE("ReadIntoSkipsRowWithConversionError", "[csv_object_reader]")
+{
+  std::stringstream ss("id\n1\nx\n3\n");
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  std::vector<Item> items;
+  REQUIRE_THROWS_AS(reader.readInto(items), csv::ConversionError);
+  REQUIRE(items.size() == 1u);
+  REQUIRE(reader.readInto(items) == 1u);
+  REQUIRE(items.back().id == 3);
+}
+
+TEST_CASE("ReadParallelKeepsRowOrder", "[csv_object_reader]")
+{
+  std::stringstream ss;
+  ss << "id,name,weight\n";
+  for(int i = 0; i < 10000; i++)
+  {
+    ss << i << ",n" << i << "," << i * 0.5 << "\n";
+  }
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  std::vector<Item> items;
+  std::size_t n = reader.readParallel([&items](const Item & item)
+                                      {
+                                        items.push_back(item);
+                                      }, 4, 97);
+  REQUIRE(n == 10000u);
+  REQUIRE(items.size() == 10000u);
+  for(int i = 0; i < 10000; i++)
+  {
+    REQUIRE(items[i].id == i);
+    REQUIRE(items[i].name == "n" + std::to_string(i));
+    REQUIRE(items[i].weight == i * 0.5);
+  }
+}
+
+TEST_CASE("ReadParallelPropagatesConversionError", "[csv_object_reader]")
+{
+  std::stringstream ss;
+  ss << "id\n";
+  for(int i = 0; i < 1000; i++)
+  {
+    ss << (i == 505 ? std::string("x") : std::to_string(i)) << "\n";
+  }
+  csv::ObjectReader<Item> reader(itemBuilder(), ss,
+                                 csv::Specification().withHeader());
+  csv::ThreadPool pool(3);
+  std::size_t count = 0;
+  try
+  {
+    reader.readParallel([&count](const Item &) { count++; }, pool, 10);
+    FAIL("ConversionError expected");
+  }
+  catch(const csv::ConversionError & err)
+  {
+    REQUIRE(err.row() == 506u);
+  }
+  // rows 0..504 precede the failing row in the middle of its batch
+  REQUIRE(count == 505u);
+}
@@ -0,0 +1,199 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/object_writer.h>
+#include <csv/object_reader.h>
+#include <sstream>
+#include <limits>
+#include <cstdint>
+#include <cstdlib>
+
+struct Trade
+{
+  int         id;
+  std::string symbol;
+  double      price;
+  long long   volume;
+  bool        open;
+  Trade() : id(0), price(0), volume(0), open(false) {}
+};
+
+static csv::Builder<Trade> tradeBuilder()
+{
+  csv::Builder<Trade> builder;
+  builder
+    .member<int>(&Trade::id, "id", 0)
+    .member<std::string>(&Trade::symbol, "symbol", "")
+    .member<double>(&Trade::price, "price", 0.0)
+    .member<long long>(&Trade::volume, "volume", 0)
+    .member<bool>(&Trade::open, "open", false);
+  return builder;
+}
+
+template<typename T>
+static std::string format(const T & value,
+                          const std::locale & locale = std::locale())
+{
+  std::string ret;
+  csv::BasicFormatter<char, csv::char_traits, T>::format(ret, value, locale);
+  return ret;
+}
+
+TEST_CASE("FormatIntegers", "[csv_object_writer]")
+{
+  REQUIRE(format<int>(0) == "0");
+  REQUIRE(format<int>(7) == "7");
+  REQUIRE(format<int>(-42) == "-42");
+  REQUIRE(format<unsigned>(1234567890u) == "1234567890");
+  REQUIRE(format<std::int64_t>(std::numeric_limits<std::int64_t>::min()) ==
+          "-9223372036854775808");
+  REQUIRE(format<std::uint64_t>(std::numeric_limits<std::uint64_t>::max()) ==
+          "18446744073709551615");
+  REQUIRE(format<bool>(true) == "1");
+}
+
+TEST_CASE("FormatFloatingPointRoundTrips", "[csv_object_writer]")
+{
+  REQUIRE(format<double>(0.1) == "0.1");
+  REQUIRE(format<double>(-2.5) == "-2.5");
+  REQUIRE(format<double>(1e300) == "1e+300");
+  double third = 1.0 / 3.0;
+  REQUIRE(std::stod(format<double>(third)) == third);
+  REQUIRE(format<float>(0.1f) == "0.1");
+  // 16 significant digits round trip, 17 would give 0.89999999999999991
+  REQUIRE(format<double>(0.3 + 0.6) == "0.8999999999999999");
+  REQUIRE(std::strtod(format<double>(5e-324).c_str(), nullptr) == 5e-324);
+  REQUIRE(format<double>(5e-324) == "5e-324");
+  REQUIRE(format<double>(1e15) == "1e+15");
+  REQUIRE(format<double>(1e-5) == "1e-05");
+}
+
+TEST_CASE("FormatWithDecimalSeparator", "[csv_object_writer]")
+{
+  auto spec = csv::Specification().withDecimalSeparator(',');
+  REQUIRE(format<double>(2.5, spec.locale()) == "2,5");
+}
+
+// implements only the members of the interface before format()
+class StreamedVolume : public csv::MemberInterface<Trade, char, csv::char_traits>
+{
+public:
+  void initialize(Trade & obj) const override { obj.volume = 0; }
+  void parse(Trade & obj, const std::string & str) const override
+  {
+    obj.volume = std::atoll(str.c_str());
+  }
+  void parse(Trade & obj, const std::string & str, const std::locale &) const override
+  {
+    parse(obj, str);
+  }
+  std::string getName() const override { return "volume"; }
+  void streamOut(std::ostream & ost, const Trade & obj) override
+  {
+    ost << "v" << obj.volume;
+  }
+  const std::type_info& getTypeInfo() const override { return typeid(long long); }
+
+protected:
+  void* bindMember(Trade & obj) const override { return &obj.volume; }
+  const void* bindMember(const Trade & obj) const override { return &obj.volume; }
+};
+
+TEST_CASE("FormatDefaultsToStreamOut", "[csv_object_writer]")
+{
+  StreamedVolume streamed;
+  csv::MemberInterface<Trade, char, csv::char_traits> & member = streamed;
+  Trade trade;
+  std::string text("42");
+  member.parse(trade, text.data(), text.data() + text.size(), std::locale());
+  REQUIRE(trade.volume == 42);
+  std::string out;
+  member.format(out, trade, std::locale());
+  REQUIRE(out == "v42");
+}
+
+TEST_CASE("WriteObjectsWithHeader", "[csv_object_writer]")
+{
+  std::vector<Trade> trades(2);
+  trades[0].id     = 1;
+  trades[0].symbol = "ABC";
+  trades[0].price  = 10.25;
+  trades[0].volume = 100;
+  trades[0].open   = true;
+  trades[1].id     = 2;
+  trades[1].symbol = "X, Y";
+  trades[1].price  = 0.1;
+  trades[1].volume = -5;
+  std::stringstream ss;
+  {
+    csv::ObjectWriter<Trade> writer(tradeBuilder(), ss,
+                                    csv::Specification().withHeader());
+    writer.write(trades);
+  }
+  REQUIRE(ss.str() == 
+          "id,symbol,price,volume,open\n"
+          "1,ABC,10.25,100,1\n"
+          "2,\"X, Y\",0.1,-5,0\n");
+}
+
+TEST_CASE("WriteAndReadObjectsRoundTrip", "[csv_object_writer]")
+{
+  std::vector<Trade> trades;
+  for(int i = 0; i < 100; i++)
+  {
+    Trade t;
+    t.id     = i;
+    t.symbol = "S\"" + std::to_string(i);
+    t.price  = i / 7.0;
+    t.volume = i * 1000000007LL;
+    t.open   = i % 2;
+    trades.push_back(t);
+  }
+  std::stringstream ss;
+  {
+    csv::ObjectWriter<Trade> writer(tradeBuilder(), ss,
+                                    csv::Specification().withHeader(), 64);
+    writer.write(trades.begin(), trades.end());
+  }
+  csv::ObjectReader<Trade> reader(tradeBuilder(), ss,
+                                  csv::Specification().withHeader());
+  std::vector<Trade> result(reader.begin(), reader.end());
+  REQUIRE(result.size() == trades.size());
+  for(std::size_t i = 0; i < trades.size(); i++)
+  {
+    REQUIRE(result[i].id     == trades[i].id);
+    REQUIRE(result[i].symbol == trades[i].symbol);
+    REQUIRE(result[i].price  == trades[i].price);
+    REQUIRE(result[i].volume == trades[i].volume);
+    REQUIRE(result[i].open   == trades[i].open);
+  }
+}
@@ -917,6 +917,10 @@ TEST_CASE("ReadWithHeader", "[csv_reader]")
   REQUIRE(row2[0].name() == "first");
   REQUIRE(row2[1].name() == "second");
   REQUIRE_THROWS(row2["third"].name());
+  REQUIRE(reader.specification().numColumns() == 8u);
+  REQUIRE(reader.specification().columnName(5) == "sixth");
+  REQUIRE(reader.specification().columnName(6) == "");
+  REQUIRE(reader.specification().columnName(8) == "");
 }
 
 TEST_CASE("ReadWithHeaderFromCsvFile", "[csv_reader]")
@@ -1089,3 +1093,176 @@ TEST_CASE("CellAccessorUndefinedColumns","[csv_reader]")
   REQUIRE(caught1);
   REQUIRE(caught2);
 }
+
+TEST_CASE("CellAccessorColumnHandle","[csv_reader]")
+{
+  auto spec = csv::Specification().withHeader();
+  std::stringstream ss("0,1,2,3,4,5,6,7\na,b,c,d\ne,f,g");
+  csv::Reader reader(ss, spec); 
+  auto h0    = reader.specification().handle("0");
+  auto h7    = reader.specification().handle("7");
+  auto undef = reader.specification().handle("xxx");
+  REQUIRE(h0.isValid());
+  REQUIRE(h7.index() == 7);
+  REQUIRE_FALSE(undef.isValid());
+  auto itr = reader.begin();
+  bool caught1 = false;
+  bool caught2 = false;
+  try 
+  {
+    auto row = *itr; ++itr;
+    REQUIRE(row[h0].as<std::string>() == "a");
+    REQUIRE(row.find(h0) == row.begin());
+    REQUIRE(row.find(undef) == row.end());
+    row[undef];
+  }
+  catch(const csv::UndefinedColumnError & ex)
+  {
+    REQUIRE(ex.size()        == 4);
+    REQUIRE(ex.inputLine()   == 1);
+    REQUIRE(ex.inputColumn() == 6);
+    REQUIRE(ex.row()         == 1);
+    REQUIRE(ex.column()      == 3);
+    caught1 = true;
+  }
+  try
+  {
+    auto row = *itr; ++itr;
+    REQUIRE(row.find(h7) == row.end());
+    row[h7];
+  }
+  catch(const csv::DefinedCellOutOfRangeError & ex)
+  {
+    REQUIRE(ex.index()       == 7);
+    REQUIRE(ex.size()        == 3);
+    REQUIRE(ex.inputLine()   == 2);
+    REQUIRE(ex.inputColumn() == 4);
+    REQUIRE(ex.row()         == 2);
+    REQUIRE(ex.column()      == 2);
+    caught2 = true;
+  }
+  REQUIRE(caught1);
+  REQUIRE(caught2);
+}
+
+TEST_CASE("MemoryUsageOfReaderAndRows","[csv_reader]")
+{
+  std::stringstream ss("a,b,c\n1,22,333\n4444,55555,666666\n");
+  csv::Reader reader(ss, csv::Specification().withHeader().withDictionary("b"));
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 2u);
+  REQUIRE(rows[0].memoryUsage() >= 3 * sizeof(csv::Cell) + 4);
+  REQUIRE(rows[1].memoryUsage() >= 3 * sizeof(csv::Cell) + 10);
+  auto dictionary = reader.specification().dictionary("b");
+  REQUIRE(dictionary->memoryUsage() >= 7);
+  REQUIRE(reader.memoryUsage() >= dictionary->memoryUsage());
+}
+
+TEST_CASE("TryAsSkipsInvalidCells","[csv_reader]")
+{
+  std::stringstream ss("1,2\nN/A,4\n5,\n");
+  csv::Reader reader(ss);
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  int sum = 0;
+  std::size_t failed = 0;
+  for(auto & row : rows)
+  {
+    for(auto & cell : row)
+    {
+      int value;
+      if(cell.tryAs(value))
+      {
+        sum += value;
+      }
+      else
+      {
+        failed++;
+      }
+    }
+  }
+  REQUIRE(sum == 12);
+  REQUIRE(failed == 2u);
+  auto error = rows[1][0].conversionError<int>();
+  REQUIRE(error.row()         == 1u);
+  REQUIRE(error.column()      == 0u);
+  REQUIRE(error.inputLine()   == 1u);
+  REQUIRE(error.inputColumn() == 0u);
+}
+
+TEST_CASE("MalformedInputThrowsParseError","[csv_reader]")
+{
+  REQUIRE_THROWS_AS(parseStream("a,b\n\"c\" x,d\n"), csv::ParseError);
+  REQUIRE_THROWS_AS(parseStream("a,b\n\"c,d\n"), csv::ParseError);
+}
+
+TEST_CASE("LenientParsingSkipsMalformedRows","[csv_reader]")
+{
+  std::stringstream ss("a,b\n"
+                       "1,2\n"
+                       "3,\"x\"y,4\n"
+                       "5,6\n"
+                       "\"7\" z\n"
+                       "8,\"9");
+  csv::Reader reader(ss);
+  reader.withLenientParsing();
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 3u);
+  REQUIRE(rows[0][0].as<std::string>() == "a");
+  REQUIRE(rows[1][1].as<int>() == 2);
+  REQUIRE(rows[2].size() == 2u);
+  REQUIRE(rows[2][0].as<int>() == 5);
+  REQUIRE(rows[2].row() == 3u);
+  REQUIRE(rows[2][1].row() == 3u);
+  auto & errors = reader.errors();
+  REQUIRE(errors.size() == 3u);
+  REQUIRE(errors.count() == 3u);
+  REQUIRE(errors[0].code == csv::ParseErrorCode::UNEXPECTED_CHARACTER_AFTER_QUOTE);
+  REQUIRE(errors[0].offset == 13u);
+  REQUIRE(errors[0].input_line == 2u);
+  REQUIRE(errors[0].input_column == 5u);
+  REQUIRE(errors[0].row == 2u);
+  REQUIRE(errors[0].column == 1u);
+  REQUIRE(errors[1].code == csv::ParseErrorCode::UNEXPECTED_CHARACTER_AFTER_QUOTE);
+  REQUIRE(errors[1].input_line == 4u);
+  REQUIRE(errors[1].row == 4u);
+  REQUIRE(errors[1].offset == 25u);
+  REQUIRE(errors[2].code == csv::ParseErrorCode::UNTERMINATED_QUOTE);
+  REQUIRE(errors[2].input_line == 5u);
+  REQUIRE(errors[2].offset == 31u);
+}
+
+TEST_CASE("LenientParsingErrorLogIsBounded","[csv_reader]")
+{
+  std::string input;
+  for(int i = 0; i < 10; i++)
+  {
+    input += "\"a\"b,c\n1,2\n";
+  }
+  std::stringstream ss(input);
+  csv::Reader reader(ss);
+  reader.withLenientParsing(4);
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 10u);
+  REQUIRE(reader.errors().size() == 4u);
+  REQUIRE(reader.errors().count() == 10u);
+}
+
+TEST_CASE("ReadRawRows","[csv_reader]")
+{
+  std::stringstream ss("id,name\n1,\"a,b\"\n\n2\n");
+  csv::Reader reader(ss, csv::Specification().withHeader());
+  const char * begin;
+  const char * end;
+  REQUIRE(reader.nextRawRow());
+  REQUIRE(reader.rawRowSize() == 2u);
+  reader.rawCell(1, begin, end);
+  REQUIRE(std::string(begin, end) == "a,b");
+  REQUIRE(reader.rawRow() == 1u);
+  REQUIRE(reader.rawInputLine() == 1u);
+  REQUIRE(reader.nextRawRow());
+  REQUIRE(reader.rawRowSize() == 1u);
+  reader.rawCell(0, begin, end);
+  REQUIRE(std::string(begin, end) == "2");
+  REQUIRE(reader.rawInputLine() == 3u);
+  REQUIRE_FALSE(reader.nextRawRow());
+}
@@ -0,0 +1,184 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/sorter.h>
+#include <csv/reader.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  std::vector<std::vector<std::string> > readAll(const std::string & input)
+  {
+    std::vector<std::vector<std::string> > ret;
+    std::stringstream ss(input);
+    csv::Reader reader(ss);
+    for(auto & row : reader)
+    {
+      ret.push_back(std::vector<std::string>());
+      for(auto & cell : row)
+      {
+        ret.back().push_back(cell.as<std::string>());
+      }
+    }
+    return ret;
+  }
+}
+
+TEST_CASE("SortInMemory", "[csv_sorter]")
+{
+  std::stringstream ist;
+  ist << "name,amount"         << std::endl;
+  ist << "b,10"                << std::endl;
+  ist << "\"a,\nmultiline\",9" << std::endl;
+  ist << "c,n/a"               << std::endl;
+  ist << "b,2"                 << std::endl;
+  ist << "a,-1.5"              << std::endl;
+  std::stringstream ost;
+  csv::Sorter sorter(csv::Specification().withHeader());
+  sorter.withKey("amount", csv::SortKey::NUMERIC);
+  REQUIRE(sorter.sort(ist, ost, 1) == 5u);
+  REQUIRE(sorter.runs() == 0u);
+  REQUIRE(ost.str() == 
+          "name,amount\n"
+          "a,-1.5\n"
+          "b,2\n"
+          "\"a,\nmultiline\",9\n"
+          "b,10\n"
+          "c,n/a\n");
+}
+
+TEST_CASE("SortByCompositeKeyIsStable", "[csv_sorter]")
+{
+  std::stringstream ist;
+  ist << "b,1,first"  << std::endl;
+  ist << "a,2,second" << std::endl;
+  ist << "b,1,third"  << std::endl;
+  ist << "a,10,fourth" << std::endl;
+  ist << "b"          << std::endl;
+  std::stringstream ost;
+  csv::Sorter sorter;
+  sorter.withKey(0).withKey(1);
+  sorter.sort(ist, ost, 1);
+  REQUIRE(ost.str() == 
+          "a,10,fourth\n"
+          "a,2,second\n"
+          "b\n"
+          "b,1,first\n"
+          "b,1,third\n");
+}
+
+TEST_CASE("SortUndefinedKeyThrows", "[csv_sorter]")
+{
+  std::stringstream ist("name,amount\nb,10\n");
+  std::stringstream ost;
+  csv::Sorter sorter(csv::Specification().withHeader());
+  sorter.withKey("date");
+  REQUIRE_THROWS_AS(sorter.sort(ist, ost, 1), csv::UndefinedColumnError);
+}
+
+TEST_CASE("SortExternalMatchesInMemory", "[csv_sorter]")
+{
+  std::stringstream input;
+  input << "id,key,text" << std::endl;
+  for(std::size_t i = 0; i < 5000; i++)
+  {
+    input << i << "," << (i * 7919) % 1000 << ",";
+    if(i % 13 == 0)
+    {
+      input << "\"quoted, \"\"text\"\"\nwith a line break\"";
+    }
+    else
+    {
+      input << "text " << i;
+    }
+    input << std::endl;
+  }
+  const std::string data = input.str();
+  std::stringstream ist1(data);
+  std::stringstream ist2(data);
+  std::stringstream ist3(data);
+  std::stringstream expected;
+  std::stringstream external;
+  std::stringstream multipass;
+  csv::Sorter sorter(csv::Specification().withHeader());
+  sorter.withKey("key", csv::SortKey::NUMERIC);
+  sorter.sort(ist1, expected, 1);
+  REQUIRE(sorter.runs() == 0u);
+  sorter.withMemoryLimit(16 * 1024);
+  sorter.sort(ist2, external, 3);
+  REQUIRE(sorter.runs() > 4u);
+  sorter.withMergeWidth(2);
+  sorter.sort(ist3, multipass, 2);
+  REQUIRE(external.str() == expected.str());
+  REQUIRE(multipass.str() == expected.str());
+
+  auto rows = readAll(expected.str());
+  REQUIRE(rows.size() == 5001u);
+  REQUIRE(rows[0] == std::vector<std::string>({"id", "key", "text"}));
+  for(std::size_t i = 2; i < rows.size(); i++)
+  {
+    REQUIRE(std::stoi(rows[i - 1][1]) <= std::stoi(rows[i][1]));
+    if(rows[i - 1][1] == rows[i][1])
+    {
+      REQUIRE(std::stoi(rows[i - 1][0]) < std::stoi(rows[i][0]));
+    }
+    if(std::stoi(rows[i][0]) % 13 == 0)
+    {
+      REQUIRE(rows[i][2] == "quoted, \"text\"\nwith a line break");
+    }
+  }
+}
+
+TEST_CASE("SortWideExternalKeepsNonAscii", "[csv_sorter]")
+{
+  std::wstringstream input;
+  for(std::size_t i = 0; i < 2000; i++)
+  {
+    input << (i * 7919) % 100 << L",ä€\U0001F600 " << i << std::endl;
+  }
+  const std::wstring data = input.str();
+  std::wstringstream ist1(data);
+  std::wstringstream ist2(data);
+  std::wstringstream expected;
+  std::wstringstream external;
+  csv::WSorter sorter;
+  sorter.withKey(0, csv::SortKey::NUMERIC);
+  sorter.sort(ist1, expected);
+  REQUIRE(sorter.runs() == 0u);
+  sorter.withMemoryLimit(16 * 1024).withMergeWidth(2);
+  sorter.sort(ist2, external, 2);
+  REQUIRE(sorter.runs() > 2u);
+  REQUIRE(external.str() == expected.str());
+  REQUIRE(expected.str().find(L"ä€\U0001F600 1999") != std::wstring::npos);
+}
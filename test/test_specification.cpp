@@ -244,3 +244,11 @@ TEST_CASE("ConstructionWithDuplicateColumnIndex", "[csv_specification]")
   REQUIRE(caught);
 }
 
+
+TEST_CASE("SpecificationWithQuote", "[csv_specification]")
+{
+  csv::Specification spec;
+  REQUIRE(spec.quote() == '"');
+  spec.withQuote('\'');
+  REQUIRE(spec.quote() == '\'');
+}
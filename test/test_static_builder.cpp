@@ -0,0 +1,117 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/static_builder.h>
+#include <csv/object_reader.h>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  struct Part
+  {
+    int         id;
+    std::string name;
+    double      weight;
+    Part() : id(-1), weight(-1.0) {}
+  };
+
+  typedef csv::StaticBuilder<Part,
+                             CSV_STATIC_MEMBER(Part, id),
+                             CSV_STATIC_MEMBER(Part, name),
+                             CSV_STATIC_MEMBER(Part, weight)> PartBuilder;
+}
+
+TEST_CASE("StaticBuilderRequiresNamePerMember", "[csv_static_builder]")
+{
+  REQUIRE_THROWS_AS(PartBuilder({"id", "name"}), std::invalid_argument);
+  PartBuilder builder({"id", "name", "weight"});
+  REQUIRE(builder.getFieldNames().size() == 3u);
+  REQUIRE(builder.getFieldNames()[2] == "weight");
+}
+
+TEST_CASE("StaticBuilderMapsColumnsByHeader", "[csv_static_builder]")
+{
+  std::stringstream ss("weight,unused,id,name\n"
+                       "1.5,x,1,apple\n"
+                       "2.5,y,2,\"pear, green\"\n"
+                       "3.5,z\n");
+  csv::ObjectReader<Part, PartBuilder> reader(PartBuilder({"id", "name", "weight"}),
+                                              ss,
+                                              csv::Specification().withHeader());
+  std::vector<Part> parts(reader.begin(), reader.end());
+  REQUIRE(parts.size() == 3u);
+  REQUIRE(parts[0].id == 1);
+  REQUIRE(parts[0].name == "apple");
+  REQUIRE(parts[0].weight == 1.5);
+  REQUIRE(parts[1].id == 2);
+  REQUIRE(parts[1].name == "pear, green");
+  REQUIRE(parts[2].id == -1);
+  REQUIRE(parts[2].weight == 3.5);
+}
+
+TEST_CASE("StaticBuilderWithObjectReuse", "[csv_static_builder]")
+{
+  std::stringstream ss("id,name,weight\n"
+                       "1,apple,1.5\n"
+                       "2,pear\n");
+  csv::ObjectReader<Part, PartBuilder> reader(PartBuilder({"id", "name", "weight"}),
+                                              ss,
+                                              csv::Specification().withHeader());
+  reader.withObjectReuse();
+  std::vector<Part> parts;
+  REQUIRE(reader.readInto(parts) == 2u);
+  REQUIRE(parts[1].id == 2);
+  REQUIRE(parts[1].weight == -1.0);
+}
+
+TEST_CASE("StaticBuilderConversionErrorHasCellPosition", "[csv_static_builder]")
+{
+  std::stringstream ss("name,id\n"
+                       "a,1\n"
+                       "b,x\n");
+  csv::ObjectReader<Part, PartBuilder> reader(PartBuilder({"id", "name", "weight"}),
+                                              ss,
+                                              csv::Specification().withHeader());
+  auto itr = reader.begin();
+  REQUIRE(itr->id == 1);
+  try
+  {
+    ++itr;
+    FAIL("ConversionError expected");
+  }
+  catch(const csv::ConversionError & err)
+  {
+    REQUIRE(err.row() == 2u);
+    REQUIRE(err.column() == 1u);
+  }
+}
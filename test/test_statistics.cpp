@@ -0,0 +1,80 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+// built as a separate test program with CSV_ENABLE_STATISTICS defined,
+// the counters change the layout of the reader
+#include <catch.hpp>
+#include <csv/reader.h>
+#include <csv/typed_reader.h>
+#include <csv/object_reader.h>
+#include <sstream>
+#include <vector>
+
+TEST_CASE("ReaderStatisticsCounters", "[csv_statistics]")
+{
+  REQUIRE(csv::ReaderStatistics::enabled());
+  std::string input("a,b,c\r\n"
+                    "\"x\"\"y\",2,3\n"
+                    "\n"
+                    "# comment\n"
+                    "long cell,,\"q\"\n");
+  std::stringstream ss(input);
+  csv::Reader reader(ss, csv::Specification()
+                     .withComment('#')
+                     .withUsingEmptyLines());
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 4u);
+  REQUIRE(rows[1][1].as<int>() == 2);
+  REQUIRE(rows[1][2].as<double>() == 3.0);
+  auto stats = reader.stats();
+  REQUIRE(stats.bytes == input.size());
+  REQUIRE(stats.rows == 4u);
+  REQUIRE(stats.cells == 9u);
+  REQUIRE(stats.quoted_cells == 2u);
+  REQUIRE(stats.escaped_quotes == 1u);
+  REQUIRE(stats.comment_lines == 1u);
+  REQUIRE(stats.empty_lines == 1u);
+  REQUIRE(stats.max_row_width == 3u);
+  REQUIRE(stats.max_cell_length == 9u);
+  REQUIRE(stats.buffer_reallocations > 0u);
+  REQUIRE(stats.conversions == 2u);
+}
+
+TEST_CASE("TypedReaderStatisticsCounters", "[csv_statistics]")
+{
+  std::stringstream ss("1,2.5\n2,3.5\n");
+  csv::TypedReader<int, double> reader(ss);
+  std::vector<std::tuple<int, double> > rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 2u);
+  auto stats = reader.stats();
+  REQUIRE(stats.rows == 2u);
+  REQUIRE(stats.conversions == 4u);
+}
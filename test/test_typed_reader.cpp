@@ -0,0 +1,189 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/typed_reader.h>
+#include <csv/reader.h>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+
+namespace
+{
+  struct Quote
+  {
+    std::int64_t id;
+    double       price;
+    std::string  symbol;
+  };
+}
+
+TEST_CASE("TypedReaderReadsTuples", "[csv_typed_reader]")
+{
+  std::stringstream ss("1, 2.5 ,abc\n"
+                       "-7,-0.125,\"x, y\"\n"
+                       "9223372036854775807,1e3,\n");
+  csv::TypedReader<std::int64_t, double, std::string> reader(ss);
+  std::tuple<std::int64_t, double, std::string> values;
+  REQUIRE(reader.read(values));
+  REQUIRE(std::get<0>(values) == 1);
+  REQUIRE(std::get<1>(values) == 2.5);
+  REQUIRE(std::get<2>(values) == "abc");
+  REQUIRE(reader.read(values));
+  REQUIRE(std::get<0>(values) == -7);
+  REQUIRE(std::get<1>(values) == -0.125);
+  REQUIRE(std::get<2>(values) == "x, y");
+  REQUIRE(reader.read(values));
+  REQUIRE(std::get<0>(values) == 9223372036854775807LL);
+  REQUIRE(std::get<1>(values) == 1000.0);
+  REQUIRE(std::get<2>(values) == "");
+  REQUIRE_FALSE(reader.read(values));
+}
+
+TEST_CASE("TypedReaderIteratesAfterHeader", "[csv_typed_reader]")
+{
+  std::stringstream ss("a,b\n1,0.1\n2,0.2\n");
+  csv::TypedReader<int, double> reader(ss, csv::Specification().withHeader());
+  std::vector<std::tuple<int, double> > rows(reader.begin(), reader.end());
+  REQUIRE(rows.size() == 2u);
+  REQUIRE(std::get<0>(rows[1]) == 2);
+  REQUIRE(std::get<1>(rows[0]) == 0.1);
+  REQUIRE(std::get<1>(rows[1]) == 0.2);
+}
+
+TEST_CASE("TypedReaderFillsMembers", "[csv_typed_reader]")
+{
+  std::stringstream ss("5;12.75;IBM\n");
+  csv::TypedReader<std::int64_t, double, std::string> 
+    reader(ss, csv::Specification().withSeparator(";"));
+  Quote quote;
+  REQUIRE(reader.read(quote, &Quote::id, &Quote::price, &Quote::symbol));
+  REQUIRE(quote.id == 5);
+  REQUIRE(quote.price == 12.75);
+  REQUIRE(quote.symbol == "IBM");
+  REQUIRE_FALSE(reader.read(quote, &Quote::id, &Quote::price, &Quote::symbol));
+}
+
+TEST_CASE("TypedReaderMatchesStreamConversion", "[csv_typed_reader]")
+{
+  const char * doubles[] = { "0.1", "3.14159265358979", "-123456.789", 
+                             "1.", ".5", "0.30000000000000004", 
+                             "123456789012345678901234567890", "1e-7" };
+  for(auto str : doubles)
+  {
+    std::stringstream ss(str);
+    csv::TypedReader<double> reader(ss);
+    std::tuple<double> value;
+    REQUIRE(reader.read(value));
+    REQUIRE(std::get<0>(value) == csv::Cell(str).as<double>());
+  }
+  const char * floats[] = { "0.1", "16777216", "2.5e3", "0.3333333" };
+  for(auto str : floats)
+  {
+    std::stringstream ss(str);
+    csv::TypedReader<float> reader(ss);
+    std::tuple<float> value;
+    REQUIRE(reader.read(value));
+    REQUIRE(std::get<0>(value) == csv::Cell(str).as<float>());
+  }
+}
+
+TEST_CASE("TypedReaderConversionError", "[csv_typed_reader]")
+{
+  std::stringstream ss("1,2\n3,4x\n");
+  csv::TypedReader<int, short> reader(ss);
+  std::tuple<int, short> values;
+  REQUIRE(reader.read(values));
+  try
+  {
+    reader.read(values);
+    FAIL("ConversionError expected");
+  }
+  catch(const csv::ConversionError & err)
+  {
+    REQUIRE(err.inputLine() == 1u);
+    REQUIRE(err.inputColumn() == 2u);
+    REQUIRE(err.row() == 1u);
+    REQUIRE(err.column() == 1u);
+  }
+  std::stringstream overflow("70000");
+  csv::TypedReader<short> short_reader(overflow);
+  std::tuple<short> value;
+  REQUIRE_THROWS_AS(short_reader.read(value), csv::ConversionError);
+}
+
+TEST_CASE("TypedReaderColumnCountMismatch", "[csv_typed_reader]")
+{
+  std::stringstream ss("a,b,c\nd\ne,f,g,h\n");
+  csv::TypedReader<std::string, std::string, std::string> reader(ss);
+  std::tuple<std::string, std::string, std::string> values;
+  REQUIRE(reader.read(values));
+  try
+  {
+    reader.read(values);
+    FAIL("CellOutOfRangeError expected");
+  }
+  catch(const csv::CellOutOfRangeError & err)
+  {
+    std::stringstream ss2("a,b,c\nd\n");
+    csv::Reader plain(ss2);
+    auto itr = plain.begin();
+    ++itr;
+    try
+    {
+      (*itr)[1];
+      FAIL("CellOutOfRangeError expected");
+    }
+    catch(const csv::CellOutOfRangeError & expected)
+    {
+      REQUIRE(err.size() == expected.size());
+      REQUIRE(err.inputLine() == expected.inputLine());
+      REQUIRE(err.inputColumn() == expected.inputColumn());
+      REQUIRE(err.row() == expected.row());
+      REQUIRE(err.column() == expected.column());
+    }
+  }
+  try
+  {
+    reader.read(values);
+    FAIL("CellOutOfRangeError expected");
+  }
+  catch(const csv::CellOutOfRangeError & err)
+  {
+    REQUIRE(err.index() == 3u);
+    REQUIRE(err.size() == 4u);
+    REQUIRE(err.inputLine() == 2u);
+    REQUIRE(err.inputColumn() == 6u);
+    REQUIRE(err.row() == 2u);
+    REQUIRE(err.column() == 3u);
+  }
+  REQUIRE_FALSE(reader.read(values));
+}
@@ -0,0 +1,152 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/utf8.h>
+#include <csv/reader.h>
+#include <csv/typed_reader.h>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+static bool decode(const std::string & str, std::wstring & out)
+{
+  out.clear();
+  return csv::decodeUtf8(str.data(), str.data() + str.size(), out);
+}
+
+TEST_CASE("DecodeUtf8Ascii", "[csv_utf8]")
+{
+  std::string ascii("The quick brown fox jumps over the lazy dog, 0123456789");
+  std::wstring out;
+  REQUIRE(decode(ascii, out));
+  REQUIRE(out == std::wstring(ascii.begin(), ascii.end()));
+  REQUIRE(decode("", out));
+  REQUIRE(out.empty());
+}
+
+TEST_CASE("DecodeUtf8MultiByte", "[csv_utf8]")
+{
+  // ASCII runs longer than 16 bytes around 2, 3 and 4 byte sequences
+  std::string str("abcdefghijklmnopqrstuvwxyz \xc3\xa4 abcdefghijklmnopqrstuvwxyz "
+                  "\xe2\x82\xac\xf0\x9f\x98\x80 end");
+  std::wstring out;
+  REQUIRE(decode(str, out));
+  std::wstring expected(L"abcdefghijklmnopqrstuvwxyz ä abcdefghijklmnopqrstuvwxyz ");
+  expected.push_back(wchar_t(0x20ac));
+  if(sizeof(wchar_t) == 2)
+  {
+    expected.push_back(wchar_t(0xd83d));
+    expected.push_back(wchar_t(0xde00));
+  }
+  else
+  {
+    expected.push_back(wchar_t(0x1f600));
+  }
+  expected += L" end";
+  REQUIRE(out == expected);
+}
+
+TEST_CASE("DecodeUtf8SurrogatePairs", "[csv_utf8]")
+{
+  std::string str("\xf0\x9f\x98\x80");
+  std::u16string out;
+  REQUIRE(csv::decodeUtf8(str.data(), str.data() + str.size(), out));
+  REQUIRE(out.size() == 2u);
+  REQUIRE(out[0] == 0xd83d);
+  REQUIRE(out[1] == 0xde00);
+}
+
+TEST_CASE("DecodeUtf8RejectsMalformedInput", "[csv_utf8]")
+{
+  std::wstring out;
+  REQUIRE_FALSE(decode("abc\x80", out));               // stray continuation
+  REQUIRE_FALSE(decode("\xc3", out));                  // truncated
+  REQUIRE_FALSE(decode("\xc0\xaf", out));              // overlong
+  REQUIRE_FALSE(decode("\xe0\x80\xaf", out));          // overlong
+  REQUIRE_FALSE(decode("\xed\xa0\x80", out));          // surrogate
+  REQUIRE_FALSE(decode("\xf4\x90\x80\x80", out));      // > 0x10FFFF
+  REQUIRE_FALSE(decode("abcdefghijklmnopq\xff", out));
+}
+
+TEST_CASE("EncodeUtf8", "[csv_utf8]")
+{
+  std::wstring wide(L"a\u00e9\u20ac");
+  wide.push_back(wchar_t(0x1F600));
+  std::string out;
+  csv::encodeUtf8(wide.data(), wide.data() + wide.size(), out);
+  REQUIRE(out == "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+  std::u16string utf16(u"x\xd83d\xde00\xd83d");
+  out.clear();
+  csv::encodeUtf8(utf16.data(), utf16.data() + utf16.size(), out);
+  REQUIRE(out == "x\xf0\x9f\x98\x80\xef\xbf\xbd");
+  std::wstring back;
+  REQUIRE(decode("a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", back));
+  REQUIRE(back == wide);
+}
+
+TEST_CASE("ReadUtf8CellsAsWideStrings", "[csv_utf8]")
+{
+  std::stringstream ss("name,price\n"
+                       "K\xc3\xa4se,\"3\xe2\x82\xac\"\n"
+                       "bad,\xc3\n");
+  csv::Reader reader(ss, csv::Specification().withHeader());
+  auto itr = reader.begin();
+  REQUIRE((*itr)[0].as<std::wstring>() == L"Käse");
+  REQUIRE((*itr)["price"].as<std::wstring>() == L"3€");
+  ++itr;
+  REQUIRE((*itr)[0].as<std::wstring>() == L"bad");
+  bool caught = false;
+  try
+  {
+    (*itr)[1].as<std::wstring>();
+  }
+  catch(const csv::ConversionError & ex)
+  {
+    REQUIRE(ex.typeIndex() == std::type_index(typeid(std::wstring)));
+    REQUIRE(ex.row() == 2u);
+    REQUIRE(ex.column() == 1u);
+    caught = true;
+  }
+  REQUIRE(caught);
+}
+
+TEST_CASE("TypedReaderWithWideStringColumns", "[csv_utf8]")
+{
+  std::stringstream ss("1,\xce\xbb\n2,x\n");
+  csv::TypedReader<int, std::wstring> reader(ss);
+  std::tuple<int, std::wstring> values;
+  REQUIRE(reader.read(values));
+  REQUIRE(std::get<1>(values) == L"λ");
+  REQUIRE(reader.read(values));
+  REQUIRE(std::get<1>(values) == L"x");
+  REQUIRE_FALSE(reader.read(values));
+}
@@ -0,0 +1,197 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/utf8_input.h>
+#include <csv/reader.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool isValid(const std::string & str)
+{
+  bool incomplete;
+  return csv::Utf8InputBuffer::validate(str.data(), str.data() + str.size(), 
+                                        incomplete) == str.size() && !incomplete;
+}
+
+TEST_CASE("Utf8ValidateAcceptsWellFormedInput", "[csv_utf8_input]")
+{
+  REQUIRE(isValid(""));
+  REQUIRE(isValid("plain ascii text that is longer than thirty-two bytes"));
+  REQUIRE(isValid("K\xc3\xa4se \xe2\x82\xac \xf0\x9f\x98\x80 \xf4\x8f\xbf\xbf"));
+}
+
+TEST_CASE("Utf8ValidateRejectsMalformedInput", "[csv_utf8_input]")
+{
+  bool incomplete;
+  std::string str("0123456789abcdefghijklmnopqrstuvwxyz\x80tail");
+  REQUIRE(csv::Utf8InputBuffer::validate(str.data(), str.data() + str.size(),
+                                         incomplete) == 36u);
+  REQUIRE_FALSE(incomplete);
+  REQUIRE_FALSE(isValid("\xc0\xaf"));
+  REQUIRE_FALSE(isValid("\xe0\x80\xaf"));
+  REQUIRE_FALSE(isValid("\xed\xa0\x80"));
+  REQUIRE_FALSE(isValid("\xf4\x90\x80\x80"));
+  REQUIRE_FALSE(isValid("\xff"));
+  REQUIRE_FALSE(isValid("\xe2\x28\xa1"));
+  str = "ab\xe2\x82";
+  REQUIRE(csv::Utf8InputBuffer::validate(str.data(), str.data() + str.size(),
+                                         incomplete) == 2u);
+  REQUIRE(incomplete);
+}
+
+TEST_CASE("Utf8InputStripsBom", "[csv_utf8_input]")
+{
+  std::stringstream ss("\xef\xbb\xbf" "a,b\n1,\xc3\xa4\n");
+  csv::Utf8InputStream ist(ss);
+  csv::Reader reader(ist, csv::Specification().withHeader());
+  std::vector<csv::Row> rows(reader.begin(), reader.end());
+  REQUIRE(ist.hasBom());
+  REQUIRE(rows.size() == 1u);
+  REQUIRE(rows[0]["a"].as<std::string>() == "1");
+  REQUIRE(rows[0]["b"].as<std::string>() == "\xc3\xa4");
+}
+
+TEST_CASE("Utf8InputSequencesAcrossBlocks", "[csv_utf8_input]")
+{
+  std::string line("\xe2\x82\xac\xf0\x9f\x98\x80,\xc3\xa4\xc3\xb6\xc3\xbc\n");
+  std::string input;
+  for(int i = 0; i < 50; i++)
+  {
+    input+= line;
+  }
+  std::stringstream ss(input);
+  // blocks of 16 bytes split most of the sequences
+  csv::Utf8InputStream ist(ss, 16);
+  csv::Reader reader(ist);
+  std::size_t n = 0;
+  for(auto & row : reader)
+  {
+    REQUIRE(row.size() == 2u);
+    REQUIRE(row[0].as<std::string>() == "\xe2\x82\xac\xf0\x9f\x98\x80");
+    n++;
+  }
+  REQUIRE(n == 50u);
+  REQUIRE_FALSE(ist.hasBom());
+}
+
+TEST_CASE("Utf8InputThrowsAtMalformedByte", "[csv_utf8_input]")
+{
+  std::string input("a,b\r\n");
+  for(int i = 0; i < 20; i++)
+  {
+    input+= "1,\xc3\xa4\n";
+  }
+  input+= "xyz,ab\xc3\x28\n3,4\n";
+  for(std::size_t block_size : { std::size_t(16), std::size_t(1 << 16) })
+  {
+    std::stringstream ss(input);
+    csv::Utf8InputStream ist(ss, block_size);
+    csv::Reader reader(ist, csv::Specification().withHeader());
+    std::size_t rows = 0;
+    bool caught = false;
+    try
+    {
+      for(auto & row : reader)
+      {
+        REQUIRE(row.size() == 2u);
+        rows++;
+      }
+    }
+    catch(const csv::ParseError & ex)
+    {
+      REQUIRE(ex.inputLine()   == 21u);
+      REQUIRE(ex.inputColumn() == 6u);
+      caught = true;
+    }
+    REQUIRE(caught);
+    REQUIRE(rows == 20u);
+  }
+}
+
+TEST_CASE("Utf8InputCountsCarriageReturnLines", "[csv_utf8_input]")
+{
+  for(std::string eol : { std::string("\r"), std::string("\r\n") })
+  {
+    std::string input("a,b" + eol);
+    for(int i = 0; i < 20; i++)
+    {
+      input+= "1,\xc3\xa4" + eol;
+    }
+    input+= "xyz,ab\xc3\x28" + eol + "3,4" + eol;
+    // block sizes of 16 and 17 split CR LF pairs at block ends
+    for(std::size_t block_size : { std::size_t(16), std::size_t(17), std::size_t(1 << 16) })
+    {
+      INFO("eol size " << eol.size() << " block size " << block_size);
+      std::stringstream ss(input);
+      csv::Utf8InputStream ist(ss, block_size);
+      csv::Reader reader(ist, csv::Specification().withHeader());
+      std::size_t rows = 0;
+      bool caught = false;
+      try
+      {
+        for(auto & row : reader)
+        {
+          REQUIRE(row.size() == 2u);
+          rows++;
+        }
+      }
+      catch(const csv::ParseError & ex)
+      {
+        REQUIRE(ex.inputLine()   == 21u);
+        REQUIRE(ex.inputColumn() == 6u);
+        caught = true;
+      }
+      REQUIRE(caught);
+      REQUIRE(rows == 20u);
+    }
+  }
+}
+
+TEST_CASE("Utf8InputThrowsAtTruncatedSequence", "[csv_utf8_input]")
+{
+  std::stringstream ss("a,b\n1,\xe2\x82");
+  csv::Utf8InputStream ist(ss);
+  bool caught = false;
+  try
+  {
+    csv::Reader reader(ist);
+    std::vector<csv::Row> rows(reader.begin(), reader.end());
+  }
+  catch(const csv::ParseError & ex)
+  {
+    REQUIRE(ex.inputLine()   == 1u);
+    REQUIRE(ex.inputColumn() == 2u);
+    caught = true;
+  }
+  REQUIRE(caught);
+}
@@ -0,0 +1,187 @@
+/******************************************************************************
+Copyright (c) 2015, Stefan Wolfsheimer
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+The views and conclusions contained in the software and documentation are those
+of the authors and should not be interpreted as representing official policies,
+either expressed or implied, of the FreeBSD Project.
+******************************************************************************/
+
+#include <catch.hpp>
+#include <csv/writer.h>
+#include <csv/reader.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+typedef std::vector<std::string> strings_t;
+
+static std::vector<strings_t> readBack(const std::string & str,
+                                       csv::Specification spec = 
+                                       csv::Specification())
+{
+  std::stringstream ss(str);
+  csv::Reader reader(ss, spec);
+  std::vector<strings_t> ret;
+  for(auto row : reader)
+  {
+    strings_t cells;
+    for(auto cell : row)
+    {
+      cells.push_back(cell.as<std::string>());
+    }
+    ret.push_back(cells);
+  }
+  return ret;
+}
+
+TEST_CASE("WriteUnquotedCells", "[csv_writer]")
+{
+  std::stringstream ss;
+  {
+    csv::Writer writer(ss);
+    writer.writeRow(strings_t({"a", "b", "c"}));
+    writer.writeCell("1").writeCell(std::string("2")).writeCell("").endRow();
+    REQUIRE(writer.row() == 2u);
+  }
+  REQUIRE(ss.str() == "a,b,c\n1,2,\n");
+}
+
+TEST_CASE("WriteQuotesCellsOnlyWhenNeeded", "[csv_writer]")
+{
+  std::stringstream ss;
+  {
+    csv::Writer writer(ss);
+    writer.writeRow(strings_t({"a,b", "say \"hi\"", "x\ny", " ws", "plain"}));
+  }
+  REQUIRE(ss.str() == "\"a,b\",\"say \"\"hi\"\"\",\"x\ny\",\" ws\",plain\n");
+}
+
+TEST_CASE("WriteLongCellsUsesVectorizedScan", "[csv_writer]")
+{
+  std::string longCell(100, 'x');
+  std::string quotedCell = longCell + ",";
+  std::stringstream ss;
+  {
+    csv::Writer writer(ss);
+    writer.writeRow(strings_t({longCell, quotedCell}));
+  }
+  REQUIRE(ss.str() == longCell + ",\"" + quotedCell + "\"\n");
+}
+
+TEST_CASE("WriteSingleEmptyCellRow", "[csv_writer]")
+{
+  std::stringstream ss;
+  {
+    csv::Writer writer(ss);
+    writer.writeRow(strings_t({""}));
+    writer.writeRow(strings_t({"a"}));
+  }
+  REQUIRE(ss.str() == "\"\"\na\n");
+  REQUIRE(readBack(ss.str()) == std::vector<strings_t>({ {""}, {"a"} }));
+}
+
+TEST_CASE("WriteWithCustomSeparatorAndQuote", "[csv_writer]")
+{
+  auto spec = csv::Specification().withSeparator(";").withQuote('\'');
+  std::stringstream ss;
+  {
+    csv::Writer writer(ss, spec);
+    writer.writeRow(strings_t({"a;b", "it's", "c,d"}));
+  }
+  REQUIRE(ss.str() == "'a;b';'it''s';c,d\n");
+  REQUIRE(readBack(ss.str(), spec) == 
+          std::vector<strings_t>({ {"a;b", "it's", "c,d"} }));
+}
+
+TEST_CASE("WriteWithManySeparators", "[csv_writer]")
+{
+  // more special characters than fit into a BasicCharSet
+  auto spec = csv::Specification().withSeparator(";|\t:!,");
+  std::stringstream ss;
+  {
+    csv::Writer writer(ss, spec);
+    writer.writeRow(strings_t({"a\r\nb", "c\nd", "e,f", "g"}));
+  }
+  REQUIRE(ss.str() == "\"a\r\nb\";\"c\nd\";\"e,f\";g\n");
+  // the reader normalizes line breaks inside quoted cells
+  REQUIRE(readBack(ss.str(), spec) == 
+          std::vector<strings_t>({ {"a\nb", "c\nd", "e,f", "g"} }));
+}
+
+TEST_CASE("WriteQuotesCommentCharacterOnlyWhenSet", "[csv_writer]")
+{
+  std::string nul("a\0b", 3);
+  std::stringstream ss1;
+  {
+    csv::Writer writer(ss1);
+    writer.writeRow(strings_t({nul, "#c"}));
+  }
+  REQUIRE(ss1.str() == nul + ",#c\n");
+  std::stringstream ss2;
+  {
+    csv::Writer writer(ss2, csv::Specification().withComment('#'));
+    writer.writeRow(strings_t({nul, "#c"}));
+  }
+  REQUIRE(ss2.str() == nul + ",\"#c\"\n");
+}
+
+TEST_CASE("WriteRowsFromReader", "[csv_writer]")
+{
+  std::string input = "a,\"b,c\",d\n\"multi\nline\",\"q\"\"q\",\n";
+  std::stringstream ist(input);
+  csv::Reader reader(ist);
+  std::stringstream ost;
+  {
+    csv::Writer writer(ost);
+    for(auto row : reader)
+    {
+      writer.writeRow(row);
+    }
+  }
+  REQUIRE(readBack(ost.str()) == readBack(input));
+}
+
+TEST_CASE("WriteFlushesInBlocks", "[csv_writer]")
+{
+  std::stringstream ss;
+  csv::Writer writer(ss, csv::Specification(), 16);
+  writer.writeRow(strings_t({"0123456789", "0123456789"}));
+  REQUIRE(ss.str() == "0123456789,0123456789");
+  writer.writeRow(strings_t({"x"}));
+  REQUIRE(ss.str() == "0123456789,0123456789");
+  writer.flush();
+  REQUIRE(ss.str() == "0123456789,0123456789\nx\n");
+}
+
+TEST_CASE("WriteWideCharacters", "[csv_writer]")
+{
+  std::wstringstream ss;
+  {
+    csv::WWriter writer(ss);
+    writer.writeRow(std::vector<std::wstring>({L"a", L"b c", L"d,e"}));
+  }
+  REQUIRE(ss.str() == L"a,b c,\"d,e\"\n");
+}